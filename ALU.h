@@ -11,6 +11,10 @@ class ALU {
         bool jumpReg;
         bool shift;
         bool zeroExtend;
+        // The operation execute() performs, 0 ADD to 7 SRL
+        int operation() const {
+            return ALU_control_inputs;
+        }
         // Generate the control inputs for the ALU
         void generate_control_inputs(int ALU_op, int funct, int opcode) {
             unSigned = false;
@@ -92,6 +96,35 @@ class ALU {
             }
         }
         
+        // Multiply/divide unit: HI and LO results of MULT, MULTU, DIV, DIVU (funct 24-27)
+        // Division by zero leaves HI and LO unchanged
+        static void multiply_divide(int funct, uint32_t operand_1, uint32_t operand_2, uint32_t &hi, uint32_t &lo) {
+            if (funct == 24) { //MULT
+                int64_t product = (int64_t)(int32_t)operand_1 * (int32_t)operand_2;
+                hi = (uint64_t)product >> 32;
+                lo = (uint32_t)product;
+            }
+            else if (funct == 25) { //MULTU
+                uint64_t product = (uint64_t)operand_1 * operand_2;
+                hi = product >> 32;
+                lo = (uint32_t)product;
+            }
+            else if (funct == 26 && operand_2 != 0) { //DIV
+                if ((int32_t)operand_1 == INT32_MIN && (int32_t)operand_2 == -1) { //overflows, quotient wraps
+                    lo = operand_1;
+                    hi = 0;
+                }
+                else {
+                    lo = (int32_t)operand_1 / (int32_t)operand_2;
+                    hi = (int32_t)operand_1 % (int32_t)operand_2;
+                }
+            }
+            else if (funct == 27 && operand_2 != 0) { //DIVU
+                lo = operand_1 / operand_2;
+                hi = operand_1 % operand_2;
+            }
+        }
+
         // Execute ALU operations, generate result, and set the zero control signal if necessary
         uint32_t execute(uint32_t operand_1, uint32_t operand_2, uint32_t &ALU_zero) {
             if (ALU_control_inputs == 0) {
@@ -0,0 +1,629 @@
+#ifndef ASSEMBLER
+#define ASSEMBLER
+#include <cstdint>
+#include <cstdlib>
+#include <cctype>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include "memory.h"
+#include "encoding.h"
+#include "symbols.h"
+
+// Two-pass assembler for the instructions the control table and ALU
+// implement, so programs can be run without a MIPS cross-compiler. The first
+// pass sizes every statement and places the labels, the second encodes.
+//
+// .text starts at address 0 and its size is the end_pc. .data starts at
+// ASM_DATA unless given an address (or right after .text once pack() is
+// called, for programs that share memory under --smt), and takes .word, .half, .byte, .ascii,
+// .asciiz, .space and .align. Data is laid out big-endian within a word, as
+// LBU/LHU and SB/SH see it.
+//
+// Pseudo-instructions: nop, move, li, la, b, beqz, bnez, blt, bge, bgt, ble
+// (through $at) and mul (MULT then MFLO). The models link JAL to PC + 8 as if
+// it had a delay slot, so every jal is followed by a nop it returns past.
+
+static const uint32_t ASM_DATA = 0x10000;
+
+class Assembler {
+	private:
+		struct Statement {
+			int line;
+			bool data;                      //in .data
+			uint32_t address;
+			std::string op;
+			std::vector<std::string> args;
+		};
+
+		std::string path;
+		std::string error;
+		std::vector<Statement> statements;
+		std::map<std::string, uint32_t> labels;
+		std::vector<std::string> code;      //labels in .text
+		std::vector<uint32_t> text;
+		std::vector<uint8_t> bytes;         //data from dataStart
+		uint32_t dataStart;
+		uint32_t textBytes;                 //size of .text, known after read()
+		bool dataGiven;                     //.data was given an address
+		bool packed;                        //.data follows .text unless given an address
+		int line;
+
+		bool fail(const std::string &message) {
+			std::ostringstream out;
+			out << path << ":" << line << ": " << message;
+			error = out.str();
+			return false;
+		}
+
+		static std::string trim(const std::string &s) {
+			size_t begin = s.find_first_not_of(" \t\r");
+			if (begin == std::string::npos) {
+				return "";
+			}
+			return s.substr(begin, s.find_last_not_of(" \t\r") - begin + 1);
+		}
+
+		static bool identifier(const std::string &s) {
+			if (s.empty() || (!isalpha((unsigned char)s[0]) && s[0] != '_' && s[0] != '.')) {
+				return false;
+			}
+			for (size_t i = 1; i < s.size(); i++) {
+				if (!isalnum((unsigned char)s[i]) && s[i] != '_' && s[i] != '.') {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		//A label, possibly with an offset, rather than a number
+		static bool symbolic(const std::string &s) {
+			return identifier(trim(s.substr(0, s.find_first_of("+-", 1))));
+		}
+
+		//Splits operands at commas outside quotes
+		static std::vector<std::string> split(const std::string &s) {
+			std::vector<std::string> parts;
+			std::string current;
+			bool quoted = false;
+			for (size_t i = 0; i < s.size(); i++) {
+				if (s[i] == '"' && (i == 0 || s[i - 1] != '\\')) {
+					quoted = !quoted;
+				}
+				if (s[i] == ',' && !quoted) {
+					parts.push_back(trim(current));
+					current.clear();
+				}
+				else {
+					current += s[i];
+				}
+			}
+			if (!trim(current).empty() || !parts.empty()) {
+				parts.push_back(trim(current));
+			}
+			return parts;
+		}
+
+		bool reg(const std::string &s, uint32_t &r) {
+			static const char *names[32] = {"zero", "at", "v0", "v1", "a0", "a1", "a2", "a3",
+					"t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7", "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7",
+					"t8", "t9", "k0", "k1", "gp", "sp", "fp", "ra"};
+			if (s.size() < 2 || s[0] != '$') {
+				return fail("expected a register, got '" + s + "'");
+			}
+			std::string name = s.substr(1);
+			if (isdigit((unsigned char)name[0])) {
+				char *end;
+				unsigned long n = strtoul(name.c_str(), &end, 10);
+				if (*end == '\0' && n < 32) {
+					r = n;
+					return true;
+				}
+			}
+			for (uint32_t i = 0; i < 32; i++) {
+				if (name == names[i]) {
+					r = i;
+					return true;
+				}
+			}
+			if (name == "s8") {
+				r = 30;
+				return true;
+			}
+			return fail("unknown register '" + s + "'");
+		}
+
+		//Number, character or label with an optional +/- offset
+		bool value(const std::string &s, int64_t &v, bool needLabels) {
+			if (s.size() == 3 && s[0] == '\'' && s[2] == '\'') {
+				v = (unsigned char)s[1];
+				return true;
+			}
+			size_t sign = s.find_first_of("+-", 1);
+			std::string base = trim(s.substr(0, sign));
+			if (identifier(base)) {
+				int64_t offset = 0;
+				if (sign != std::string::npos && !value(trim(s.substr(sign)), offset, needLabels)) {
+					return false;
+				}
+				std::map<std::string, uint32_t>::const_iterator label = labels.find(base);
+				if (label == labels.end()) {
+					if (needLabels) {
+						return fail("undefined label '" + base + "'");
+					}
+					v = 0;
+					return true;
+				}
+				v = (int64_t)label->second + offset;
+				return true;
+			}
+			char *end;
+			errno = 0;
+			v = strtoll(s.c_str(), &end, 0);
+			if (s.empty() || *end != '\0' || errno != 0) {
+				return fail("expected a number, got '" + s + "'");
+			}
+			return true;
+		}
+
+		bool immediate(const std::string &s, int64_t low, int64_t high, uint32_t &imm) {
+			int64_t v;
+			if (!value(s, v, true)) {
+				return false;
+			}
+			if (v < low || v > high) {
+				return fail("immediate '" + s + "' is out of range");
+			}
+			imm = v & 0xFFFF;
+			return true;
+		}
+
+		bool count(const Statement &s, size_t n) {
+			if (s.args.size() != n) {
+				std::ostringstream out;
+				out << s.op << " takes " << n << " operands";
+				return fail(out.str());
+			}
+			return true;
+		}
+
+		static bool lookup(const char *const table[], const uint32_t codes[], const std::string &op, uint32_t &code) {
+			for (size_t i = 0; table[i]; i++) {
+				if (op == table[i]) {
+					code = codes[i];
+					return true;
+				}
+			}
+			return false;
+		}
+
+		//Bytes a data directive takes at address, or instructions a text statement expands to
+		bool size(const Statement &s, uint32_t address, uint32_t &n) {
+			const std::string &op = s.op;
+			if (s.data) {
+				if (op == ".word" || op == ".half") {
+					uint32_t unit = op == ".word" ? 4 : 2;
+					n = (unit - address % unit) % unit + unit * s.args.size();
+				}
+				else if (op == ".byte") {
+					n = s.args.size();
+				}
+				else if (op == ".ascii" || op == ".asciiz") {
+					std::string str;
+					if (!count(s, 1) || !string_literal(s.args[0], str)) {
+						return false;
+					}
+					n = str.size() + (op == ".asciiz");
+				}
+				else if (op == ".space" || op == ".align") {
+					int64_t v;
+					if (!count(s, 1) || !value(s.args[0], v, true) || v < 0 || v > (1 << 24) || (op == ".align" && v > 16)) {
+						return error.empty() ? fail(op + " needs a small non-negative size") : false;
+					}
+					n = op == ".space" ? v : ((1u << v) - address % (1u << v)) % (1u << v);
+				}
+				else {
+					return fail("unknown data directive " + op);
+				}
+				return true;
+			}
+			n = 1;
+			if (op == "la" || op == "mul" || op == "jal" || op == "blt" || op == "bge" || op == "bgt" || op == "ble") {
+				n = 2;
+			}
+			else if (op == "li") {
+				int64_t v;
+				if (!count(s, 2) || !value(s.args[1], v, false)) {
+					return false;
+				}
+				n = v >= -32768 && v <= 65535 && !symbolic(s.args[1]) ? 1 : 2;
+			}
+			return true;
+		}
+
+		bool string_literal(const std::string &s, std::string &out) {
+			if (s.size() < 2 || s[0] != '"' || s[s.size() - 1] != '"') {
+				return fail("expected a string, got '" + s + "'");
+			}
+			out.clear();
+			for (size_t i = 1; i + 1 < s.size(); i++) {
+				char c = s[i];
+				if (c == '\\' && i + 2 < s.size()) {
+					c = s[++i];
+					c = c == 'n' ? '\n' : c == 't' ? '\t' : c == '0' ? '\0' : c;
+				}
+				out += c;
+			}
+			return true;
+		}
+
+		bool read(const std::string &source) {
+			std::istringstream in(source);
+			std::string raw;
+			bool data = false;
+			uint32_t textAddress = 0;
+			uint32_t dataAddress = dataStart;
+			bool dataPlaced = false;
+			std::vector<std::string> pending; //labels of the next statement
+			line = 0;
+			while (std::getline(in, raw)) {
+				line++;
+				//Strip the comment, a # outside a string
+				bool quoted = false;
+				for (size_t i = 0; i < raw.size(); i++) {
+					if (raw[i] == '"' && (i == 0 || raw[i - 1] != '\\')) {
+						quoted = !quoted;
+					}
+					if (raw[i] == '#' && !quoted) {
+						raw.erase(i);
+						break;
+					}
+				}
+				std::string rest = trim(raw);
+				size_t colon;
+				while ((colon = rest.find(':')) != std::string::npos && identifier(trim(rest.substr(0, colon)))) {
+					std::string label = trim(rest.substr(0, colon));
+					if (labels.count(label)) {
+						return fail("label '" + label + "' defined twice");
+					}
+					labels[label] = data ? dataAddress : textAddress;
+					if (!data) {
+						code.push_back(label);
+					}
+					pending.push_back(label);
+					rest = trim(rest.substr(colon + 1));
+				}
+				if (rest.empty()) {
+					continue;
+				}
+				Statement s;
+				s.line = line;
+				size_t space = rest.find_first_of(" \t");
+				s.op = rest.substr(0, space);
+				if (space != std::string::npos) {
+					s.args = split(rest.substr(space + 1));
+				}
+				if (s.op == ".text" || s.op == ".data") {
+					data = s.op == ".data";
+					if (data && !s.args.empty()) {
+						int64_t address;
+						if (dataPlaced || !value(s.args[0], address, true) || address % 4 != 0 || address < 0) {
+							return error.empty() ? fail(".data takes a word-aligned address before any data") : false;
+						}
+						dataStart = dataAddress = address;
+						dataGiven = true;
+					}
+					continue;
+				}
+				if (s.op == ".globl" || s.op == ".global" || s.op == ".ent" || s.op == ".end" || s.op == ".set") {
+					continue;
+				}
+				if (!data && s.op[0] == '.') {
+					return fail(s.op + " is only allowed in .data");
+				}
+				s.data = data;
+				s.address = data ? dataAddress : textAddress;
+				uint32_t n;
+				if (!size(s, s.address, n)) {
+					return false;
+				}
+				if (data) {
+					//Labels of a .word or .half name it, not the padding before it
+					uint32_t unit = s.op == ".word" ? 4 : s.op == ".half" ? 2 : 1;
+					for (size_t i = 0; i < pending.size(); i++) {
+						labels[pending[i]] = (dataAddress + unit - 1) / unit * unit;
+					}
+					dataAddress += n;
+					dataPlaced = true;
+				}
+				else {
+					textAddress += 4 * n;
+				}
+				statements.push_back(s);
+				pending.clear();
+			}
+			textBytes = textAddress;
+			return true;
+		}
+
+		void put(uint32_t address, uint32_t v, uint32_t n) {
+			for (uint32_t i = 0; i < n; i++) {
+				bytes[address - dataStart + i] = v >> (8 * (n - 1 - i));
+			}
+		}
+
+		bool emit_data(const Statement &s) {
+			uint32_t n;
+			size(s, s.address, n);
+			bytes.resize(s.address - dataStart + n, 0);
+			if (s.op == ".word" || s.op == ".half" || s.op == ".byte") {
+				uint32_t unit = s.op == ".word" ? 4 : s.op == ".half" ? 2 : 1;
+				uint32_t address = s.address + n - unit * s.args.size();
+				for (size_t i = 0; i < s.args.size(); i++, address += unit) {
+					int64_t v;
+					if (!value(s.args[i], v, true)) {
+						return false;
+					}
+					if (v < -((int64_t)1 << (8 * unit - 1)) || v >= ((int64_t)1 << (8 * unit))) {
+						return fail("'" + s.args[i] + "' does not fit in " + s.op);
+					}
+					put(address, v, unit);
+				}
+			}
+			else if (s.op == ".ascii" || s.op == ".asciiz") {
+				std::string str;
+				string_literal(s.args[0], str);
+				for (size_t i = 0; i < str.size(); i++) {
+					put(s.address + i, (unsigned char)str[i], 1);
+				}
+			}
+			return true;
+		}
+
+		bool branch_offset(const std::string &target, uint32_t pc, uint32_t &imm) {
+			int64_t address;
+			if (!value(target, address, true)) {
+				return false;
+			}
+			int64_t offset = (address - (int64_t)(pc + 4)) / 4;
+			if (offset < -32768 || offset > 32767) {
+				return fail("branch to '" + target + "' is out of range");
+			}
+			imm = offset & 0xFFFF;
+			return true;
+		}
+
+		bool emit_text(const Statement &s) {
+			static const char *const arithmetic[] = {"add", "addu", "sub", "subu", "and", "or", "nor", "slt", "sltu", NULL};
+			static const uint32_t arithmeticFuncts[] = {32, 33, 34, 35, 36, 37, 39, 42, 43};
+			static const char *const immediates[] = {"addi", "addiu", "slti", "sltiu", "andi", "ori", NULL};
+			static const uint32_t immediateOpcodes[] = {8, 9, 10, 11, 12, 13};
+			static const char *const transfers[] = {"lw", "lbu", "lhu", "sb", "sh", "sw", NULL};
+			static const uint32_t transferOpcodes[] = {35, 36, 37, 40, 41, 43};
+			static const char *const muldiv[] = {"mult", "multu", "div", "divu", NULL};
+			static const uint32_t muldivFuncts[] = {24, 25, 26, 27};
+			static const char *const compares[] = {"blt", "bge", "bgt", "ble", NULL};
+			static const uint32_t compareBranches[] = {5, 4, 5, 4}; //BNE or BEQ on the SLT into $at
+			const std::string &op = s.op;
+			const std::vector<std::string> &a = s.args;
+			uint32_t pc = s.address;
+			uint32_t code, rd, rs, rt, imm;
+
+			if (lookup(arithmetic, arithmeticFuncts, op, code)) {
+				if (!count(s, 3) || !reg(a[0], rd) || !reg(a[1], rs) || !reg(a[2], rt)) {
+					return false;
+				}
+				text.push_back(r_type(code, rs, rt, rd, 0));
+			}
+			else if (op == "sll" || op == "srl") {
+				if (!count(s, 3) || !reg(a[0], rd) || !reg(a[1], rt) || !immediate(a[2], 0, 31, imm)) {
+					return false;
+				}
+				text.push_back(r_type(op == "sll" ? 0 : 2, 0, rt, rd, imm));
+			}
+			else if (op == "jr") {
+				if (!count(s, 1) || !reg(a[0], rs)) {
+					return false;
+				}
+				text.push_back(r_type(8, rs, 0, 0, 0));
+			}
+			else if (lookup(muldiv, muldivFuncts, op, code)) {
+				if (!count(s, 2) || !reg(a[0], rs) || !reg(a[1], rt)) {
+					return false;
+				}
+				text.push_back(r_type(code, rs, rt, 0, 0));
+			}
+			else if (op == "mfhi" || op == "mflo") {
+				if (!count(s, 1) || !reg(a[0], rd)) {
+					return false;
+				}
+				text.push_back(r_type(op == "mfhi" ? 16 : 18, 0, 0, rd, 0));
+			}
+			else if (lookup(immediates, immediateOpcodes, op, code)) {
+				bool zeroExtend = op == "andi" || op == "ori";
+				if (!count(s, 3) || !reg(a[0], rt) || !reg(a[1], rs) || !immediate(a[2], zeroExtend ? 0 : -32768, zeroExtend ? 65535 : 32767, imm)) {
+					return false;
+				}
+				text.push_back(i_type(code, rs, rt, imm));
+			}
+			else if (op == "lui") {
+				if (!count(s, 2) || !reg(a[0], rt) || !immediate(a[1], 0, 65535, imm)) {
+					return false;
+				}
+				text.push_back(i_type(15, 0, rt, imm));
+			}
+			else if (lookup(transfers, transferOpcodes, op, code)) {
+				size_t open = a.size() == 2 ? a[1].find('(') : std::string::npos;
+				if (!count(s, 2) || open == std::string::npos || a[1][a[1].size() - 1] != ')') {
+					return error.empty() ? fail(op + " takes a register and offset(base)") : false;
+				}
+				std::string offset = trim(a[1].substr(0, open));
+				if (!reg(a[0], rt) || !reg(trim(a[1].substr(open + 1, a[1].size() - open - 2)), rs) ||
+						!immediate(offset.empty() ? "0" : offset, -32768, 32767, imm)) {
+					return false;
+				}
+				text.push_back(i_type(code, rs, rt, imm));
+			}
+			else if (op == "beq" || op == "bne") {
+				if (!count(s, 3) || !reg(a[0], rs) || !reg(a[1], rt) || !branch_offset(a[2], pc, imm)) {
+					return false;
+				}
+				text.push_back(i_type(op == "beq" ? 4 : 5, rs, rt, imm));
+			}
+			else if (op == "j" || op == "jal") {
+				int64_t target;
+				if (!count(s, 1) || !value(a[0], target, true)) {
+					return false;
+				}
+				text.push_back(j_type(op == "j" ? 2 : 3, target));
+				if (op == "jal") {
+					text.push_back(0); //skipped by the PC + 8 return
+				}
+			}
+			//Pseudo-instructions
+			else if (op == "nop") {
+				if (!count(s, 0)) {
+					return false;
+				}
+				text.push_back(0);
+			}
+			else if (op == "move") {
+				if (!count(s, 2) || !reg(a[0], rd) || !reg(a[1], rs)) {
+					return false;
+				}
+				text.push_back(r_type(33, rs, 0, rd, 0));
+			}
+			else if (op == "li" || op == "la") {
+				int64_t v;
+				if (!count(s, 2) || !reg(a[0], rt) || !value(a[1], v, true)) {
+					return false;
+				}
+				uint32_t n;
+				size(s, pc, n);
+				if (n == 1) {
+					text.push_back(i_type(v < 0 ? 9 : 13, 0, rt, v)); //ADDIU or ORI from $zero
+				}
+				else {
+					text.push_back(i_type(15, 0, rt, (uint32_t)v >> 16));
+					text.push_back(i_type(13, rt, rt, v & 0xFFFF));
+				}
+			}
+			else if (op == "b") {
+				if (!count(s, 1) || !branch_offset(a[0], pc, imm)) {
+					return false;
+				}
+				text.push_back(i_type(4, 0, 0, imm));
+			}
+			else if (op == "beqz" || op == "bnez") {
+				if (!count(s, 2) || !reg(a[0], rs) || !branch_offset(a[1], pc, imm)) {
+					return false;
+				}
+				text.push_back(i_type(op == "beqz" ? 4 : 5, rs, 0, imm));
+			}
+			else if (lookup(compares, compareBranches, op, code)) {
+				if (!count(s, 3) || !reg(a[0], rs) || !reg(a[1], rt) || !branch_offset(a[2], pc + 4, imm)) {
+					return false;
+				}
+				bool swapped = op == "bgt" || op == "ble"; //a > b is b < a
+				text.push_back(r_type(42, swapped ? rt : rs, swapped ? rs : rt, 1, 0));
+				text.push_back(i_type(code, 1, 0, imm));
+			}
+			else if (op == "mul") {
+				if (!count(s, 3) || !reg(a[0], rd) || !reg(a[1], rs) || !reg(a[2], rt)) {
+					return false;
+				}
+				text.push_back(r_type(24, rs, rt, 0, 0));
+				text.push_back(r_type(18, 0, 0, rd, 0));
+			}
+			else {
+				return fail("unsupported instruction " + op);
+			}
+			return true;
+		}
+
+	public:
+		Assembler() : dataStart(ASM_DATA), textBytes(0), dataGiven(false), packed(false), line(0) {}
+
+		// Places .data of the next program right after its .text, 16-byte aligned, unless it gives .data an address
+		void pack() {
+			packed = true;
+		}
+
+		// Assembles the file into memory at base and returns its end_pc, or 0 with the reason in error
+		uint32_t assemble(const std::string &file, Memory &memory, std::string &reason, uint32_t base = 0) {
+			path = file;
+			std::ifstream in(file.c_str());
+			if (!in) {
+				reason = "cannot open " + file;
+				return 0;
+			}
+			std::stringstream source;
+			source << in.rdbuf();
+			if (!read(source.str())) {
+				reason = error;
+				return 0;
+			}
+			if (packed && !dataGiven && dataStart != (textBytes + 15) / 16 * 16) {
+				//The sizes of .text do not depend on where .data is, so a second read places it
+				statements.clear();
+				labels.clear();
+				code.clear();
+				dataStart = (textBytes + 15) / 16 * 16;
+				if (!read(source.str())) {
+					reason = error;
+					return 0;
+				}
+			}
+			for (size_t i = 0; i < statements.size(); i++) {
+				line = statements[i].line;
+				if (!(statements[i].data ? emit_data(statements[i]) : emit_text(statements[i]))) {
+					reason = error;
+					return 0;
+				}
+			}
+			line = 0;
+			uint32_t end_pc = text.size() * 4;
+			if (text.empty()) {
+				fail("no instructions");
+			}
+			else if (!bytes.empty() && end_pc > dataStart) {
+				fail(".text overlaps .data");
+			}
+			else if (base + (uint64_t)std::max<uint64_t>(end_pc, dataStart + bytes.size()) > (uint64_t)memory.words() * 4) {
+				fail("the program does not fit in memory");
+			}
+			if (!error.empty()) {
+				reason = error;
+				return 0;
+			}
+
+			uint32_t dummy;
+			for (size_t i = 0; i < text.size(); i++) {
+				memory.access(base + 4 * i, dummy, text[i], false, true);
+			}
+			bytes.resize((bytes.size() + 3) / 4 * 4, 0);
+			for (size_t i = 0; i < bytes.size(); i += 4) {
+				uint32_t word = (bytes[i] << 24) | (bytes[i + 1] << 16) | (bytes[i + 2] << 8) | bytes[i + 3];
+				memory.access(base + dataStart + i, dummy, word, false, true);
+			}
+			return end_pc;
+		}
+
+		// Bytes of memory from its base the last program assembled takes, up to the end of its .data
+		uint32_t footprint() const {
+			return bytes.empty() ? text.size() * 4 : std::max<uint32_t>(text.size() * 4, dataStart + bytes.size());
+		}
+
+		// Adds the labels of .text of the last program assembled to a symbol table
+		void symbols(SymbolTable &table) const {
+			for (size_t i = 0; i < code.size(); i++) {
+				table.add(code[i], labels.find(code[i])->second);
+			}
+		}
+};
+
+#endif
@@ -0,0 +1,463 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "memory.h"
+#include "reg_file.h"
+#include "options.h"
+#include "assembler.h"
+#include "encoding.h"
+#include "pipeline.h"
+#include "sweep.h"
+
+using namespace std;
+
+// Host throughput of every processor model. Each *_main_loop runs a set of
+// built-in kernels, plus any assembly kernels given with --asm (make bench
+// passes bench/*.s), with --quiet, and the suite reports simulated
+// instructions and cycles per host second (median and standard deviation over
+// repeated runs) and peak RSS. Every model/kernel pair runs in its own child
+// process so its peak RSS is its own. The cycle and instruction counts are the
+// ones the main loop returns.
+//
+// The engine benchmark then drives each pipeline model's cycle() directly for
+// a fixed number of cycles of a never-ending kernel, without a main loop
+// around it, to time the pipeline engine alone. --json writes both for
+// diffing between builds.
+
+SimOptions sim_options;
+
+extern SweepResult single_cycle_main_loop(Registers &reg_file, Memory &memory, uint32_t end_pc);
+extern SweepResult pipelined_main_loop(Registers &reg_file, Memory &memory, uint32_t end_pc);
+extern SweepResult speculative_main_loop(Registers &reg_file, Memory &memory, uint32_t end_pc);
+extern SweepResult io_superscalar_main_loop(Registers &reg_file, Memory &memory, uint32_t end_pc);
+
+static const int MAX_RUNS = 64;
+static const uint64_t ENGINE_CYCLES = 2000000;
+
+struct Model {
+	const char *name;
+	SweepResult (*main_loop)(Registers &, Memory &, uint32_t);
+};
+
+// The out-of-order models are still stubs and simulate nothing
+static const Model models[] = {
+	{"single-cycle", single_cycle_main_loop},
+	{"pipelined", pipelined_main_loop},
+	{"speculative", speculative_main_loop},
+	{"io-superscalar", io_superscalar_main_loop},
+};
+
+// BEQ/BNE at index from in text, to the instruction at index to
+static uint32_t branch(uint32_t opcode, uint32_t rs, uint32_t rt, size_t from, size_t to) {
+	return i_type(opcode, rs, rt, (uint32_t)(to - (from + 1)));
+}
+
+struct Kernel {
+	string name;
+	vector<uint32_t> text;
+	vector<pair<uint32_t, uint32_t> > data; //address, word
+	string source;                          //assembly file, instead of text and data
+};
+
+// Independent ALU operations in a counted loop
+static Kernel alu_kernel() {
+	Kernel k;
+	k.name = "alu";
+	vector<uint32_t> &t = k.text;
+	t.push_back(i_type(13, 0, 8, 40000));      //      ori $t0, $zero, 40000
+	size_t loop = t.size();
+	t.push_back(r_type(32, 9, 8, 9, 0));       // loop: add $t1, $t1, $t0
+	t.push_back(r_type(34, 9, 8, 10, 0));      //      sub $t2, $t1, $t0
+	t.push_back(r_type(36, 9, 10, 11, 0));     //      and $t3, $t1, $t2
+	t.push_back(r_type(37, 11, 8, 12, 0));     //      or $t4, $t3, $t0
+	t.push_back(r_type(0, 0, 12, 13, 3));      //      sll $t5, $t4, 3
+	t.push_back(r_type(2, 0, 13, 14, 1));      //      srl $t6, $t5, 1
+	t.push_back(r_type(39, 14, 9, 15, 0));     //      nor $t7, $t6, $t1
+	t.push_back(r_type(42, 15, 14, 24, 0));    //      slt $t8, $t7, $t6
+	t.push_back(i_type(8, 8, 8, (uint32_t)-1)); //     addi $t0, $t0, -1
+	t.push_back(branch(5, 8, 0, t.size(), loop)); //   bne $t0, $zero, loop
+	return k;
+}
+
+// Branches on the bits of a linear congruential generator, hard to predict
+static Kernel branchy_kernel() {
+	Kernel k;
+	k.name = "branchy";
+	vector<uint32_t> &t = k.text;
+	t.push_back(i_type(13, 0, 8, 30000));      //      ori $t0, $zero, 30000
+	t.push_back(i_type(13, 0, 16, 12345));     //      ori $s0, $zero, 12345
+	t.push_back(i_type(15, 0, 17, 0x41C6));    //      lui $s1, 0x41c6
+	t.push_back(i_type(13, 17, 17, 0x4E6D));   //      ori $s1, $s1, 0x4e6d
+	size_t loop = t.size();
+	t.push_back(r_type(25, 16, 17, 0, 0));     // loop: multu $s0, $s1
+	t.push_back(r_type(18, 0, 0, 16, 0));      //      mflo $s0
+	t.push_back(i_type(9, 16, 16, 12345));     //      addiu $s0, $s0, 12345
+	t.push_back(r_type(2, 0, 16, 9, 16));      //      srl $t1, $s0, 16
+	for (uint32_t bit = 1; bit <= 4; bit <<= 1) {
+		t.push_back(i_type(12, 9, 10, bit));       //  andi $t2, $t1, bit
+		t.push_back(branch(4, 10, 0, t.size(), t.size() + 2)); //beq $t2, $zero, +1
+		t.push_back(i_type(8, 11, 11, 1));         //  addi $t3, $t3, 1
+	}
+	t.push_back(i_type(8, 8, 8, (uint32_t)-1)); //     addi $t0, $t0, -1
+	t.push_back(branch(5, 8, 0, t.size(), loop)); //   bne $t0, $zero, loop
+	return k;
+}
+
+// Pointer chasing through a shuffled list, every load feeds the next one
+static Kernel load_use_kernel() {
+	Kernel k;
+	k.name = "load-use";
+	vector<uint32_t> &t = k.text;
+	t.push_back(i_type(13, 0, 8, 60000));      //      ori $t0, $zero, 60000
+	t.push_back(i_type(15, 0, 9, 1));          //      lui $t1, 1
+	size_t loop = t.size();
+	t.push_back(i_type(35, 9, 9, 0));          // loop: lw $t1, 0($t1)
+	t.push_back(i_type(35, 9, 10, 4));         //      lw $t2, 4($t1)
+	t.push_back(r_type(32, 11, 10, 11, 0));    //      add $t3, $t3, $t2
+	t.push_back(i_type(8, 8, 8, (uint32_t)-1)); //     addi $t0, $t0, -1
+	t.push_back(branch(5, 8, 0, t.size(), loop)); //   bne $t0, $zero, loop
+
+	//4096 two-word nodes from 0x10000 linked in a fixed random order
+	const uint32_t nodes = 4096;
+	vector<uint32_t> order(nodes);
+	for (uint32_t i = 0; i < nodes; i++) {
+		order[i] = i;
+	}
+	uint32_t seed = 1;
+	for (uint32_t i = nodes - 1; i > 0; i--) {
+		seed = seed * 1103515245 + 12345;
+		swap(order[i], order[(seed >> 16) % (i + 1)]);
+	}
+	for (uint32_t i = 0; i < nodes; i++) {
+		uint32_t node = 0x10000 + order[i] * 8;
+		k.data.push_back(make_pair(node, 0x10000 + order[(i + 1) % nodes] * 8));
+		k.data.push_back(make_pair(node + 4, i));
+	}
+	return k;
+}
+
+// Word, halfword and byte stores over a 4 KB window
+static Kernel store_kernel() {
+	Kernel k;
+	k.name = "store";
+	vector<uint32_t> &t = k.text;
+	t.push_back(i_type(13, 0, 8, 30000));      //      ori $t0, $zero, 30000
+	t.push_back(i_type(15, 0, 10, 2));         //      lui $t2, 2
+	size_t loop = t.size();
+	t.push_back(i_type(12, 8, 9, 1023));       // loop: andi $t1, $t0, 1023
+	t.push_back(r_type(0, 0, 9, 9, 2));        //      sll $t1, $t1, 2
+	t.push_back(r_type(32, 9, 10, 9, 0));      //      add $t1, $t1, $t2
+	t.push_back(i_type(43, 9, 8, 0));          //      sw $t0, 0($t1)
+	t.push_back(i_type(41, 9, 8, 4096));       //      sh $t0, 4096($t1)
+	t.push_back(i_type(40, 9, 8, 8192));       //      sb $t0, 8192($t1)
+	t.push_back(i_type(43, 9, 11, 12288));     //      sw $t3, 12288($t1)
+	t.push_back(i_type(8, 11, 11, 1));         //      addi $t3, $t3, 1
+	t.push_back(i_type(8, 8, 8, (uint32_t)-1)); //     addi $t0, $t0, -1
+	t.push_back(branch(5, 8, 0, t.size(), loop)); //   bne $t0, $zero, loop
+	return k;
+}
+
+// Kernel text at address 0 and its data, returns end_pc
+static uint32_t load_kernel(const Kernel &kernel, Memory &memory) {
+	if (!kernel.source.empty()) {
+		string error;
+		return Assembler().assemble(kernel.source, memory, error);
+	}
+	uint32_t dummy;
+	for (size_t i = 0; i < kernel.text.size(); i++) {
+		memory.access(i * 4, dummy, kernel.text[i], false, true);
+	}
+	for (size_t i = 0; i < kernel.data.size(); i++) {
+		memory.access(kernel.data[i].first, dummy, kernel.data[i].second, false, true);
+	}
+	return kernel.text.size() * 4;
+}
+
+// Discards what the main loops print, only their returned counts are used
+class NullBuffer : public streambuf {
+	protected:
+		int overflow(int c) {
+			return c;
+		}
+};
+
+// What a child process sends back
+struct Measurement {
+	uint64_t instructions;
+	uint64_t cycles;
+	int runs;
+	double seconds[MAX_RUNS];
+};
+
+static Measurement measure(const Model &model, const Kernel &kernel, int runs) {
+	Measurement m;
+	memset(&m, 0, sizeof(m));
+	m.runs = runs;
+
+	//Timed runs with the per-cycle dumps off, the counts they return are the same every run
+	sim_options.quiet = true;
+	NullBuffer discard;
+	streambuf *console = cout.rdbuf(&discard);
+	for (int run = 0; run < runs; run++) {
+		Memory memory;
+		Registers reg_file;
+		reg_file.pc = 0;
+		uint32_t end_pc = load_kernel(kernel, memory);
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		SweepResult counts = model.main_loop(reg_file, memory, end_pc);
+		chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+		m.seconds[run] = elapsed.count();
+		m.cycles = counts.cycles;
+		m.instructions = counts.instructions;
+	}
+	cout.rdbuf(console);
+	return m;
+}
+
+struct Summary {
+	double median;
+	double stddev;
+};
+
+static Summary summarise(vector<double> values) {
+	sort(values.begin(), values.end());
+	Summary s;
+	size_t n = values.size();
+	s.median = n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+	double mean = 0;
+	for (size_t i = 0; i < n; i++) {
+		mean += values[i];
+	}
+	mean /= n;
+	double squares = 0;
+	for (size_t i = 0; i < n; i++) {
+		squares += (values[i] - mean) * (values[i] - mean);
+	}
+	s.stddev = n > 1 ? sqrt(squares / (n - 1)) : 0;
+	return s;
+}
+
+struct Result {
+	string model;
+	string kernel;
+	Measurement m;
+	Summary instructionRate;
+	Summary cycleRate;
+	long peakRssKb;
+};
+
+// Runs one model/kernel pair in a child process, false if it failed
+static bool run_child(const Model &model, const Kernel &kernel, int runs, Result &result) {
+	int fds[2];
+	if (pipe(fds) != 0) {
+		return false;
+	}
+	pid_t pid = fork();
+	if (pid < 0) {
+		return false;
+	}
+	if (pid == 0) {
+		close(fds[0]);
+		Measurement m = measure(model, kernel, runs);
+		bool ok = write(fds[1], &m, sizeof(m)) == (ssize_t)sizeof(m);
+		_exit(ok ? 0 : 1);
+	}
+	close(fds[1]);
+	Measurement m;
+	ssize_t got = 0;
+	while (got < (ssize_t)sizeof(m)) {
+		ssize_t n = read(fds[0], (char *)&m + got, sizeof(m) - got);
+		if (n <= 0) {
+			break;
+		}
+		got += n;
+	}
+	close(fds[0]);
+	int status;
+	struct rusage usage;
+	if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0 || got != (ssize_t)sizeof(m)) {
+		return false;
+	}
+
+	result.model = model.name;
+	result.kernel = kernel.name;
+	result.m = m;
+	result.peakRssKb = usage.ru_maxrss;
+	vector<double> instructionRates, cycleRates;
+	for (int run = 0; run < m.runs; run++) {
+		instructionRates.push_back(m.instructions / m.seconds[run]);
+		cycleRates.push_back(m.cycles / m.seconds[run]);
+	}
+	result.instructionRate = summarise(instructionRates);
+	result.cycleRate = summarise(cycleRates);
+	return true;
+}
+
+// Never-ending loop for the engine benchmark, with a load-use stall, a store,
+// a 1-in-4 taken branch and an always taken backwards branch
+static void load_engine_kernel(Memory &memory) {
+	uint32_t kernel[] = {
+		i_type(8, 0, 8, 0),          //      addi $t0, $zero, 0
+		i_type(8, 0, 9, 1024),       //      addi $t1, $zero, 1024
+		i_type(35, 9, 10, 0),        // loop: lw $t2, 0($t1)
+		r_type(32, 10, 8, 11, 0),    //      add $t3, $t2, $t0
+		i_type(43, 9, 11, 0),        //      sw $t3, 0($t1)
+		i_type(8, 8, 8, 1),          //      addi $t0, $t0, 1
+		i_type(12, 8, 12, 3),        //      andi $t4, $t0, 3
+		i_type(4, 12, 0, 2),         //      beq $t4, $zero, skip
+		r_type(37, 11, 8, 13, 0),    //      or $t5, $t3, $t0
+		r_type(0, 0, 13, 14, 2),     //      sll $t6, $t5, 2
+		i_type(12, 8, 15, 255),      // skip: andi $t7, $t0, 255
+		r_type(0, 0, 15, 15, 2),     //      sll $t7, $t7, 2
+		i_type(8, 15, 9, 1024),      //      addi $t1, $t7, 1024
+		i_type(5, 9, 0, (uint32_t)-12), //   bne $t1, $zero, loop
+	};
+	uint32_t dummy;
+	for (uint32_t i = 0; i < sizeof(kernel) / sizeof(kernel[0]); i++) {
+		memory.access(i * 4, dummy, kernel[i], false, true);
+	}
+}
+
+struct EngineResult {
+	string name;
+	Summary cycleRate;
+	double ipc;
+};
+
+// ENGINE_CYCLES cycles of the engine kernel on Processor, skipping idle cycles as the main loops do
+template <class Processor>
+static EngineResult engine_bench(const char *name, int runs, uint32_t memLatency = 1) {
+	PipelineConfig config;
+	config.memLatency = memLatency;
+	vector<double> rates;
+	EngineResult result;
+	result.name = name;
+	result.ipc = 0;
+	for (int run = 0; run < runs; run++) {
+		Memory memory;
+		Registers reg_file;
+		reg_file.pc = 0;
+		load_engine_kernel(memory);
+		Processor processor(reg_file, memory, 0xFFFFFFF0, config); //end_pc is never reached
+
+		uint64_t num_instrs = 0;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (uint64_t c = 0; c < ENGINE_CYCLES; c++) {
+			uint32_t committed = 0;
+			processor.cycle(committed);
+			num_instrs += committed;
+			uint64_t idle = min(processor.idle(), ENGINE_CYCLES - c - 1);
+			processor.skip(idle);
+			c += idle;
+		}
+		chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+		rates.push_back(ENGINE_CYCLES / elapsed.count());
+		result.ipc = (double)num_instrs / ENGINE_CYCLES;
+	}
+	result.cycleRate = summarise(rates);
+	return result;
+}
+
+static void write_json(const string &path, const vector<Result> &results, const vector<EngineResult> &engine, int runs) {
+	ofstream out(path.c_str());
+	out.precision(10);
+	out << "{\n  \"runs\": " << runs << ",\n  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		const Result &r = results[i];
+		out << "    {\"model\": \"" << r.model << "\", \"kernel\": \"" << r.kernel << "\", "
+			<< "\"instructions\": " << r.m.instructions << ", \"cycles\": " << r.m.cycles << ", "
+			<< "\"instructions_per_second\": {\"median\": " << r.instructionRate.median << ", \"stddev\": " << r.instructionRate.stddev << "}, "
+			<< "\"cycles_per_second\": {\"median\": " << r.cycleRate.median << ", \"stddev\": " << r.cycleRate.stddev << "}, "
+			<< "\"peak_rss_kb\": " << r.peakRssKb << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "  ],\n  \"engine\": [\n";
+	for (size_t i = 0; i < engine.size(); i++) {
+		const EngineResult &e = engine[i];
+		out << "    {\"model\": \"" << e.name << "\", \"cycles\": " << ENGINE_CYCLES << ", \"ipc\": " << e.ipc << ", "
+			<< "\"cycles_per_second\": {\"median\": " << e.cycleRate.median << ", \"stddev\": " << e.cycleRate.stddev << "}}"
+			<< (i + 1 < engine.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n}\n";
+}
+
+int main(int argc, char *argv[]) {
+	int runs = 5;
+	string json;
+	vector<Kernel> sources;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+			runs = max(1, min(MAX_RUNS, atoi(argv[++i])));
+		}
+		else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+			json = argv[++i];
+		}
+		else if (strcmp(argv[i], "--asm") == 0 && i + 1 < argc) {
+			Kernel k;
+			k.source = argv[++i];
+			k.name = k.source.substr(k.source.find_last_of('/') + 1);
+			k.name = k.name.substr(0, k.name.rfind(".s"));
+			Memory memory;
+			string error;
+			if (Assembler().assemble(k.source, memory, error) == 0) {
+				cout << "Failed to assemble: " << error << "\n";
+				return 1;
+			}
+			sources.push_back(k);
+		}
+		else {
+			cout << "Usage: " << argv[0] << " [--runs <count>] [--json <file>] [--asm <kernel.s>]...\n";
+			return 1;
+		}
+	}
+
+	vector<Kernel> kernels;
+	kernels.push_back(alu_kernel());
+	kernels.push_back(branchy_kernel());
+	kernels.push_back(load_use_kernel());
+	kernels.push_back(store_kernel());
+	kernels.insert(kernels.end(), sources.begin(), sources.end());
+
+	vector<Result> results;
+	printf("%-16s %-10s %10s %10s %18s %18s %10s\n", "model", "kernel", "instrs", "cycles", "Minstr/s", "Mcycles/s", "peak RSS");
+	for (size_t m = 0; m < sizeof(models) / sizeof(models[0]); m++) {
+		for (size_t k = 0; k < kernels.size(); k++) {
+			Result r;
+			if (!run_child(models[m], kernels[k], runs, r)) {
+				printf("%-16s %-10s failed\n", models[m].name, kernels[k].name.c_str());
+				continue;
+			}
+			printf("%-16s %-10s %10llu %10llu %9.2f +/- %5.2f %9.2f +/- %5.2f %7ld KB\n", r.model.c_str(), r.kernel.c_str(),
+					(unsigned long long)r.m.instructions, (unsigned long long)r.m.cycles,
+					r.instructionRate.median / 1e6, r.instructionRate.stddev / 1e6, r.cycleRate.median / 1e6, r.cycleRate.stddev / 1e6, r.peakRssKb);
+			fflush(stdout);
+			results.push_back(r);
+		}
+	}
+
+	vector<EngineResult> engine;
+	engine.push_back(engine_bench<PipelinedProcessor>("pipelined", runs));
+	engine.push_back(engine_bench<SpeculativeProcessor>("speculative", runs));
+	engine.push_back(engine_bench<IOSuperscalarProcessor>("io-superscalar", runs));
+	engine.push_back(engine_bench<PipelinedProcessor>("pipelined, 20-cycle memory", runs, 20));
+	printf("\n%-28s %18s %8s\n", "engine", "Mcycles/s", "IPC");
+	for (size_t e = 0; e < engine.size(); e++) {
+		printf("%-28s %9.2f +/- %5.2f %8.4f\n", engine[e].name.c_str(), engine[e].cycleRate.median / 1e6, engine[e].cycleRate.stddev / 1e6, engine[e].ipc);
+	}
+	if (!json.empty()) {
+		write_json(json, results, engine, runs);
+	}
+	return results.size() == sizeof(models) / sizeof(models[0]) * kernels.size() ? 0 : 1;
+}
@@ -0,0 +1,64 @@
+# Bitwise CRC-32 (reflected, polynomial 0xEDB88320). The ISA has no XOR, so
+# a ^ b is computed as (a | b) & ~(a & b).
+# Result: $v0 = CRC of the test string (0x414FA339),
+#         $v1 = CRC of 1024 bytes with byte i = 7 * i + 3 (0x5D3DE8ED)
+
+        .data
+message: .asciiz "The quick brown fox jumps over the lazy dog"
+        .align 2
+buffer: .space 1024
+
+        .text
+        li $sp, 0x3fff0
+        la $a0, message
+        li $a1, 43
+        jal crc32
+        move $s0, $v0
+
+        la $s1, buffer
+        li $t0, 0
+fill:   sll $t1, $t0, 3         # 7 * i + 3
+        subu $t1, $t1, $t0
+        addiu $t1, $t1, 3
+        addu $t2, $s1, $t0
+        sb $t1, 0($t2)
+        addiu $t0, $t0, 1
+        li $t3, 1024
+        bne $t0, $t3, fill
+        move $a0, $s1
+        li $a1, 1024
+        jal crc32
+        move $v1, $v0
+        move $v0, $s0
+        j done
+
+# CRC-32 of the $a1 bytes at $a0
+crc32:  li $v0, -1
+        li $t8, 0xEDB88320
+crc_byte:
+        beqz $a1, crc_end
+        lbu $t0, 0($a0)
+        or $t1, $v0, $t0        # crc ^= byte
+        and $t2, $v0, $t0
+        nor $t2, $t2, $t2
+        and $v0, $t1, $t2
+        li $t3, 8
+crc_bit:
+        andi $t4, $v0, 1
+        srl $v0, $v0, 1
+        subu $t4, $zero, $t4    # all ones if the low bit was set
+        and $t4, $t4, $t8
+        or $t1, $v0, $t4        # crc ^= polynomial
+        and $t2, $v0, $t4
+        nor $t2, $t2, $t2
+        and $v0, $t1, $t2
+        addiu $t3, $t3, -1
+        bnez $t3, crc_bit
+        addiu $a0, $a0, 1
+        addiu $a1, $a1, -1
+        b crc_byte
+crc_end:
+        nor $v0, $v0, $v0
+        jr $ra
+
+done:   nop
@@ -0,0 +1,37 @@
+# Linked-list traversal. 1024 nodes of {value, next} are linked in the
+# scattered order node (k * 389) mod 1024 for k = 0, 1, ..., with value k,
+# then the list is walked 16 times.
+# Result: $v0 = sum of the values over all walks (8380416)
+
+        .data
+nodes:  .space 8192
+
+        .text
+        la $s0, nodes
+        li $s1, 1024
+        li $t0, 0               # k
+build:  li $t9, 389
+        mul $t1, $t0, $t9
+        andi $t1, $t1, 1023     # this node
+        addiu $t2, $t0, 1
+        mul $t2, $t2, $t9
+        andi $t2, $t2, 1023     # the next one
+        sll $t1, $t1, 3
+        addu $t1, $t1, $s0
+        sll $t2, $t2, 3
+        addu $t2, $t2, $s0
+        sw $t0, 0($t1)
+        sw $t2, 4($t1)
+        addiu $t0, $t0, 1
+        bne $t0, $s1, build
+        sw $zero, 4($t1)        # the last node ends the list
+
+        li $v0, 0
+        li $s2, 16              # walks
+walk:   move $t0, $s0           # node 0 comes first
+visit:  lw $t1, 0($t0)
+        addu $v0, $v0, $t1
+        lw $t0, 4($t0)
+        bnez $t0, visit
+        addiu $s2, $s2, -1
+        bnez $s2, walk
@@ -0,0 +1,64 @@
+# Matrix multiply: C = A x B for 16x16 word matrices with A[i][j] = i + j
+# and B[i][j] = i * j + 1, row-major, naive i-j-k loops.
+# Result: $v0 = sum of the elements of C (4170240)
+# The multiply is marked as the region of interest, --roi-fast-forward runs
+# only it in detail.
+
+        .data
+A:      .space 1024
+B:      .space 1024
+C:      .space 1024
+
+        .text
+        li $s0, 16              # N
+        la $s1, A
+        la $s2, B
+        la $s3, C
+
+        li $t0, 0               # i
+fill_i: li $t1, 0               # j
+fill_j: sll $t2, $t0, 4         # (i * N + j) * 4
+        addu $t2, $t2, $t1
+        sll $t2, $t2, 2
+        addu $t3, $t0, $t1
+        addu $t4, $s1, $t2
+        sw $t3, 0($t4)          # A[i][j] = i + j
+        mul $t3, $t0, $t1
+        addiu $t3, $t3, 1
+        addu $t4, $s2, $t2
+        sw $t3, 0($t4)          # B[i][j] = i * j + 1
+        addiu $t1, $t1, 1
+        bne $t1, $s0, fill_j
+        addiu $t0, $t0, 1
+        bne $t0, $s0, fill_i
+
+        lui $s7, 0xffff         # counter page
+        sw $zero, 16($s7)       # ROI begin
+        li $v0, 0
+        li $t0, 0               # i
+mul_i:  li $t1, 0               # j
+mul_j:  li $t5, 0               # C[i][j]
+        li $t2, 0               # k
+        sll $t6, $t0, 6         # &A[i][0]
+        addu $t6, $t6, $s1
+        sll $t7, $t1, 2         # &B[0][j]
+        addu $t7, $t7, $s2
+mul_k:  lw $t3, 0($t6)
+        lw $t4, 0($t7)
+        mul $t3, $t3, $t4
+        addu $t5, $t5, $t3
+        addiu $t6, $t6, 4       # next column of A
+        addiu $t7, $t7, 64      # next row of B
+        addiu $t2, $t2, 1
+        bne $t2, $s0, mul_k
+        sll $t8, $t0, 4
+        addu $t8, $t8, $t1
+        sll $t8, $t8, 2
+        addu $t8, $t8, $s3
+        sw $t5, 0($t8)
+        addu $v0, $v0, $t5
+        addiu $t1, $t1, 1
+        bne $t1, $s0, mul_j
+        addiu $t0, $t0, 1
+        bne $t0, $s0, mul_i
+        sw $zero, 20($s7)       # ROI end
@@ -0,0 +1,85 @@
+# Recursive quicksort (Lomuto partition) of 512 pseudo-random words from a
+# linear congruential generator, followed by a check of the order.
+# Result: $v0 = 1 if the array is sorted, $v1 = its median element (32368)
+
+        .data
+array:  .space 2048
+        .space 8192             # stack, in .data so it moves with the program
+stack:
+
+        .text
+        la $sp, stack
+        la $s0, array
+        li $s1, 512
+        li $t1, 12345           # x
+        li $t2, 1103515245
+        li $t3, 12345
+        li $t0, 0
+gen:    mul $t1, $t1, $t2       # x = x * 1103515245 + 12345
+        addu $t1, $t1, $t3
+        srl $t4, $t1, 16
+        sll $t5, $t0, 2
+        addu $t5, $t5, $s0
+        sw $t4, 0($t5)
+        addiu $t0, $t0, 1
+        bne $t0, $s1, gen
+
+        move $a0, $s0           # first element
+        sll $a1, $s1, 2
+        addu $a1, $a1, $s0
+        addiu $a1, $a1, -4      # last element
+        move $s2, $a1
+        jal quicksort
+
+        li $v0, 1
+        move $t0, $s0
+check:  beq $t0, $s2, checked
+        lw $t1, 0($t0)
+        lw $t2, 4($t0)
+        sltu $t3, $t2, $t1
+        beqz $t3, ordered
+        li $v0, 0
+ordered: addiu $t0, $t0, 4
+        b check
+checked: lw $v1, 1024($s0)
+        j done
+
+# Sorts the words from $a0 to $a1 inclusive
+quicksort:
+        sltu $t0, $a0, $a1
+        beqz $t0, qs_return
+        addiu $sp, $sp, -16
+        sw $ra, 0($sp)
+        sw $a0, 4($sp)
+        sw $a1, 8($sp)
+        lw $t1, 0($a1)          # pivot
+        addiu $t2, $a0, -4      # last element not above the pivot
+        move $t3, $a0
+qs_scan: beq $t3, $a1, qs_place
+        lw $t4, 0($t3)
+        sltu $t5, $t1, $t4
+        bnez $t5, qs_next
+        addiu $t2, $t2, 4       # swap it down
+        lw $t6, 0($t2)
+        sw $t4, 0($t2)
+        sw $t6, 0($t3)
+qs_next: addiu $t3, $t3, 4
+        b qs_scan
+qs_place:
+        addiu $t2, $t2, 4       # the pivot goes here
+        lw $t6, 0($t2)
+        sw $t1, 0($t2)
+        sw $t6, 0($a1)
+        sw $t2, 12($sp)
+        addiu $a1, $t2, -4
+        jal quicksort           # below the pivot
+        lw $t2, 12($sp)
+        lw $a1, 8($sp)
+        addiu $a0, $t2, 4
+        jal quicksort           # above the pivot
+        lw $ra, 0($sp)
+        addiu $sp, $sp, 16
+qs_return:
+        jr $ra
+
+done:   nop
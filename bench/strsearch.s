@@ -0,0 +1,84 @@
+# Naive string search. Counts "the" in a paragraph of text, then "acgt" in
+# 4096 letters drawn from "acgt" by a linear congruential generator.
+# Result: $v0 = matches in the paragraph (10), $v1 = matches in the letters (22)
+
+        .data
+paragraph:
+        .ascii "It was the best of times, it was the worst of times, it was the age "
+        .ascii "of wisdom, it was the age of foolishness, it was the epoch of belief, "
+        .ascii "it was the epoch of incredulity, it was the season of Light, it was "
+        .asciiz "the season of Darkness, it was the spring of hope, it was the winter of despair."
+word:   .asciiz "the"
+bases:  .ascii "acgt"
+motif:  .asciiz "acgt"
+letters: .space 4096
+
+        .text
+        li $sp, 0x3fff0
+        la $a0, paragraph
+        jal strlen
+        move $a1, $v0
+        la $a0, paragraph
+        la $a2, word
+        li $a3, 3
+        jal search
+        move $s0, $v0
+
+        la $s1, letters
+        la $s2, bases
+        li $t1, 12345           # x
+        li $t2, 1103515245
+        li $t3, 12345
+        li $t0, 0
+        li $t7, 4096
+gen:    mul $t1, $t1, $t2       # x = x * 1103515245 + 12345
+        addu $t1, $t1, $t3
+        srl $t4, $t1, 16
+        andi $t4, $t4, 3
+        addu $t4, $t4, $s2
+        lbu $t5, 0($t4)
+        addu $t6, $s1, $t0
+        sb $t5, 0($t6)
+        addiu $t0, $t0, 1
+        bne $t0, $t7, gen
+        move $a0, $s1
+        li $a1, 4096
+        la $a2, motif
+        li $a3, 4
+        jal search
+        move $v1, $v0
+        move $v0, $s0
+        j done
+
+# Length of the string at $a0
+strlen: move $v0, $a0
+sl_next: lbu $t0, 0($v0)
+        beqz $t0, sl_end
+        addiu $v0, $v0, 1
+        b sl_next
+sl_end: subu $v0, $v0, $a0
+        jr $ra
+
+# Occurrences of the $a3 bytes at $a2 in the $a1 bytes at $a0
+search: li $v0, 0
+        move $t1, $a0           # candidate start
+        subu $t9, $a1, $a3
+        addiu $t9, $t9, 1
+        addu $t9, $t9, $a0      # past the last start
+s_start: beq $t1, $t9, s_done
+        li $t2, 0
+s_compare:
+        beq $t2, $a3, s_match
+        addu $t3, $t1, $t2
+        lbu $t4, 0($t3)
+        addu $t5, $a2, $t2
+        lbu $t6, 0($t5)
+        bne $t4, $t6, s_next
+        addiu $t2, $t2, 1
+        b s_compare
+s_match: addiu $v0, $v0, 1
+s_next: addiu $t1, $t1, 1
+        b s_start
+s_done: jr $ra
+
+done:   nop
@@ -0,0 +1,192 @@
+#ifndef CHECKER
+#define CHECKER
+#include <cstdint>
+#include <string>
+#include <sstream>
+#include "memory.h"
+#include "reg_file.h"
+#include "functional.h"
+
+// Lockstep co-simulation for --check. The checker keeps its own copy of the
+// registers and memory and steps the functional model once for every
+// instruction the timing model retires. It compares the PC, the register
+// written and its value, and the address and data of stores. The first
+// divergence is kept for the main loop to report. The golden model only runs
+// at retirement, so the cost is one functional step per instruction.
+
+// What an instruction did, as seen when it retires
+struct Retirement {
+	uint32_t pc;
+	uint32_t dest;    //register written back, 0 for none
+	uint32_t value;
+	bool store;
+	uint32_t address; //of a store
+	uint32_t data;    //register a store writes from, SB and SH store its low bits
+};
+
+class LockstepChecker {
+	private:
+		Registers regs;
+		Memory memory;
+		FunctionalCore core;
+		uint32_t end_pc;
+		uint64_t retired;
+		bool failed;
+		std::string reason;
+
+		static std::string hex(uint32_t v) {
+			std::ostringstream out;
+			out << "0x" << std::hex << v;
+			return out.str();
+		}
+
+		//What the timing model did differently
+		enum Mismatch {
+			PAST_END,     //retired past the end of the program
+			PC,
+			DEST,         //wrote another register
+			VALUE,
+			STORE,        //stored or not
+			ADDRESS,
+			DATA
+		};
+
+		// Records the first divergence, the message is only built then so the
+		// comparisons stay cheap
+		bool diverge(Mismatch what, uint32_t pc, uint32_t got, uint32_t expected) {
+			uint32_t instruction;
+			memory.access(pc, instruction, 0, 1, 0);
+			std::ostringstream out;
+			out << "instruction " << retired << " at PC " << hex(pc) << " (" << hex(instruction) << "): ";
+			switch (what) {
+				case PAST_END:
+					out << "retired past the end of the program";
+					break;
+				case PC:
+					out << "retired PC " << hex(got) << ", expected " << hex(expected);
+					break;
+				case DEST:
+					out << "wrote R" << got << ", expected R" << expected;
+					break;
+				case VALUE:
+					out << "wrote " << hex(got) << " to R" << core.written << ", expected " << hex(expected);
+					break;
+				case STORE:
+					out << (got ? "stored, expected no store" : "did not store");
+					break;
+				case ADDRESS:
+					out << "stored to " << hex(got) << ", expected " << hex(expected);
+					break;
+				case DATA:
+					out << "stored " << hex(got) << ", expected " << hex(expected);
+					break;
+			}
+			reason = out.str();
+			failed = true;
+			return false;
+		}
+
+		uint32_t reg(uint32_t r) {
+			uint32_t value, dummy;
+			regs.access(r, 0, value, dummy, 0, 0, 0);
+			return value;
+		}
+
+	public:
+		LockstepChecker(const Registers &reg_file, const Memory &memory, uint32_t end_pc) :
+				regs(reg_file), memory(memory), core(regs, this->memory), end_pc(end_pc), retired(0), failed(false) {
+			this->memory.counters = NULL; //counter page reads are taken from the timing model, its ROI markers are its own
+		}
+
+		// Steps the golden model over the next instruction and compares it with
+		// what the timing model retired, false on a divergence
+		bool retire(const Retirement &timing) {
+			if (failed) {
+				return false;
+			}
+			uint32_t pc = regs.pc;
+			if (pc == end_pc) {
+				return diverge(PAST_END, timing.pc, 0, 0);
+			}
+			if (timing.pc != pc) {
+				return diverge(PC, pc, timing.pc, pc);
+			}
+			core.step();
+			retired++;
+
+			uint32_t dest = core.written;
+			if (core.counterRead && dest != 0) {
+				//Counters depend on timing, the golden model takes what the timing model read
+				uint32_t dummy;
+				regs.access(0, 0, dummy, dummy, dest, true, timing.value);
+			}
+			//One test on the common path, which comparison failed is only worked out on a divergence
+			bool stored = core.stored;
+			bool storeSame = (timing.address == core.storeAddress) & (((timing.data ^ core.storeData) & core.storeMask) == 0);
+			bool same = (timing.dest == dest) & ((dest == 0) | (timing.value == reg(dest))) & (timing.store == stored) & (storeSame || !stored);
+			if (same) {
+				return true;
+			}
+			if (timing.dest != dest) {
+				return diverge(DEST, pc, timing.dest, dest);
+			}
+			if (dest != 0 && timing.value != reg(dest)) {
+				return diverge(VALUE, pc, timing.value, reg(dest));
+			}
+			if (timing.store != stored) {
+				return diverge(STORE, pc, timing.store, stored);
+			}
+			if (timing.address != core.storeAddress) {
+				return diverge(ADDRESS, pc, timing.address, core.storeAddress);
+			}
+			uint32_t mask = core.storeMask;
+			return diverge(DATA, pc, timing.data & mask, core.storeData & mask);
+		}
+
+		// Compares the final architectural state once the timing model is done
+		bool finish(Registers &reg_file, Memory &timingMemory) {
+			if (failed) {
+				return false;
+			}
+			std::string what;
+			if (regs.pc != end_pc) {
+				what = "the run ended at PC " + hex(regs.pc) + " of the functional model";
+			}
+			for (uint32_t r = 1; r < 32 && what.empty(); r++) {
+				uint32_t value, dummy;
+				reg_file.access(r, 0, value, dummy, 0, 0, 0);
+				if (value != reg(r)) {
+					what = "final R" + std::to_string(r) + " is " + hex(value) + ", expected " + hex(reg(r));
+				}
+			}
+			if (what.empty() && (reg_file.hi != regs.hi || reg_file.lo != regs.lo)) {
+				what = "final HI/LO are " + hex(reg_file.hi) + "/" + hex(reg_file.lo) + ", expected " + hex(regs.hi) + "/" + hex(regs.lo);
+			}
+			for (uint32_t w = 0; w < memory.words() && what.empty(); w++) {
+				if (*timingMemory.data(w) != *memory.data(w)) {
+					what = "final word at " + hex(4 * w) + " is " + hex(*timingMemory.data(w)) + ", expected " + hex(*memory.data(w));
+				}
+			}
+			if (!what.empty()) {
+				std::ostringstream out;
+				out << "after " << retired << " instructions: " << what;
+				reason = out.str();
+				failed = true;
+			}
+			return !failed;
+		}
+
+		bool diverged() const {
+			return failed;
+		}
+
+		uint64_t checked() const {
+			return retired;
+		}
+
+		const std::string &divergence() const {
+			return reason;
+		}
+};
+
+#endif
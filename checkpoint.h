@@ -0,0 +1,202 @@
+#ifndef CHECKPOINT
+#define CHECKPOINT
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "memory.h"
+#include "reg_file.h"
+
+// Checkpoint files. Every section starts on a page boundary so a restore maps
+// the file and copies the saved memory pages straight out of the mapping:
+//   CheckpointHeader
+//   core state - the processor model's Snapshot (latches, predictor, ...) as raw bytes
+//   page table - word index of every memory page that is not all zero
+//   pages      - CHECKPOINT_PAGE_WORDS words per page, in page table order
+// CHECKPOINT_VERSION must be bumped whenever this layout or a Snapshot changes.
+
+static const uint32_t CHECKPOINT_VERSION = 3;
+static const uint32_t CHECKPOINT_PAGE_WORDS = 1024;
+static const uint32_t CHECKPOINT_ALIGN = 4096;
+
+struct CheckpointHeader {
+	char magic[8];         //"MIPSCKPT"
+	uint32_t version;
+	uint32_t headerSize;
+	char model[32];        //--processor the checkpoint was taken with
+	uint64_t cycles;       //cycles simulated before the checkpoint
+	uint64_t instructions; //instructions committed before the checkpoint
+	uint32_t end_pc;
+	uint32_t pc;
+	uint32_t hi;
+	uint32_t lo;
+	uint32_t R[32];
+	uint32_t memoryWords;
+	uint32_t numPages;
+	uint64_t coreOffset;
+	uint64_t coreSize;
+	uint64_t tableOffset;
+	uint64_t pagesOffset;
+};
+
+inline uint64_t checkpoint_align(uint64_t offset) {
+	return (offset + CHECKPOINT_ALIGN - 1) / CHECKPOINT_ALIGN * CHECKPOINT_ALIGN;
+}
+
+// Writes a checkpoint of the architectural state plus coreSize bytes of
+// processor state, returns false if the file could not be written
+inline bool write_checkpoint(const std::string &path, const std::string &model, Registers &reg_file, Memory &memory, uint32_t end_pc,
+		uint64_t cycles, uint64_t instructions, const void *core, uint64_t coreSize) {
+	CheckpointHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "MIPSCKPT", 8);
+	header.version = CHECKPOINT_VERSION;
+	header.headerSize = sizeof(header);
+	strncpy(header.model, model.c_str(), sizeof(header.model) - 1);
+	header.cycles = cycles;
+	header.instructions = instructions;
+	header.end_pc = end_pc;
+	header.pc = reg_file.pc;
+	header.hi = reg_file.hi;
+	header.lo = reg_file.lo;
+	for (int i = 0; i < 32; i++) {
+		uint32_t dummy;
+		reg_file.access(i, 0, header.R[i], dummy, 0, false, 0);
+	}
+	header.memoryWords = memory.words();
+
+	//Only pages holding a non-zero word are saved
+	std::vector<uint32_t> table;
+	for (uint32_t page = 0; page < memory.words(); page += CHECKPOINT_PAGE_WORDS) {
+		const uint32_t *words = memory.data(page);
+		uint32_t length = std::min(CHECKPOINT_PAGE_WORDS, memory.words() - page);
+		for (uint32_t i = 0; i < length; i++) {
+			if (words[i] != 0) {
+				table.push_back(page);
+				break;
+			}
+		}
+	}
+	header.numPages = table.size();
+	header.coreOffset = checkpoint_align(sizeof(header));
+	header.coreSize = coreSize;
+	header.tableOffset = checkpoint_align(header.coreOffset + coreSize);
+	header.pagesOffset = checkpoint_align(header.tableOffset + table.size() * sizeof(uint32_t));
+
+	FILE *file = fopen(path.c_str(), "wb");
+	if (!file) {
+		return false;
+	}
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	ok = ok && fseek(file, header.coreOffset, SEEK_SET) == 0 && (coreSize == 0 || fwrite(core, coreSize, 1, file) == 1);
+	ok = ok && fseek(file, header.tableOffset, SEEK_SET) == 0 && (table.empty() || fwrite(&table[0], sizeof(uint32_t), table.size(), file) == table.size());
+	ok = ok && fseek(file, header.pagesOffset, SEEK_SET) == 0;
+	std::vector<uint32_t> page(CHECKPOINT_PAGE_WORDS, 0);
+	for (size_t i = 0; ok && i < table.size(); i++) {
+		uint32_t length = std::min(CHECKPOINT_PAGE_WORDS, memory.words() - table[i]);
+		std::copy(memory.data(table[i]), memory.data(table[i]) + length, page.begin());
+		ok = fwrite(&page[0], sizeof(uint32_t), CHECKPOINT_PAGE_WORDS, file) == CHECKPOINT_PAGE_WORDS;
+	}
+	return fclose(file) == 0 && ok;
+}
+
+// A checkpoint file mapped read-only
+class Checkpoint {
+	private:
+		void *map;
+		size_t length;
+
+		const CheckpointHeader &header() const {
+			return *(const CheckpointHeader *)map;
+		}
+
+	public:
+		Checkpoint() : map(MAP_FAILED), length(0) {}
+
+		~Checkpoint() {
+			if (map != MAP_FAILED) {
+				munmap(map, length);
+			}
+		}
+
+		// Maps and validates a checkpoint, on failure returns false with the reason in error
+		bool open(const std::string &path, std::string &error) {
+			int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0) {
+				error = "cannot open " + path;
+				return false;
+			}
+			struct stat st;
+			if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CheckpointHeader)) {
+				close(fd);
+				error = path + " is not a checkpoint";
+				return false;
+			}
+			length = st.st_size;
+			map = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+			close(fd);
+			if (map == MAP_FAILED) {
+				error = "cannot map " + path;
+				return false;
+			}
+
+			const CheckpointHeader &h = header();
+			if (memcmp(h.magic, "MIPSCKPT", 8) != 0) {
+				error = path + " is not a checkpoint";
+				return false;
+			}
+			if (h.version != CHECKPOINT_VERSION || h.headerSize != sizeof(CheckpointHeader)) {
+				error = path + " has an unsupported checkpoint version";
+				return false;
+			}
+			if (h.coreOffset + h.coreSize > length || h.tableOffset + (uint64_t)h.numPages * sizeof(uint32_t) > length ||
+					h.pagesOffset + (uint64_t)h.numPages * CHECKPOINT_PAGE_WORDS * sizeof(uint32_t) > length) {
+				error = path + " is truncated";
+				return false;
+			}
+			return true;
+		}
+
+		const CheckpointHeader &info() const {
+			return header();
+		}
+
+		const void *core() const {
+			return (const char *)map + header().coreOffset;
+		}
+
+		// Loads the registers, PC and memory, returns false if the memory sizes differ
+		bool restore(Registers &reg_file, Memory &memory) const {
+			const CheckpointHeader &h = header();
+			if (h.memoryWords != memory.words()) {
+				return false;
+			}
+			uint32_t dummy1, dummy2;
+			for (int i = 1; i < 32; i++) {
+				reg_file.access(0, 0, dummy1, dummy2, i, true, h.R[i]);
+			}
+			reg_file.pc = h.pc;
+			reg_file.hi = h.hi;
+			reg_file.lo = h.lo;
+
+			std::fill(memory.data(0), memory.data(0) + memory.words(), 0);
+			const uint32_t *table = (const uint32_t *)((const char *)map + h.tableOffset);
+			const uint32_t *pages = (const uint32_t *)((const char *)map + h.pagesOffset);
+			for (uint32_t i = 0; i < h.numPages; i++) {
+				if (table[i] >= memory.words()) {
+					return false;
+				}
+				uint32_t words = std::min(CHECKPOINT_PAGE_WORDS, memory.words() - table[i]);
+				std::copy(pages + (uint64_t)i * CHECKPOINT_PAGE_WORDS, pages + (uint64_t)i * CHECKPOINT_PAGE_WORDS + words, memory.data(table[i]));
+			}
+			return true;
+		}
+};
+
+#endif
@@ -0,0 +1,249 @@
+#ifndef COHERENCE
+#define COHERENCE
+#include <cstdint>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include "memory.h"
+#include "control.h"
+#include "datapath.h"
+#include "options.h"
+
+// Private L1 data caches of a multicore run kept coherent by a full-map
+// directory with MESI (or MSI) line states. The caches only hold tags and
+// states, the data itself always lives in the shared Memory, so they decide
+// how long an access takes but never what it returns.
+//
+// Each core is driven by one host thread. Everything about a line - the
+// directory entry and its copy in every L1 - is guarded by the lock of its L1
+// set. All caches have the same geometry, so a victim always falls in the
+// same set as the line replacing it and one lock covers a whole transaction.
+// Counters belong to the core that made the request and are only touched by
+// its thread.
+
+enum line_state {
+	LINE_INVALID,
+	LINE_SHARED,
+	LINE_EXCLUSIVE,
+	LINE_MODIFIED
+};
+
+// Coherence traffic caused by one core's accesses
+struct CoherenceStats {
+	uint64_t reads;
+	uint64_t writes;
+	uint64_t readMisses;
+	uint64_t writeMisses;
+	uint64_t upgrades;      //writes to a Shared line
+	uint64_t invalidations; //copies removed from other caches
+	uint64_t transfers;     //misses served from another cache's modified copy
+	uint64_t writebacks;    //modified lines written back to memory, evictions included
+
+	CoherenceStats() : reads(0), writes(0), readMisses(0), writeMisses(0), upgrades(0), invalidations(0), transfers(0), writebacks(0) {}
+
+	void add(const CoherenceStats &other) {
+		reads += other.reads;
+		writes += other.writes;
+		readMisses += other.readMisses;
+		writeMisses += other.writeMisses;
+		upgrades += other.upgrades;
+		invalidations += other.invalidations;
+		transfers += other.transfers;
+		writebacks += other.writebacks;
+	}
+
+	double hit_rate() const {
+		uint64_t accesses = reads + writes;
+		return accesses == 0 ? 0 : 1.0 - (double)(readMisses + writeMisses + upgrades) / accesses;
+	}
+};
+
+class CoherentMemory {
+	private:
+		struct CacheLine {
+			uint32_t line;    //memory line number, the tag
+			uint32_t state;   //line_state
+			uint64_t lastUse; //for LRU replacement
+		};
+
+		struct DirectoryEntry {
+			uint32_t sharers;   //bit per core holding a copy
+			bool exclusive;     //the only sharer holds it Exclusive or Modified
+		};
+
+		// Per-core data written by that core's thread, padded apart
+		struct alignas(64) CoreState {
+			CoherenceStats stats;
+			uint64_t useClock;
+		};
+
+		Memory &memory;
+		CacheConfig config;
+		unsigned cores;
+		uint32_t sets;
+		std::vector<CacheLine> lines;          //cores x sets x ways
+		std::vector<DirectoryEntry> directory; //one entry per memory line
+		std::vector<CoreState> coreState;
+		std::vector<std::mutex> locks;         //one per set
+
+		CacheLine *set_of(unsigned core, uint32_t set) {
+			return &lines[((uint64_t)core * sets + set) * config.ways];
+		}
+
+		CacheLine *find(unsigned core, uint32_t set, uint32_t line) {
+			CacheLine *ways = set_of(core, set);
+			for (uint32_t w = 0; w < config.ways; w++) {
+				if (ways[w].state != LINE_INVALID && ways[w].line == line) {
+					return &ways[w];
+				}
+			}
+			return NULL;
+		}
+
+		//Removes the copies of every core in sharers
+		void invalidate(uint32_t sharers, uint32_t set, uint32_t line, CoherenceStats &stats) {
+			for (unsigned c = 0; c < cores; c++) {
+				if ((sharers & (1u << c)) == 0) {
+					continue;
+				}
+				CacheLine *copy = find(c, set, line);
+				if (copy) {
+					if (copy->state == LINE_MODIFIED) {
+						stats.writebacks++;
+					}
+					copy->state = LINE_INVALID;
+					stats.invalidations++;
+				}
+			}
+		}
+
+		//Makes room for line in the core's set, an invalid way or else the least recently used one
+		CacheLine *allocate(unsigned core, uint32_t set, CoherenceStats &stats) {
+			CacheLine *ways = set_of(core, set);
+			CacheLine *victim = &ways[0];
+			for (uint32_t w = 0; w < config.ways; w++) {
+				if (ways[w].state == LINE_INVALID) {
+					return &ways[w];
+				}
+				if (ways[w].lastUse < victim->lastUse) {
+					victim = &ways[w];
+				}
+			}
+			DirectoryEntry &entry = directory[victim->line % directory.size()];
+			entry.sharers &= ~(1u << core);
+			entry.exclusive = false;
+			if (victim->state == LINE_MODIFIED) {
+				stats.writebacks++;
+			}
+			victim->state = LINE_INVALID;
+			return victim;
+		}
+
+	public:
+		CoherentMemory(Memory &memory, unsigned cores, const CacheConfig &config) :
+				memory(memory), config(config), cores(cores), coreState(cores) {
+			sets = std::max<uint32_t>(1, config.size / (config.ways * config.lineBytes));
+			CacheLine invalid = {0, LINE_INVALID, 0};
+			lines.assign((uint64_t)cores * sets * config.ways, invalid);
+			DirectoryEntry empty = {0, false};
+			directory.assign(std::max<uint64_t>(1, (uint64_t)memory.words() * 4 / config.lineBytes), empty);
+			std::vector<std::mutex>(sets).swap(locks);
+			for (unsigned c = 0; c < cores; c++) {
+				coreState[c].useClock = 0;
+			}
+		}
+
+		// Runs the coherence transaction for a data access of core and
+		// returns the cycles it spends in MEM
+		uint32_t transaction(unsigned core, uint32_t address, bool write) {
+			uint32_t line = address / config.lineBytes;
+			uint32_t set = line % sets;
+			uint32_t self = 1u << core;
+			CoreState &state = coreState[core];
+			CoherenceStats &stats = state.stats;
+			std::lock_guard<std::mutex> guard(locks[set]);
+			DirectoryEntry &entry = directory[line % directory.size()];
+			(write ? stats.writes : stats.reads)++;
+
+			CacheLine *copy = find(core, set, line);
+			if (copy) {
+				copy->lastUse = ++state.useClock;
+				if (!write || copy->state != LINE_SHARED) {
+					if (write) {
+						copy->state = LINE_MODIFIED; //Exclusive to Modified is silent
+					}
+					return config.hitLatency;
+				}
+				//Write to a Shared copy: invalidate the others
+				stats.upgrades++;
+				invalidate(entry.sharers & ~self, set, line, stats);
+				copy->state = LINE_MODIFIED;
+				entry.sharers = self;
+				entry.exclusive = true;
+				return config.upgradeLatency;
+			}
+
+			(write ? stats.writeMisses : stats.readMisses)++;
+			uint32_t latency = config.memoryLatency;
+			uint32_t others = entry.sharers & ~self;
+			if (entry.exclusive && others != 0) {
+				//Another core owns the line, it supplies it if modified
+				for (unsigned c = 0; c < cores; c++) {
+					CacheLine *owner = (others & (1u << c)) ? find(c, set, line) : NULL;
+					if (!owner) {
+						continue;
+					}
+					if (owner->state == LINE_MODIFIED) {
+						stats.transfers++;
+						if (!write) {
+							stats.writebacks++; //memory is updated as the owner drops to Shared
+						}
+						latency = config.transferLatency;
+					}
+					if (write) {
+						owner->state = LINE_INVALID;
+						stats.invalidations++;
+					}
+					else {
+						owner->state = LINE_SHARED;
+					}
+				}
+				entry.exclusive = false;
+			}
+			if (write) {
+				invalidate(others, set, line, stats);
+				entry.sharers = 0;
+				others = 0;
+			}
+
+			copy = allocate(core, set, stats);
+			copy->line = line;
+			copy->lastUse = ++state.useClock;
+			if (write) {
+				copy->state = LINE_MODIFIED;
+				entry.exclusive = true;
+			}
+			else if (config.mesi && others == 0) {
+				copy->state = LINE_EXCLUSIVE;
+				entry.exclusive = true;
+			}
+			else {
+				copy->state = LINE_SHARED;
+				entry.exclusive = false;
+			}
+			entry.sharers |= self;
+			return latency;
+		}
+
+		// The data access itself, atomic with respect to the other cores
+		uint32_t access(const control_t &control, uint32_t address, uint32_t storeData) {
+			std::lock_guard<std::mutex> guard(locks[(address / config.lineBytes) % sets]);
+			return memory_stage(memory, control, address, storeData);
+		}
+
+		const CoherenceStats &stats(unsigned core) const {
+			return coreState[core].stats;
+		}
+};
+
+#endif
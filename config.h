@@ -0,0 +1,402 @@
+#ifndef CONFIG
+#define CONFIG
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include "options.h"
+#include "predictor.h"
+#include "json.h"
+
+// Registry of the microarchitecture parameters. Every field of PipelineConfig
+// and CacheConfig the models read at construction is registered under a
+// section.name key, so runs can set them from a --config file and --set
+// overrides instead of recompiling. Values are checked as they are set, and a
+// run rejects the keys it was given that its model does not read (cache
+// parameters without --cores, say). The pipeline width is deliberately not a
+// parameter: it is the Width template argument of InOrderPipeline, fixed at
+// compile time by the model --processor picks, so the lanes unroll. A sweep
+// over widths sweeps --processor instead.
+//
+// A config file is INI:
+//   [predictor]
+//   bht_entries = 1024   ; comments start with ; or #
+// or a JSON object of sections, or of full keys:
+//   {"predictor": {"bht_entries": 1024}, "smt.fetch": "rr"}
+// ini() writes the effective configuration back in the INI form, with what
+// each parameter does as a comment. --print-config prints it, and the
+// --stats-interval records start with it. hash() names it in the sweep results.
+
+// FNV-1a of text, in hex
+inline std::string fnv_hex(const std::string &text) {
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < text.size(); i++) {
+		hash = (hash ^ (unsigned char)text[i]) * 1099511628211ull;
+	}
+	char out[17];
+	snprintf(out, sizeof(out), "%016llx", (unsigned long long)hash);
+	return out;
+}
+
+// Which runs read a parameter
+enum param_scope {
+	SCOPE_PIPELINE,  //the pipeline models
+	SCOPE_PREDICTOR, //the models with a branch predictor, speculative and io-superscalar
+	SCOPE_SMT,       //--smt runs
+	SCOPE_CACHE,     //--cores runs
+	SCOPES
+};
+
+struct Parameter {
+	std::string section;
+	std::string name;
+	param_scope scope;
+	const char *help;
+	std::function<bool(const std::string &, std::string &)> parse; //sets the field from a value, false with an error
+	std::function<std::string()> show;                               //the field's value in the form parse takes
+	bool given;                                                      //set by a file or --set
+
+	std::string key() const {
+		return section + "." + name;
+	}
+};
+
+class ParameterRegistry {
+	private:
+		std::vector<Parameter> params; //in the order ini() writes them
+		PipelineConfig &pipeline;
+		CacheConfig &cache;
+
+		void add(const char *section, const char *name, param_scope scope, const char *help,
+				std::function<bool(const std::string &, std::string &)> parse, std::function<std::string()> show) {
+			Parameter param = {section, name, scope, help, parse, show, false};
+			params.push_back(param);
+		}
+
+		void add_uint(const char *section, const char *name, param_scope scope, uint32_t &field, uint32_t min, uint32_t max, const char *help) {
+			uint32_t *value = &field;
+			add(section, name, scope, help, [value, min, max](const std::string &text, std::string &error) {
+				char *end;
+				unsigned long long number = strtoull(text.c_str(), &end, 0);
+				if (text.empty() || !isdigit((unsigned char)text[0]) || *end != '\0') {
+					error = "'" + text + "' is not a number";
+					return false;
+				}
+				if (number < min || number > max) {
+					error = text + " is outside " + std::to_string(min) + ".." + std::to_string(max);
+					return false;
+				}
+				*value = number;
+				return true;
+			}, [value]() {
+				return std::to_string(*value);
+			});
+		}
+
+		void add_bool(const char *section, const char *name, param_scope scope, bool &field, const char *help) {
+			bool *value = &field;
+			add(section, name, scope, help, [value](const std::string &text, std::string &error) {
+				if (text == "true" || text == "1" || text == "yes") {
+					*value = true;
+				}
+				else if (text == "false" || text == "0" || text == "no") {
+					*value = false;
+				}
+				else {
+					error = "'" + text + "' is not true or false";
+					return false;
+				}
+				return true;
+			}, [value]() {
+				return std::string(*value ? "true" : "false");
+			});
+		}
+
+		// A field whose value is the index of its name in choices
+		template <class Field>
+		void add_choice(const char *section, const char *name, param_scope scope, Field &field, std::vector<std::string> choices, const char *help) {
+			Field *value = &field;
+			add(section, name, scope, help, [value, choices](const std::string &text, std::string &error) {
+				for (size_t i = 0; i < choices.size(); i++) {
+					if (text == choices[i]) {
+						*value = (Field)i;
+						return true;
+					}
+				}
+				error = "'" + text + "' is not one of";
+				for (size_t i = 0; i < choices.size(); i++) {
+					error += (i ? ", " : " ") + choices[i];
+				}
+				return false;
+			}, [value, choices]() {
+				return choices[(size_t)*value];
+			});
+		}
+
+		// Position of key in params, params.size() if it is unknown
+		size_t index(const std::string &key) const {
+			for (size_t i = 0; i < params.size(); i++) {
+				if (params[i].key() == key) {
+					return i;
+				}
+			}
+			return params.size();
+		}
+
+		static std::string trim(const std::string &text) {
+			size_t first = text.find_first_not_of(" \t\r");
+			if (first == std::string::npos) {
+				return "";
+			}
+			return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+		}
+
+		bool load_ini(const std::string &text, std::string &error) {
+			std::istringstream in(text);
+			std::string line;
+			std::string section;
+			for (unsigned number = 1; std::getline(in, line); number++) {
+				line = trim(line.substr(0, line.find_first_of(";#")));
+				if (line.empty()) {
+					continue;
+				}
+				std::string where = "line " + std::to_string(number) + ": ";
+				if (line[0] == '[') {
+					if (line[line.size() - 1] != ']') {
+						error = where + "unterminated section";
+						return false;
+					}
+					section = trim(line.substr(1, line.size() - 2));
+					continue;
+				}
+				size_t equals = line.find('=');
+				if (equals == std::string::npos) {
+					error = where + "expected key = value";
+					return false;
+				}
+				std::string key = trim(line.substr(0, equals));
+				if (!section.empty()) {
+					key = section + "." + key;
+				}
+				if (!set(key, trim(line.substr(equals + 1)), error)) {
+					error = where + error;
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool load_json(const std::string &text, std::string &error) {
+			JsonReader json(text);
+			bool ok = set_json(json, error);
+			if (ok && !json.done()) {
+				error = "trailing text after the object";
+				ok = false;
+			}
+			if (!ok) {
+				error = "line " + std::to_string(json.line()) + ": " + error;
+			}
+			return ok;
+		}
+
+	public:
+		ParameterRegistry(PipelineConfig &pipeline, CacheConfig &cache) : pipeline(pipeline), cache(cache) {
+			add_uint("pipeline", "mem_latency", SCOPE_PIPELINE, pipeline.memLatency, 1, 1000000, "cycles a data memory access spends in MEM");
+			add_uint("pipeline", "mul_latency", SCOPE_PIPELINE, pipeline.mulLatency, 1, 1000000, "cycles until MFHI/MFLO can use a multiply");
+			add_uint("pipeline", "div_latency", SCOPE_PIPELINE, pipeline.divLatency, 1, 1000000, "same for a divide");
+			add_bool("pipeline", "mul_pipelined", SCOPE_PIPELINE, pipeline.mulPipelined, "the multiplier takes a new operation every cycle");
+			add_bool("pipeline", "div_pipelined", SCOPE_PIPELINE, pipeline.divPipelined, "the divider takes a new operation every cycle");
+			add_uint("predictor", "bht_entries", SCOPE_PREDICTOR, pipeline.bhtEntries, 1, GHR_MAX_ENTRIES, "2-bit counters, a power of two");
+			add_uint("predictor", "history_bits", SCOPE_PREDICTOR, pipeline.historyBits, 0, GHR_MAX_HISTORY, "global history length, at most log2(bht_entries)");
+			add_choice("smt", "fetch", SCOPE_SMT, pipeline.smtFetch, {"rr", "icount", "switch"}, "thread fetched each cycle");
+			add_uint("cache", "size", SCOPE_CACHE, cache.size, 4, 1u << 30, "bytes per L1 data cache");
+			add_uint("cache", "ways", SCOPE_CACHE, cache.ways, 1, 1024, "associativity");
+			add_uint("cache", "line_bytes", SCOPE_CACHE, cache.lineBytes, 4, 4096, "bytes per line, a multiple of 4");
+			add_uint("cache", "hit_latency", SCOPE_CACHE, cache.hitLatency, 1, 1000000, "cycles an L1 hit spends in MEM");
+			add_uint("cache", "memory_latency", SCOPE_CACHE, cache.memoryLatency, 1, 1000000, "a miss served by memory");
+			add_uint("cache", "transfer_latency", SCOPE_CACHE, cache.transferLatency, 1, 1000000, "a miss served from another core's modified copy");
+			add_uint("cache", "upgrade_latency", SCOPE_CACHE, cache.upgradeLatency, 1, 1000000, "a write to a shared line");
+			add_choice("cache", "protocol", SCOPE_CACHE, cache.mesi, {"msi", "mesi"}, "coherence protocol");
+		}
+
+		// Sets key from the text of a value
+		bool set(const std::string &key, const std::string &value, std::string &error) {
+			size_t i = index(key);
+			if (i == params.size()) {
+				error = "unknown parameter " + key;
+				return false;
+			}
+			Parameter *param = &params[i];
+			if (!param->parse(value, error)) {
+				error = key + ": " + error;
+				return false;
+			}
+			param->given = true;
+			return true;
+		}
+
+		// Sets the keys of the JSON object json is at, section prefixes the keys of a nested object
+		bool set_json(JsonReader &json, std::string &error, const std::string &section = "") {
+			if (!json.next('{')) {
+				error = "expected {";
+				return false;
+			}
+			if (json.next('}')) {
+				return true;
+			}
+			do {
+				std::string name;
+				if (!json.string(name) || !json.next(':')) {
+					error = "expected \"key\":";
+					return false;
+				}
+				std::string key = section.empty() ? name : section + "." + name;
+				if (section.empty() && !known(key)) {
+					if (!json.peek('{')) {
+						error = "unknown parameter " + key;
+						return false;
+					}
+					if (!set_json(json, error, key)) {
+						return false;
+					}
+					continue;
+				}
+				std::string value;
+				if (!json.scalar(value)) {
+					error = "expected the value of " + key;
+					return false;
+				}
+				if (!set(key, value, error)) {
+					return false;
+				}
+			} while (json.next(','));
+			if (!json.next('}')) {
+				error = "expected , or }";
+				return false;
+			}
+			return true;
+		}
+
+		// Sets a key=value pair from --set
+		bool set(const std::string &assignment, std::string &error) {
+			size_t equals = assignment.find('=');
+			if (equals == std::string::npos) {
+				error = "expected key=value, got " + assignment;
+				return false;
+			}
+			return set(trim(assignment.substr(0, equals)), trim(assignment.substr(equals + 1)), error);
+		}
+
+		// Loads a config file, JSON if it starts with {, INI otherwise
+		bool load(const std::string &path, std::string &error) {
+			std::ifstream in(path.c_str());
+			if (!in) {
+				error = "cannot open " + path;
+				return false;
+			}
+			std::stringstream text;
+			text << in.rdbuf();
+			std::string content = text.str();
+			bool ok = trim(content).compare(0, 1, "{") == 0 ? load_json(content, error) : load_ini(content, error);
+			if (!ok) {
+				error = path + ": " + error;
+			}
+			return ok;
+		}
+
+		// Checks what depends on more than one parameter, once they are all set
+		bool validate(std::string &error) const {
+			if ((pipeline.bhtEntries & (pipeline.bhtEntries - 1)) != 0) {
+				error = "predictor.bht_entries must be a power of two";
+				return false;
+			}
+			if ((1ull << pipeline.historyBits) > pipeline.bhtEntries) {
+				error = "predictor.history_bits cannot index more than predictor.bht_entries";
+				return false;
+			}
+			if (cache.lineBytes % 4 != 0) {
+				error = "cache.line_bytes must be a multiple of 4";
+				return false;
+			}
+			if ((uint64_t)cache.ways * cache.lineBytes > cache.size) {
+				error = "cache.size must hold at least cache.ways lines";
+				return false;
+			}
+			return true;
+		}
+
+		// Whether a run of model with this many cores and hardware threads reads key
+		bool reads(const std::string &key, const std::string &model, unsigned cores, unsigned smtThreads) const {
+			size_t i = index(key);
+			if (i == params.size()) {
+				return false;
+			}
+			bool pipelineModel = model == "pipelined" || model == "speculative" || model == "io-superscalar";
+			switch (params[i].scope) {
+				case SCOPE_PIPELINE:
+					return pipelineModel;
+				case SCOPE_PREDICTOR:
+					return model == "speculative" || model == "io-superscalar";
+				case SCOPE_SMT:
+					return pipelineModel && smtThreads > 1;
+				default:
+					return pipelineModel && cores > 1;
+			}
+		}
+
+		// What a run needs to read key
+		std::string needs(const std::string &key) const {
+			static const char *const needs[SCOPES] = {"a pipeline model", "the speculative or io-superscalar model", "--smt", "--cores"};
+			size_t i = index(key);
+			return i < params.size() ? needs[params[i].scope] : "";
+		}
+
+		// Fails on the first key given that a run of model with this many cores and
+		// hardware threads does not read
+		bool check_used(const std::string &model, unsigned cores, unsigned smtThreads, std::string &error) const {
+			for (size_t i = 0; i < params.size(); i++) {
+				if (params[i].given && !reads(params[i].key(), model, cores, smtThreads)) {
+					error = params[i].key() + " is not used by this run, it needs " + needs(params[i].key());
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool known(const std::string &key) const {
+			return index(key) < params.size();
+		}
+
+		// Effective value of a key, empty if it is unknown
+		std::string get(const std::string &key) const {
+			size_t i = index(key);
+			return i < params.size() ? params[i].show() : "";
+		}
+
+		// Every parameter and its effective value, in the INI form load() reads
+		std::string ini() const {
+			std::string out;
+			std::string section;
+			for (size_t i = 0; i < params.size(); i++) {
+				if (params[i].section != section) {
+					section = params[i].section;
+					out += (out.empty() ? "[" : "\n[") + section + "]\n";
+				}
+				std::string line = params[i].name + " = " + params[i].show();
+				out += line + std::string(line.size() < 28 ? 28 - line.size() : 1, ' ') + "; " + params[i].help + "\n";
+			}
+			return out;
+		}
+
+		// Hash of ini(), equal for runs with the same effective configuration
+		std::string hash() const {
+			return fnv_hex(ini());
+		}
+};
+
+#endif
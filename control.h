@@ -5,24 +5,28 @@
 #include <iostream>
 using namespace std;
 
-// Control signals for the processor
+// Control signals for the processor, packed into a single control word
 struct control_t {
-    bool reg_dest;           // 0 if rt, 1 if rd
-    bool jump;               // 1 if jummp
-    bool branch;             // 1 if branch
-    bool mem_read;           // 1 if memory needs to be read
-    bool mem_to_reg;         // 1 if memory needs to written to reg
+    bool reg_dest : 1;       // 0 if rt, 1 if rd
+    bool jump : 1;           // 1 if jummp
+    bool branch : 1;         // 1 if branch
+    bool mem_read : 1;       // 1 if memory needs to be read
+    bool mem_to_reg : 1;     // 1 if memory needs to written to reg
     unsigned ALU_op : 2;     // 10 for R-type, 00 for LW/SW/Add, 01 for BEQ/BNE, 11 for others
-    bool mem_write;          // 1 if needs to be written to memory
-    bool ALU_src;            // 0 if second operand is from reg_file, 1 if imm
-    bool reg_write;          // 1 if need to write back to reg file
-    bool branchNotEqual;
-    bool jumpLink;
-    bool loadUpperImm;
-    bool storeByte;
-    bool storeHalfWord;
-    bool loadByteU;
-    bool loadHalfWordU;
+    bool mem_write : 1;      // 1 if needs to be written to memory
+    bool ALU_src : 1;        // 0 if second operand is from reg_file, 1 if imm
+    bool reg_write : 1;      // 1 if need to write back to reg file
+    bool branchNotEqual : 1;
+    bool jumpLink : 1;
+    bool loadUpperImm : 1;
+    bool storeByte : 1;
+    bool storeHalfWord : 1;
+    bool loadByteU : 1;
+    bool loadHalfWordU : 1;
+    bool mulDiv : 1;         // 1 for MULT/MULTU/DIV/DIVU, writes HI and LO
+    bool divide : 1;         // 1 for DIV/DIVU (divider unit), 0 for the multiplier
+    bool moveFromHi : 1;     // 1 for MFHI
+    bool moveFromLo : 1;     // 1 for MFLO
 
     void print() {      // Prints the generated contol signals
         cout << "REG_DEST: " << reg_dest << "\n";
@@ -43,9 +47,8 @@ struct control_t {
         cout << "LOAD_HALFWORD_U: " << loadHalfWordU << "\n";
     }
     
-    // Decode instructions into control signals
-    void decode(uint32_t instruction) {
-        uint32_t opcode = instruction; //Instruction[31-26]
+    // Reset to the control signals of an empty pipeline slot
+    void clear() {
         reg_dest = false;
         jump = false;
         branch = false;  
@@ -62,6 +65,16 @@ struct control_t {
         storeHalfWord = false;
         loadByteU = false;
         loadHalfWordU = false;
+        mulDiv = false;
+        divide = false;
+        moveFromHi = false;
+        moveFromLo = false;
+    }
+
+    // Decode instructions into control signals
+    void decode(uint32_t instruction) {
+        uint32_t opcode = instruction; //Instruction[31-26]
+        clear();
         if (opcode == 0) { //R-Types
             reg_dest = true;
             ALU_op = 2; //10
@@ -117,6 +130,45 @@ struct control_t {
             loadUpperImm = true;
         }
     }
+
+    // Refine the control signals of an R-type instruction with its function field
+    void decode_funct(uint32_t funct) {
+        if (funct == 24 || funct == 25 || funct == 26 || funct == 27) { //MULT, MULTU, DIV, DIVU
+            reg_write = false;
+            mulDiv = true;
+            divide = funct >= 26;
+        }
+        else if (funct == 16) { //MFHI
+            moveFromHi = true;
+        }
+        else if (funct == 18) { //MFLO
+            moveFromLo = true;
+        }
+    }
+};
+
+// Control words of all 64 opcodes and of the 64 R-type functions, decoded once
+// so the decode stage is a single table lookup
+struct control_table {
+    control_t entry[64];
+    control_t rtype[64];
+    control_table() {
+        for (uint32_t opcode = 0; opcode < 64; opcode++) {
+            entry[opcode].decode(opcode);
+        }
+        for (uint32_t funct = 0; funct < 64; funct++) {
+            rtype[funct].decode(0);
+            rtype[funct].decode_funct(funct);
+        }
+    }
 };
 
+inline const control_t &decoded_control(uint32_t opcode, uint32_t funct) {
+    static const control_table table;
+    if ((opcode & 0b111111) == 0) {
+        return table.rtype[funct & 0b111111];
+    }
+    return table.entry[opcode & 0b111111];
+}
+
 #endif 
\ No newline at end of file
@@ -0,0 +1,129 @@
+#ifndef COUNTERS
+#define COUNTERS
+#include <cstdint>
+#include "cpistack.h"
+
+// Guest-visible counters. The top page of the address space, above the
+// memory, holds registers the guest reads the simulated cycle and retired
+// instruction counts from and marks its region of interest (ROI) with:
+//   0xFFFF0000  cycles, low word       0xFFFF0008  instructions, low word
+//   0xFFFF0004  cycles, high word      0xFFFF000C  instructions, high word
+//   0xFFFF0010  a store begins the ROI 0xFFFF0014  a store ends it
+// Reads see the counts of the running model as of the cycle the access is made
+// in, byte and halfword accesses act on the whole word, and everything else
+// in the page reads 0. A store takes the counts as of its retirement, so every
+// model puts the same instructions in the ROI. The cycles and instructions between each begin and the
+// following end add up to the ROI the main loops report, along with its part
+// of the CPI stack. Memory without counters (Memory::counters NULL) reads the
+// page as zeros and ignores stores to it, so marked programs run anywhere.
+
+const uint32_t COUNTER_PAGE = 0xFFFF0000;
+
+enum counter_register {
+	COUNTER_CYCLES = 0x0,
+	COUNTER_CYCLES_HI = 0x4,
+	COUNTER_INSTRUCTIONS = 0x8,
+	COUNTER_INSTRUCTIONS_HI = 0xC,
+	COUNTER_ROI_BEGIN = 0x10,
+	COUNTER_ROI_END = 0x14
+};
+
+class GuestCounters {
+	private:
+		uint64_t cycles;         //of the running model, kept current by its main loop
+		uint64_t instructions;
+		bool inRoi;
+		unsigned regions;        //ROIs begun
+		uint64_t beginCycles;    //counts when the open ROI began
+		uint64_t beginInstructions;
+		uint64_t roiCycles;      //of the closed ROIs
+		uint64_t roiInstructions;
+		const CpiStack *stack;   //accounting of the run, NULL if none
+		CpiStack beginStack;
+		CpiStack roiStack;
+
+		void end(uint64_t retired) {
+			roiCycles += cycles - beginCycles;
+			roiInstructions += retired - beginInstructions;
+			if (stack) {
+				roiStack.add(*stack, beginStack);
+			}
+			inRoi = false;
+		}
+
+	public:
+		GuestCounters() : cycles(0), instructions(0), inRoi(false), regions(0), beginCycles(0), beginInstructions(0),
+				roiCycles(0), roiInstructions(0), stack(NULL) {}
+
+		// Also splits the ROI out of the run's CPI stack
+		void watch(const CpiStack *cpiStack) {
+			stack = cpiStack;
+		}
+
+		// Counts of the model before the cycle about to be simulated
+		void tick(uint64_t cycle, uint64_t retired) {
+			cycles = cycle;
+			instructions = retired;
+		}
+
+		uint32_t read(uint32_t address) const {
+			switch (address - COUNTER_PAGE) {
+				case COUNTER_CYCLES:
+					return cycles;
+				case COUNTER_CYCLES_HI:
+					return cycles >> 32;
+				case COUNTER_INSTRUCTIONS:
+					return instructions;
+				case COUNTER_INSTRUCTIONS_HI:
+					return instructions >> 32;
+			}
+			return 0;
+		}
+
+		// A store, retiring after ahead more instructions of the cycle than tick() counted
+		void write(uint32_t address, uint32_t ahead = 0) {
+			uint32_t reg = address - COUNTER_PAGE;
+			if (reg == COUNTER_ROI_BEGIN && !inRoi) {
+				inRoi = true;
+				regions++;
+				beginCycles = cycles;
+				beginInstructions = instructions + ahead;
+				if (stack) {
+					beginStack = *stack;
+				}
+			}
+			else if (reg == COUNTER_ROI_END && inRoi) {
+				end(instructions + ahead);
+			}
+		}
+
+		// Closes an ROI the program left open at the final counts
+		void finish(uint64_t cycle, uint64_t retired) {
+			tick(cycle, retired);
+			if (inRoi) {
+				end(instructions);
+			}
+		}
+
+		bool in_roi() const {
+			return inRoi;
+		}
+
+		unsigned roi_regions() const {
+			return regions;
+		}
+
+		uint64_t roi_cycles() const {
+			return roiCycles;
+		}
+
+		uint64_t roi_instructions() const {
+			return roiInstructions;
+		}
+
+		const CpiStack &roi_stack() const {
+			return roiStack;
+		}
+};
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef CPISTACK
+#define CPISTACK
+#include <cstdint>
+#include <string>
+#include <iomanip>
+#include <ostream>
+
+// Cycle accounting of the pipeline models. Every simulated cycle is charged to
+// exactly one category by what writeback sees: a cycle that retires a full
+// group is base, any other cycle is charged to the bubble in the oldest empty
+// lane. Bubbles remember why they were made (the bubble field of the pipeline
+// registers) and carry it down the pipeline to writeback:
+//   load-use    - decode held an instruction reading a register still being loaded
+//   mispredict  - a branch resolved against its prediction squashed the younger instructions
+//   redirect    - a J, JAL or JR squashed the instructions fetched after it
+//   second lane - an instruction read a register written by the older one of its group
+//   memory      - a data access longer than a cycle held everything behind MEM
+//   structural  - the multiply/divide unit was busy, or MFHI/MFLO waited on it
+//   fill        - the pipeline was still filling, nothing had been fetched
+// The categories add up to the cycle count, so dividing each by the
+// instructions retired gives a stack that adds up to the CPI.
+
+enum cpi_category {CPI_BASE, CPI_LOAD_USE, CPI_MISPREDICT, CPI_REDIRECT, CPI_SECOND_LANE, CPI_MEMORY, CPI_STRUCTURAL, CPI_FILL, CPI_CATEGORIES};
+
+// True for the bubbles a squash left
+static inline bool cpi_flush(unsigned category) {
+	return category == CPI_MISPREDICT || category == CPI_REDIRECT;
+}
+
+class CpiStack {
+	private:
+		uint64_t cycles[CPI_CATEGORIES];
+		cpi_category last; //category of the last cycle charged
+
+		static const char *name(unsigned category) {
+			static const char *const names[CPI_CATEGORIES] = {
+				"base", "load-use stall", "branch mispredict", "jump/jr redirect", "second-lane issue", "memory stall", "structural hazard", "pipeline fill"};
+			return names[category];
+		}
+
+	public:
+		CpiStack() : last(CPI_BASE) {
+			reset();
+		}
+
+		// Short name of a category, for column headers
+		static const char *key(unsigned category) {
+			static const char *const keys[CPI_CATEGORIES] = {"base", "load_use", "mispredict", "redirect", "second_lane", "memory", "structural", "fill"};
+			return keys[category];
+		}
+
+		void reset() {
+			for (unsigned c = 0; c < CPI_CATEGORIES; c++) {
+				cycles[c] = 0;
+			}
+		}
+
+		void charge(cpi_category category, uint64_t count = 1) {
+			cycles[category] += count;
+			last = category;
+		}
+
+		// Adds the cycles charged between two copies of a stack
+		void add(const CpiStack &now, const CpiStack &then) {
+			for (unsigned c = 0; c < CPI_CATEGORIES; c++) {
+				cycles[c] += now.cycles[c] - then.cycles[c];
+			}
+		}
+
+		// Takes back the last cycle, for the models that do not report their final one
+		void uncharge_last() {
+			if (cycles[last] > 0) {
+				cycles[last]--;
+			}
+		}
+
+		uint64_t count(cpi_category category) const {
+			return cycles[category];
+		}
+
+		uint64_t total() const {
+			uint64_t sum = 0;
+			for (unsigned c = 0; c < CPI_CATEGORIES; c++) {
+				sum += cycles[c];
+			}
+			return sum;
+		}
+
+		// One row per category with its share of the CPI and a bar of its share of the cycles
+		void report(std::ostream &out, uint64_t instructions) const {
+			const unsigned BAR = 40;
+			uint64_t all = total();
+			out << "CPI stack: " << all << " cycles, " << instructions << " instructions\n";
+			unsigned filled = 0;
+			uint64_t below = 0;
+			for (unsigned c = 0; c < CPI_CATEGORIES; c++) {
+				if (cycles[c] == 0 && c != CPI_BASE) {
+					continue;
+				}
+				//Bars are cut from the running total so they stack up to exactly BAR
+				below += cycles[c];
+				unsigned end = all ? (unsigned)((below * BAR + all / 2) / all) : 0;
+				out << "  " << std::left << std::setw(20) << name(c) << std::right << std::setw(12) << cycles[c]
+						<< std::setw(10) << std::fixed << std::setprecision(4) << (instructions ? (double)cycles[c] / instructions : 0.0)
+						<< std::setw(8) << std::setprecision(1) << (all ? 100.0 * cycles[c] / all : 0.0) << "%  "
+						<< std::string(filled, ' ') << std::string(end - filled, '#') << "\n";
+				filled = end;
+			}
+			out << "  " << std::left << std::setw(20) << "total" << std::right << std::setw(12) << all
+					<< std::setw(10) << std::setprecision(4) << (instructions ? (double)all / instructions : 0.0) << "\n";
+			out.unsetf(std::ios::floatfield);
+			out << std::setprecision(6);
+		}
+};
+
+#endif
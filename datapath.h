@@ -0,0 +1,88 @@
+#ifndef DATAPATH
+#define DATAPATH
+#include <cstdint>
+#include "memory.h"
+#include "control.h"
+
+// Datapath pieces shared by the pipeline engine and the functional model, so
+// both implement exactly the same instruction semantics.
+
+//Memory -> Data memory access of a load or store, returns the (sub-word) load result
+inline uint32_t memory_stage(Memory &memory, const control_t &control, uint32_t address, uint32_t storeData) {
+	uint32_t memReadResult = 0;
+	uint32_t dummy;
+
+	if (control.storeByte == 1) {
+		uint32_t readData2Temp = storeData & 0b11111111; //chops 24 bits off from read data 2
+		memory.access(address, memReadResult, 0, true, 0); //M[address + displacement]
+
+		if (address % 4 == 3) {
+			memReadResult = memReadResult & 0b11111111111111111111111100000000; //M[address + displacement](31:8)
+			memReadResult = memReadResult | readData2Temp;
+		}
+		else if (address % 4 == 2) {
+			memReadResult = memReadResult & 0b11111111111111110000000011111111;
+			readData2Temp = readData2Temp << 8;
+			memReadResult = memReadResult | readData2Temp;
+		}
+		else if (address % 4 == 1) {
+			memReadResult = memReadResult & 0b11111111000000001111111111111111;
+			readData2Temp = readData2Temp << 16;
+			memReadResult = memReadResult | readData2Temp;
+		}
+		else {
+			memReadResult = memReadResult & 0b00000000111111111111111111111111;
+			readData2Temp = readData2Temp << 24;
+			memReadResult = memReadResult | readData2Temp;
+		}
+		memory.access(address, dummy, memReadResult, 0, 1); //Store M[address + displacement](7:0) = Rt(7:0)
+	}
+	else if (control.storeHalfWord == 1) {
+		uint32_t readData2Temp = storeData & 0b1111111111111111; //chops 16 bits off from read data 2
+		memory.access(address, memReadResult, 0, true, 0); //M[address + displacement]
+		if (address % 4 == 2) {
+			memReadResult = memReadResult & 0b11111111111111110000000000000000; //M[address + displacement](31:16)
+			memReadResult = memReadResult | readData2Temp;
+		}
+		else {
+			memReadResult = memReadResult & 0b00000000000000001111111111111111;
+			readData2Temp = readData2Temp << 16;
+			memReadResult = memReadResult | readData2Temp;
+		}
+		memory.access(address, dummy, memReadResult, 0, 1); //Store M[address + displacement](15:0) = Rt(15:0)
+	}
+	else {
+		//Memory access
+		memory.access(address, memReadResult, storeData, control.mem_read, control.mem_write); //Load and Store
+	}
+
+	if (control.loadByteU == 1) {
+		if (address % 4 == 3) {
+			memReadResult = memReadResult & 0b11111111; //R[rt]=M[R[rs]+SignExtImm](7:0)
+		}
+		else if (address % 4 == 2) {
+			memReadResult = memReadResult & 0b1111111100000000;
+			memReadResult = memReadResult >> 8;
+		}
+		else if (address % 4 == 1) {
+			memReadResult = memReadResult & 0b111111110000000000000000;
+			memReadResult = memReadResult >> 16;
+		}
+		else {
+			memReadResult = memReadResult & 0b11111111000000000000000000000000;
+			memReadResult = memReadResult >> 24;
+		}
+	}
+	else if (control.loadHalfWordU == 1) {
+		if (address % 4 == 2) {
+			memReadResult = memReadResult & 0b1111111111111111; //R[rt]=M[R[rs]+SignExtImm](15:0)
+		}
+		else {
+			memReadResult = memReadResult & 0b11111111111111110000000000000000;
+			memReadResult = memReadResult >> 16;
+		}
+	}
+	return memReadResult;
+}
+
+#endif
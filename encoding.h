@@ -0,0 +1,24 @@
+#ifndef ENCODING
+#define ENCODING
+#include <cstdint>
+
+// Instruction word formats, for the code that writes programs (assembler.h,
+// synthetic.h, the benchmark kernels). The fields are those control.h and the
+// datapaths decode.
+
+// R-type: opcode 0, the operation is in funct
+inline uint32_t r_type(uint32_t funct, uint32_t rs, uint32_t rt, uint32_t rd, uint32_t shamt) {
+	return (rs << 21) | (rt << 16) | (rd << 11) | (shamt << 6) | funct;
+}
+
+// I-type, imm is truncated to 16 bits
+inline uint32_t i_type(uint32_t opcode, uint32_t rs, uint32_t rt, uint32_t imm) {
+	return (opcode << 26) | (rs << 21) | (rt << 16) | (imm & 0xFFFF);
+}
+
+// J-type to the word address target, in the 256MB region of the jump
+inline uint32_t j_type(uint32_t opcode, uint32_t target) {
+	return (opcode << 26) | ((target >> 2) & 0x3FFFFFF);
+}
+
+#endif
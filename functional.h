@@ -0,0 +1,282 @@
+#ifndef FUNCTIONAL
+#define FUNCTIONAL
+#include <cstdint>
+#include <vector>
+#include "memory.h"
+#include "reg_file.h"
+#include "ALU.h"
+#include "control.h"
+#include "datapath.h"
+
+// Functional model: executes one instruction per step with the architectural
+// semantics of the pipeline models (same ALU, control table and memory stage)
+// but no timing. Used to fast-forward, profile and warm up ahead of detailed
+// simulation, and as the golden model of --check, which steps it once per
+// retired instruction, so the common instructions run from a pre-decoded form.
+class FunctionalCore {
+	private:
+		//What a decoded instruction does, the common instructions get a kind of
+		//their own so step() runs them without going through the control signals
+		enum Kind {
+			GENERIC, //anything else, executed from the control signals
+			ARITHMETIC, //ALU operation, LUI, MFHI or MFLO written back
+			MULTIPLY_DIVIDE,
+			BRANCH,  //BEQ and BNE
+			JUMP,    //J and JAL
+			JUMP_REG,
+			LOAD_STORE //loads and stores, address R[Rs] + immediate
+		};
+
+		//ALU operations as ALU::operation() numbers them, then the other results
+		enum Operation {
+			SLL = 6,
+			SRL = 7,
+			LUI = 8,
+			MFHI = 9,
+			MFLO = 10
+		};
+
+		//Decoded form of an instruction word, so a loop is decoded once
+		struct Decoded {
+			uint32_t pc;
+			uint32_t instruction;
+			const control_t *control;
+			uint32_t imm;      //sign or zero extended, the shamt for shifts
+			uint8_t kind;
+			uint8_t operation; //of an ARITHMETIC instruction
+			uint8_t rs;
+			uint8_t rt;
+			uint8_t dest;      //register written back
+			bool immediate;    //the second operand is imm instead of R[Rt]
+		};
+		static const unsigned DECODED = 4096; //direct mapped on the word address
+
+		Registers &reg_file;
+		Memory &memory;
+		std::vector<Decoded> decoded;
+
+		static void decode(Decoded &entry, uint32_t pc, uint32_t instruction) {
+			uint32_t opcode = instruction >> 26; //Instruction[31-26]
+			uint32_t Funct = instruction & 0b111111; //Instruction [5-0]
+			uint32_t Imm = instruction & 0b1111111111111111; //Instruction [15-0]
+			entry.pc = pc;
+			entry.instruction = instruction;
+			entry.control = &decoded_control(opcode, Funct);
+			const control_t &control = *entry.control;
+			ALU alu;
+			alu.generate_control_inputs(control.ALU_op, Funct, opcode);
+			entry.rs = (instruction >> 21) & 0b11111; //Instruction [25-21]
+			entry.rt = (instruction >> 16) & 0b11111; //Instruction [20-16]
+			entry.dest = control.reg_dest ? (instruction >> 11) & 0b11111 : entry.rt;
+			entry.immediate = control.ALU_src == 1;
+			entry.imm = alu.zeroExtend ? Imm : (uint32_t)(int32_t)(int16_t)Imm;
+
+			entry.kind = GENERIC;
+			bool hiLo = control.mulDiv || control.moveFromHi || control.moveFromLo;
+			if (control.jump) {
+				if (!hiLo) {
+					entry.kind = JUMP;
+				}
+			}
+			else if (control.branch) {
+				if (!hiLo && alu.operation() == 1 && !entry.immediate && !alu.shift) {
+					entry.kind = BRANCH;
+				}
+			}
+			else if (alu.jumpReg) {
+				if (!hiLo) {
+					entry.kind = JUMP_REG;
+				}
+			}
+			else if (control.mem_read || control.mem_write) {
+				if (!hiLo && alu.operation() == 0 && entry.immediate && !alu.shift && !control.loadUpperImm) {
+					entry.kind = LOAD_STORE;
+				}
+			}
+			else if (control.loadUpperImm || control.moveFromHi || control.moveFromLo) {
+				if (control.reg_write && !control.mem_to_reg) {
+					entry.kind = ARITHMETIC;
+					entry.operation = control.loadUpperImm ? LUI : control.moveFromHi ? MFHI : MFLO;
+					entry.imm = Imm << 16;
+				}
+			}
+			else if (control.mulDiv) {
+				if (!control.reg_write) {
+					entry.kind = MULTIPLY_DIVIDE;
+				}
+			}
+			else if (control.reg_write) {
+				entry.operation = alu.operation() & 7;
+				bool shifts = entry.operation == SLL || entry.operation == SRL;
+				if (alu.shift == shifts && !control.mem_to_reg) {
+					entry.kind = ARITHMETIC;
+				}
+				if (shifts) {
+					entry.imm = (instruction >> 6) & 0b11111; //Instruction [10-6]
+					entry.immediate = false;
+				}
+			}
+		}
+
+		uint32_t reg(uint32_t r) {
+			uint32_t value, dummy;
+			reg_file.access(r, 0, value, dummy, 0, 0, 0);
+			return value;
+		}
+
+		void write(uint32_t r, uint32_t value) {
+			uint32_t dummy;
+			reg_file.access(0, 0, dummy, dummy, r, true, value);
+		}
+
+	public:
+		//Outcome of the last step, for warming branch predictors
+		bool branched; //it was a BEQ/BNE
+		bool taken;
+		//What the last step wrote back and stored, for --check
+		uint32_t written; //register written back, 0 for none, JAL links outside writeback
+		bool stored;
+		uint32_t storeAddress;
+		uint32_t storeData;
+		uint32_t storeMask; //bits of storeData the store writes, 0xFF for SB and 0xFFFF for SH
+		bool counterRead; //it loaded from the counter page, so its result depends on timing
+
+		FunctionalCore(Registers &reg_file, Memory &memory) :
+				reg_file(reg_file), memory(memory), decoded(DECODED), branched(false), taken(false), written(0), stored(false), storeAddress(0), storeData(0), storeMask(0), counterRead(false) {}
+
+		// Executes the instruction at pc, returns true if it was a branch or a
+		// jump, i.e. it ends a basic block
+		bool step() {
+			uint32_t pc = reg_file.pc;
+			uint32_t instruction;
+			memory.access(pc, instruction, 0, 1, 0);
+			Decoded &entry = decoded[(pc / 4) % DECODED];
+			if (entry.control == NULL || entry.pc != pc || entry.instruction != instruction) {
+				decode(entry, pc, instruction);
+			}
+			reg_file.pc = pc + 4;
+			branched = false;
+			written = 0;
+			stored = false;
+			counterRead = false;
+
+			uint32_t a = reg(entry.rs);
+			uint32_t b = entry.immediate ? entry.imm : reg(entry.rt);
+			switch (entry.kind) {
+				case ARITHMETIC: {
+					//Every operation is worked out and the one decoded picked, a branch on
+					//it would mispredict about as often as the instruction mix changes
+					uint32_t shamt = entry.imm & 0b11111;
+					uint32_t results[] = {a + b, a - b, a & b, ~(a | b), a | b, a < b, b << shamt, b >> shamt, entry.imm, reg_file.hi, reg_file.lo}; //SLT compares unsigned, as the ALU does
+					return write_back(entry.dest, results[entry.operation]);
+				}
+				case MULTIPLY_DIVIDE:
+					ALU::multiply_divide(instruction & 0b111111, a, reg(entry.rt), reg_file.hi, reg_file.lo);
+					return false;
+				case BRANCH:
+					branched = true;
+					taken = (a == b) != entry.control->branchNotEqual; //BEQ taken on equal, BNE on not equal
+					if (taken) {
+						reg_file.pc = pc + 4 + (entry.imm << 2);
+					}
+					return true;
+				case JUMP:
+					if (entry.control->jumpLink) {
+						write(31, pc + 8); //R31 = PC + 8
+					}
+					reg_file.pc = ((instruction & 0b11111111111111111111111111) << 2) | ((pc + 4) & 0b11110000000000000000000000000000);
+					return true;
+				case JUMP_REG:
+					reg_file.pc = a;
+					return true;
+				case LOAD_STORE:
+					return memory_access(*entry.control, entry.dest, a + entry.imm, reg(entry.rt));
+				default:
+					return execute(entry, pc, instruction);
+			}
+		}
+
+	private:
+		bool write_back(uint32_t dest, uint32_t value) {
+			written = dest;
+			write(dest, value);
+			return false;
+		}
+
+		bool memory_access(const control_t &control, uint32_t dest, uint32_t address, uint32_t data) {
+			uint32_t memReadData = memory_stage(memory, control, address, data);
+			stored = control.mem_write;
+			storeAddress = address;
+			storeData = data;
+			storeMask = control.storeByte ? 0xFF : control.storeHalfWord ? 0xFFFF : 0xFFFFFFFF;
+			counterRead = control.mem_read && address >= COUNTER_PAGE;
+			if (control.reg_write) {
+				write_back(dest, control.mem_to_reg ? memReadData : address);
+			}
+			return false;
+		}
+
+		// Executes an instruction without a kind of its own from its control
+		// signals, through the ALU
+		bool execute(const Decoded &entry, uint32_t pc, uint32_t instruction) {
+			const control_t &control = *entry.control;
+			uint32_t opcode = instruction >> 26; //Instruction[31-26]
+			uint32_t Imm = instruction & 0b1111111111111111; //Instruction [15-0]
+			uint32_t Shamt = (instruction >> 6) & 0b11111; //Instruction [10-6]
+			uint32_t Funct = instruction & 0b111111; //Instruction [5-0]
+			ALU alu;
+			alu.generate_control_inputs(control.ALU_op, Funct, opcode);
+			uint32_t readData1 = reg(entry.rs);
+			uint32_t readData2 = reg(entry.rt);
+
+			uint32_t signExtend = (int32_t)(int16_t)Imm;
+			uint32_t operand1 = alu.shift ? Shamt : readData1;
+			uint32_t operand2 = readData2;
+			if (control.ALU_src == 1) {
+				operand2 = alu.zeroExtend ? Imm : signExtend;
+			}
+			uint32_t zeroFlag = 0;
+			uint32_t result = alu.execute(operand1, operand2, zeroFlag);
+			if (control.loadUpperImm == true) {
+				result = Imm << 16;
+			}
+			else if (control.moveFromHi == true) {
+				result = reg_file.hi;
+			}
+			else if (control.moveFromLo == true) {
+				result = reg_file.lo;
+			}
+			else if (control.mulDiv == true) {
+				ALU::multiply_divide(Funct, readData1, readData2, reg_file.hi, reg_file.lo);
+			}
+
+			if (control.jump == true) {
+				if (control.jumpLink == true) {
+					write(31, pc + 8); //R31 = PC + 8
+				}
+				reg_file.pc = ((instruction & 0b11111111111111111111111111) << 2) | ((pc + 4) & 0b11110000000000000000000000000000);
+				return true;
+			}
+			if (control.branch == true) {
+				branched = true;
+				taken = (zeroFlag != 0) != control.branchNotEqual; //BEQ taken on zero, BNE on not zero
+				if (taken) {
+					reg_file.pc = pc + 4 + (signExtend << 2);
+				}
+				return true;
+			}
+			if (alu.jumpReg == true) {
+				reg_file.pc = readData1;
+				return true;
+			}
+			if (control.mem_read == true || control.mem_write == true) {
+				return memory_access(control, entry.dest, result, readData2);
+			}
+			if (control.reg_write == true) {
+				write_back(entry.dest, control.mem_to_reg ? 0 : result); //nothing was read from memory
+			}
+			return false;
+		}
+};
+
+#endif
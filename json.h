@@ -0,0 +1,104 @@
+#ifndef JSON
+#define JSON
+#include <cstdint>
+#include <cctype>
+#include <string>
+
+// Just enough JSON for the config files (config.h) and the requests of the
+// simulation server (server.h): objects of scalar values, read one token at a
+// time. Arrays and \u escapes are not supported.
+
+class JsonReader {
+	private:
+		const std::string &text;
+		size_t at;
+
+	public:
+		JsonReader(const std::string &text) : text(text), at(0) {}
+
+		void space() {
+			while (at < text.size() && isspace((unsigned char)text[at])) {
+				at++;
+			}
+		}
+
+		bool peek(char c) {
+			space();
+			return at < text.size() && text[at] == c;
+		}
+
+		bool next(char c) {
+			if (peek(c)) {
+				at++;
+				return true;
+			}
+			return false;
+		}
+
+		bool done() {
+			space();
+			return at == text.size();
+		}
+
+		bool string(std::string &out) {
+			if (!next('"')) {
+				return false;
+			}
+			out.clear();
+			while (at < text.size() && text[at] != '"') {
+				char c = text[at++];
+				if (c == '\\' && at < text.size()) {
+					c = text[at++];
+					c = c == 'n' ? '\n' : c == 't' ? '\t' : c;
+				}
+				out += c;
+			}
+			return next('"');
+		}
+
+		// A number, true, false or a string, as text
+		bool scalar(std::string &out) {
+			space();
+			if (at < text.size() && text[at] == '"') {
+				return string(out);
+			}
+			size_t start = at;
+			while (at < text.size() && (isalnum((unsigned char)text[at]) || text[at] == '.' || text[at] == '-' || text[at] == '+')) {
+				at++;
+			}
+			out = text.substr(start, at - start);
+			return !out.empty();
+		}
+
+		unsigned line() const {
+			unsigned number = 1;
+			for (size_t i = 0; i < at && i < text.size(); i++) {
+				number += text[i] == '\n';
+			}
+			return number;
+		}
+};
+
+// text as a JSON string, quotes included
+static inline std::string json_quote(const std::string &text) {
+	std::string out = "\"";
+	for (size_t i = 0; i < text.size(); i++) {
+		char c = text[i];
+		if (c == '"' || c == '\\') {
+			out += '\\';
+			out += c;
+		}
+		else if (c == '\n') {
+			out += "\\n";
+		}
+		else if (c == '\t') {
+			out += "\\t";
+		}
+		else if ((unsigned char)c >= 0x20) {
+			out += c;
+		}
+	}
+	return out + "\"";
+}
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef LOADER
+#define LOADER
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <elf.h>
+#include "memory.h"
+#include "assembler.h"
+
+// Loading programs into memory: the text section of an ELF binary, from a file
+// or a buffer, or an assembly file through the assembler. Files are closed
+// again, so a long running server can load any number of them.
+
+// Loads the text section of an ELF binary held in data, its address 0 going to
+// base in memory. Returns its size, the program's end_pc, or 0 with an error.
+static inline uint32_t load_elf(const char *data, size_t size, Memory &memory, std::string &error, uint32_t base = 0)
+{
+  Elf32_Ehdr ehdr;
+  Elf32_Shdr shdr;
+
+  /* Verify executable header. */
+  if (size < sizeof(ehdr) || memcmp(data, "\177ELF\1\1\1", 7)) {
+     error = "Error in ELF header";
+     return 0;
+  }
+  memcpy(&ehdr, data, sizeof(ehdr));
+
+  /* Walk section headers. */
+  for (int i = 0; i < ehdr.e_shnum; i++) {
+      uint64_t offset = (uint64_t)ehdr.e_shoff + (uint64_t)i * sizeof(shdr);
+      if (offset + sizeof(shdr) > size) {
+          error = "Error in section header " + std::to_string(i);
+          return 0;
+      }
+      memcpy(&shdr, data + offset, sizeof(shdr));
+      if ((shdr.sh_flags & SHF_EXECINSTR) != 0 && shdr.sh_addr == 0) { /* Text section -- we hardcoded this to zero during compilation. */
+          if ((uint64_t)shdr.sh_offset + shdr.sh_size > size || shdr.sh_size % 4 != 0) {
+              error = "Could not populate memory from section: section header size=" + std::to_string(shdr.sh_size);
+              return 0;
+          }
+          uint32_t word, dummy_word;
+          for (uint32_t j = 0; j < shdr.sh_size; j += 4) {
+              memcpy(&word, data + shdr.sh_offset + j, 4);
+              memory.access(base + (uint32_t)shdr.sh_addr+j, dummy_word, word, false, true);
+          }
+          return shdr.sh_size;
+      }
+  }
+  error = "not an ELF binary with a text section at 0";
+  return 0;
+}
+
+/* Load Binary, its address 0 goes to base in memory. */
+static inline uint32_t load(const char *bmk, Memory &memory, uint32_t base = 0)
+{
+  std::ifstream binary(bmk, std::ios::binary);
+  if (!binary) {
+      std::cout << "Failed to open executable binary: " << std::string(bmk) << "\n";
+      return 0;
+  }
+  std::string data((std::istreambuf_iterator<char>(binary)), std::istreambuf_iterator<char>());
+  std::string error;
+  uint32_t end_pc = load_elf(data.data(), data.size(), memory, error, base);
+  if (end_pc == 0) {
+      std::cout << error << "\n";
+  }
+  return end_pc;
+}
+
+// FNV-1a of a file's bytes in hex, to tell programs apart by content
+static inline bool file_hash(const std::string &path, std::string &out, std::string &error) {
+	std::ifstream in(path.c_str(), std::ios::binary);
+	if (!in) {
+		error = "cannot open " + path;
+		return false;
+	}
+	uint64_t hash = 14695981039346656037ull;
+	char buffer[65536];
+	while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0) {
+		for (std::streamsize i = 0; i < in.gcount(); i++) {
+			hash = (hash ^ (unsigned char)buffer[i]) * 1099511628211ull;
+		}
+	}
+	char text[17];
+	snprintf(text, sizeof(text), "%016llx", (unsigned long long)hash);
+	out = text;
+	return true;
+}
+
+static inline bool is_assembly(const std::string &path) {
+	return path.size() > 2 && path.compare(path.size() - 2, 2, ".s") == 0;
+}
+
+// Identity of the program at path: the hash of its bytes, and whether they are
+// assembled or loaded, since the same bytes would be a different program
+static inline bool program_key(const std::string &path, std::string &out, std::string &error) {
+	if (!file_hash(path, out, error)) {
+		return false;
+	}
+	out = (is_assembly(path) ? "asm:" : "elf:") + out;
+	return true;
+}
+
+// Loads an ELF binary, or assembles path if it ends in .s, returns end_pc or 0 with an error
+static inline uint32_t load_program(const std::string &path, Memory &memory, std::string &error) {
+	if (is_assembly(path)) {
+		return Assembler().assemble(path, memory, error);
+	}
+	std::ifstream in(path.c_str(), std::ios::binary);
+	if (!in) {
+		error = "cannot open " + path;
+		return 0;
+	}
+	std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	return load_elf(data.data(), data.size(), memory, error);
+}
+
+#endif
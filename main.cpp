@@ -12,70 +12,136 @@
 #include <getopt.h>
 #include "memory.h"
 #include "reg_file.h"
+#include "options.h"
+#include "config.h"
+#include "sweep.h"
+#include "server.h"
+#include "synthetic.h"
+#include "assembler.h"
+#include "loader.h"
 
 using namespace std;
 
-extern void single_cycle_main_loop(Registers &reg_file, Memory &memory, uint32_t end_pc);
-extern void pipelined_main_loop(Registers &reg_file, Memory &memory, uint32_t end_pc);
-extern void speculative_main_loop(Registers &reg_file, Memory &memory, uint32_t end_pc);
-extern void io_superscalar_main_loop(Registers &reg_file, Memory &memory, uint32_t end_pc);
-extern void ooo_scalar_main_loop(Registers &reg_file, Memory &memory, uint32_t end_pc);
-extern void ooo_superscalar_main_loop(Registers &reg_file, Memory &memory, uint32_t end_pc);
+SimOptions sim_options;
 
-/* Load Binary. */
-uint32_t load(char *bmk, Memory &memory)
-{
-  Elf32_Ehdr ehdr;
-  Elf32_Shdr shdr;
+// Long options without a single-letter form
+enum long_only_option {
+    OPT_MEM_LATENCY = 256,
+    OPT_MUL_LATENCY,
+    OPT_DIV_LATENCY,
+    OPT_MUL_UNPIPELINED,
+    OPT_DIV_PIPELINED,
+    OPT_CORES,
+    OPT_QUANTUM,
+    OPT_COHERENCE,
+    OPT_SMT,
+    OPT_SMT_FETCH,
+    OPT_QUIET,
+    OPT_SYNTHETIC,
+    OPT_SYNTHETIC_MIX,
+    OPT_SYNTHETIC_DEP,
+    OPT_SYNTHETIC_TAKEN,
+    OPT_SYNTHETIC_PREDICTABLE,
+    OPT_SYNTHETIC_FOOTPRINT,
+    OPT_SYNTHETIC_STRIDE,
+    OPT_SEED,
+    OPT_ASM,
+    OPT_CHECK,
+    OPT_PROFILE,
+    OPT_PROFILE_STACKS,
+    OPT_PIPEVIEW,
+    OPT_PIPEVIEW_FROM,
+    OPT_PIPEVIEW_CYCLES,
+    OPT_CPI_STACK,
+    OPT_STATS_INTERVAL,
+    OPT_STATS_WARMUP,
+    OPT_STATS_OUT,
+    OPT_STATS_FORMAT,
+    OPT_ROI_FAST_FORWARD,
+    OPT_CONFIG,
+    OPT_SET,
+    OPT_PRINT_CONFIG,
+    OPT_SWEEP,
+    OPT_SWEEP_OUT,
+    OPT_SERVE,
+    OPT_SERVE_IMAGES,
+    OPT_CLIENT,
+    OPT_NO_CACHE,
+    OPT_REFRESH,
+    OPT_CACHE_DIR,
+    OPT_CACHE_SIZE
+};
 
-  /* Open binary executable. */
-  FILE *binary, *binary_copy;
-  binary = fopen(bmk, "r");
-  if (!binary) {
-      cout << "Failed to open executable binary: " << string(optarg) << "\n";
-      return 0;
-  }
+extern SweepResult single_cycle_main_loop(Registers &reg_file, Memory &memory, uint32_t end_pc);
+extern SweepResult pipelined_main_loop(Registers &reg_file, Memory &memory, uint32_t end_pc);
+extern SweepResult speculative_main_loop(Registers &reg_file, Memory &memory, uint32_t end_pc);
+extern SweepResult io_superscalar_main_loop(Registers &reg_file, Memory &memory, uint32_t end_pc);
+extern SweepResult ooo_scalar_main_loop(Registers &reg_file, Memory &memory, uint32_t end_pc);
+extern SweepResult ooo_superscalar_main_loop(Registers &reg_file, Memory &memory, uint32_t end_pc);
+extern void sweep_main_loop(const SweepPlan &plan, const string &out);
+extern void serve_main_loop(const string &path, size_t cachedImages);
 
-  /* Read and verify executable header. */
-  int num_read = fread(&ehdr, 1, sizeof(ehdr), binary);
-  if ((num_read != sizeof(ehdr)) || memcmp(ehdr.e_ident, "\177ELF\1\1\1", 7)) {
-     cout << "Error in ELF header\n";
-     return 0;
-  }
+// The run modes each take over the whole run, a run is in at most one of them.
+// starting is the option that starts the run, --processor, --sweep, --serve or --client.
+static bool one_run_mode(const string &starting)
+{
+    const struct {
+        const char *option;
+        bool given;
+    } modes[] = {
+        {"--sweep", starting == "--sweep"},
+        {"--serve", starting == "--serve"},
+        {"--client", starting == "--client"},
+        {"--cores", sim_options.cores > 1},
+        {"--smt", sim_options.smtThreads > 1},
+        {"--simpoint", sim_options.simpointInterval != 0},
+        {"--smarts", sim_options.smartsUnit != 0},
+        {"--parallel", sim_options.parallelIntervals != 0},
+        {"--roi-fast-forward", sim_options.roiFastForward},
+    };
+    const char *first = NULL;
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        if (!modes[i].given) {
+            continue;
+        }
+        if (first) {
+            cout << first << " and " << modes[i].option << " cannot be combined\n";
+            return false;
+        }
+        first = modes[i].option;
+    }
+    return true;
+}
 
-  /* Read section headers. */
-  fseek(binary, ehdr.e_shoff, SEEK_SET);
-  for (int i = 0; i < ehdr.e_shnum; i++) {
-      num_read = fread(&shdr, sizeof(shdr), 1, binary);
-      if (num_read != 1) {
-          cout << "Error in section header: " << num_read << " shdr=" << shdr.sh_addr << "\n";
-          break;
-      }
-      uint32_t word, dummy_word;
-      if ((shdr.sh_flags & SHF_EXECINSTR) != 0 && shdr.sh_addr == 0) { /* Text section -- we hardcoded this to zero during compilation. */
-          binary_copy = fopen(bmk, "r");
-          fseek(binary_copy, shdr.sh_offset, SEEK_SET);
-          for (int j = 0; j < shdr.sh_size; j += 4) {
-              num_read = fread(&word, 1, 4, binary_copy);
-              if (num_read != 4) {
-                  cout << "Could not populate memory from section: " << shdr.sh_addr <<
-                          ": bytes read=" << j + num_read << ", section header size=" << shdr.sh_size << "\n";
-                  return 0;
-              }
-              memory.access((uint32_t)shdr.sh_addr+j, dummy_word, word, false, true);
-          }
-          fclose(binary_copy);
-          return shdr.sh_size;
-      }
-  }
+// --sweep and --serve make runs of whole programs, without the other outputs
+static bool whole_runs_only()
+{
+    if (sim_options.checkpointAt != UINT64_MAX || !sim_options.restore.empty() || sim_options.check ||
+            !sim_options.profileOut.empty() || !sim_options.profileStacks.empty() || sim_options.cpiStack || sim_options.statsInterval != 0 ||
+            !sim_options.pipeviewOut.empty() || sim_options.synthetic.instructions != 0) {
+        cout << "--sweep and --serve run whole programs and cannot be combined with checkpoints, --check, --profile,\n"
+                "--cpi-stack, --stats-interval, --pipeview or --synthetic\n";
+        return false;
+    }
+    return true;
+}
 
-  return 0;
+// The options older than --set each name one parameter, they set it through the
+// registry so --config and --set order and the check for unused keys cover them
+static void set_parameter(ParameterRegistry &registry, const char *option, const char *key, const char *value)
+{
+    string error;
+    if (!registry.set(key, value, error)) {
+        cout << "Bad " << option << ": " << error << "\n";
+        exit(1);
+    }
 }
 
 void print_help()
 {
     cout << "Required Options.\n" 
             "--bmk <path-to-executable>           Path to the benchmark executable binary.\n"
+            "--asm <path-to-source>               MIPS assembly to assemble and run instead of --bmk, see bench/\n"
             "--processor <processor-type>         Type of the processor being simulated.  Can take any of the following values: \n"
             "                                         single-cycle: MIPS Single-Cycle Processor\n"
             "                                         pipelined: The 5-stage MIPS Pipeline\n"
@@ -85,6 +151,96 @@ void print_help()
             "                                         ooo-superscalar: A dual-issue out-of-order MIPS processor\n"
             "                                     Defaults to single-cycle\n"
             "Optional:\n"
+            "--checkpoint-at <cycle>              Save a checkpoint when this many cycles have been simulated\n"
+            "--checkpoint-out <file>              File the checkpoint is written to\n"
+            "--restore <file>                     Resume from a checkpoint instead of starting from --bmk\n"
+            "--simpoint <instructions>            Simulate only SimPoint representative intervals of this length\n"
+            "--simpoint-k <clusters>              Most clusters SimPoint may pick, defaults to 10\n"
+            "--smarts <instructions>              SMARTS sampling with measurement units of this length\n"
+            "--smarts-error <fraction>            Relative error at 95% confidence SMARTS aims for, defaults to 0.03\n"
+            "--parallel <intervals>               Split the run into intervals simulated on host threads\n"
+            "--config <file>                      Set microarchitecture parameters from an INI or JSON file\n"
+            "--set <key>=<value>                  Set one parameter, e.g. predictor.bht_entries=1024. Later\n"
+            "                                     settings win over earlier ones\n"
+            "--print-config                       Print every parameter with its effective value in the\n"
+            "                                     --config format and exit\n"
+            "--sweep <file>                       Run every combination of the programs, processors and parameter\n"
+            "                                     values the file lists on --threads host threads, instead of\n"
+            "                                     --processor, and write one CSV line per run\n"
+            "--sweep-out <file>                   File of the sweep results, defaults to sweep.csv\n"
+            "--serve <socket>                     Serve runs to clients on a Unix domain socket, one JSON request\n"
+            "                                     per line: {\"id\": ..., \"program\": ..., \"processor\": ...,\n"
+            "                                     \"config\": {...}}, each answered with a JSON line of its counts.\n"
+            "                                     Runs use --threads host threads\n"
+            "--serve-images <count>               Loaded programs the server keeps, defaults to 16\n"
+            "--client <socket>                    Send the request lines of stdin to a server, print its answers\n"
+            "--no-cache                           Simulate every --sweep and --serve run instead of taking\n"
+            "                                     results of identical runs from the result cache\n"
+            "--refresh                            Simulate every run again and replace its cached result\n"
+            "--cache-dir <dir>                    Directory of the result cache, defaults to\n"
+            "                                     $XDG_CACHE_HOME/processor or ~/.cache/processor\n"
+            "--cache-size <MB>                    Size the result cache is kept under, defaults to 64\n"
+            "--mem-latency <cycles>               Cycles a data memory access takes, defaults to 1\n"
+            "--mul-latency <cycles>               Multiply latency, defaults to 4\n"
+            "--div-latency <cycles>               Divide latency, defaults to 16\n"
+            "--mul-unpipelined                    The multiplier takes one operation at a time\n"
+            "--div-pipelined                      The divider takes a new operation every cycle\n"
+            "                                     These five, --coherence and --smt-fetch set the parameter\n"
+            "                                     of the same name, as --set does, and take their place in the\n"
+            "                                     order of --config and --set\n"
+            "--cores <count>                      Simulate this many cores of a pipeline model sharing memory\n"
+            "                                     through private coherent L1 data caches, at most 32.\n"
+            "                                     Each core finds its number in $a0 and the count in $a1\n"
+            "--quantum <cycles>                   Cycles cores on different host threads run between\n"
+            "                                     synchronizations, defaults to 1000\n"
+            "--coherence <msi|mesi>               Coherence protocol of the L1s, defaults to mesi\n"
+            "--smt <2|4>                          Share the pipeline between this many hardware threads. Give\n"
+            "                                     --bmk or --asm once per thread, programs are reused in turn\n"
+            "                                     if fewer. Each thread's program, with its .data, sees memory\n"
+            "                                     from its own base address; --asm places .data right after\n"
+            "                                     .text unless it gives an address. --synthetic programs\n"
+            "                                     cannot be SMT threads\n"
+            "--smt-fetch <rr|icount|switch>       Thread fetched each cycle: round-robin, fewest instructions\n"
+            "                                     in fetch and decode, or switch on stall. Defaults to icount\n"
+            "--synthetic <instructions>           Run a generated program of about this many instructions\n"
+            "                                     instead of --bmk\n"
+            "--synthetic-mix <a:l:s:b:m>          Relative weights of ALU, load, store, branch and multiply or\n"
+            "                                     divide instructions, defaults to 50:20:10:15:5\n"
+            "--synthetic-dep <distance>           Mean distance from a result to its use, defaults to 4\n"
+            "--synthetic-taken <fraction>         Fraction of branches taken, defaults to 0.5\n"
+            "--synthetic-predictable <fraction>   Fraction of branches with a fixed outcome, the others are\n"
+            "                                     random, defaults to 0.9\n"
+            "--synthetic-footprint <bytes>        Data the loads and stores cycle through, defaults to 16384\n"
+            "--synthetic-stride <bytes>           Distance between consecutive data accesses, defaults to 4\n"
+            "--seed <number>                      Seed of the generated program, defaults to 1\n"
+            "--check                              Run the functional model in lockstep with the in-order models\n"
+            "                                     and stop at the first instruction that retires differently\n"
+            "--profile <file>                     Write where the guest spent its cycles, per function and per PC, and\n"
+            "                                     its call graph (pipeline models)\n"
+            "--profile-stacks <file>              Write the guest's cycles as folded stacks for flamegraph.pl\n"
+            "--cpi-stack                          Print a CPI stack, every cycle charged to what kept it from retiring\n"
+            "                                     a full group (pipeline models)\n"
+            "--roi-fast-forward                   Simulate only the region of interest the program marks in detail\n"
+            "                                     and run the rest on the functional model (pipeline models).\n"
+            "                                     A program reads the cycle and instruction counters at\n"
+            "                                     0xFFFF0000 and 0xFFFF0008, stores to 0xFFFF0010 and 0xFFFF0014\n"
+            "                                     begin and end its region of interest\n"
+            "--stats-interval <cycles>            Write IPC, branches, data accesses and the CPI stack of every\n"
+            "                                     interval of this many cycles (pipeline models)\n"
+            "--stats-warmup <cycles>              Cycles run before the counters start, defaults to 0\n"
+            "--stats-out <file>                   File of the interval records, defaults to stats.csv or stats.bin\n"
+            "--stats-format <csv|binary>          Format of the interval records, defaults to csv\n"
+            "--pipeview <file>                    Write the stages of every instruction in the Kanata format of the\n"
+            "                                     Konata pipeline viewer (pipeline models)\n"
+            "--pipeview-from <cycle>              First cycle of the trace, defaults to 0\n"
+            "--pipeview-cycles <count>            Cycles traced, defaults to 100000\n"
+            "--quiet                              Skip the per-cycle register dumps, print only the results\n"
+            "--threads <count>                    Host threads for --parallel or --cores, defaults to one per host core\n"
+            "--verify                             Also simulate the whole program and report the sampling or\n"
+            "                                     parallel simulation error\n"
+            "--warmup <instructions>              Detailed warm-up before each sample, defaults to a tenth of\n"
+            "                                     the SimPoint or parallel interval, or twice the SMARTS unit\n"
+            "                                     These must be given before --processor\n"
             "--help                               Print this help message\n";
 }
 
@@ -92,12 +248,70 @@ int main(int argc, char *argv[]) {
     static struct option long_options[] = {
       {"bmk", required_argument, 0, 'b'},
       {"processor", required_argument, 0, 'p'},
-      {"help", no_argument, 0, 'h'}
+      {"asm", required_argument, 0, OPT_ASM},
+      {"checkpoint-at", required_argument, 0, 'c'},
+      {"checkpoint-out", required_argument, 0, 'o'},
+      {"restore", required_argument, 0, 'r'},
+      {"simpoint", required_argument, 0, 's'},
+      {"simpoint-k", required_argument, 0, 'k'},
+      {"smarts", required_argument, 0, 'S'},
+      {"smarts-error", required_argument, 0, 'E'},
+      {"parallel", required_argument, 0, 'P'},
+      {"threads", required_argument, 0, 't'},
+      {"verify", no_argument, 0, 'v'},
+      {"config", required_argument, 0, OPT_CONFIG},
+      {"set", required_argument, 0, OPT_SET},
+      {"print-config", no_argument, 0, OPT_PRINT_CONFIG},
+      {"sweep", required_argument, 0, OPT_SWEEP},
+      {"sweep-out", required_argument, 0, OPT_SWEEP_OUT},
+      {"serve", required_argument, 0, OPT_SERVE},
+      {"serve-images", required_argument, 0, OPT_SERVE_IMAGES},
+      {"client", required_argument, 0, OPT_CLIENT},
+      {"no-cache", no_argument, 0, OPT_NO_CACHE},
+      {"refresh", no_argument, 0, OPT_REFRESH},
+      {"cache-dir", required_argument, 0, OPT_CACHE_DIR},
+      {"cache-size", required_argument, 0, OPT_CACHE_SIZE},
+      {"mem-latency", required_argument, 0, OPT_MEM_LATENCY},
+      {"mul-latency", required_argument, 0, OPT_MUL_LATENCY},
+      {"div-latency", required_argument, 0, OPT_DIV_LATENCY},
+      {"mul-unpipelined", no_argument, 0, OPT_MUL_UNPIPELINED},
+      {"div-pipelined", no_argument, 0, OPT_DIV_PIPELINED},
+      {"cores", required_argument, 0, OPT_CORES},
+      {"quantum", required_argument, 0, OPT_QUANTUM},
+      {"coherence", required_argument, 0, OPT_COHERENCE},
+      {"smt", required_argument, 0, OPT_SMT},
+      {"smt-fetch", required_argument, 0, OPT_SMT_FETCH},
+      {"quiet", no_argument, 0, OPT_QUIET},
+      {"check", no_argument, 0, OPT_CHECK},
+      {"profile", required_argument, 0, OPT_PROFILE},
+      {"profile-stacks", required_argument, 0, OPT_PROFILE_STACKS},
+      {"cpi-stack", no_argument, 0, OPT_CPI_STACK},
+      {"roi-fast-forward", no_argument, 0, OPT_ROI_FAST_FORWARD},
+      {"stats-interval", required_argument, 0, OPT_STATS_INTERVAL},
+      {"stats-warmup", required_argument, 0, OPT_STATS_WARMUP},
+      {"stats-out", required_argument, 0, OPT_STATS_OUT},
+      {"stats-format", required_argument, 0, OPT_STATS_FORMAT},
+      {"pipeview", required_argument, 0, OPT_PIPEVIEW},
+      {"pipeview-from", required_argument, 0, OPT_PIPEVIEW_FROM},
+      {"pipeview-cycles", required_argument, 0, OPT_PIPEVIEW_CYCLES},
+      {"synthetic", required_argument, 0, OPT_SYNTHETIC},
+      {"synthetic-mix", required_argument, 0, OPT_SYNTHETIC_MIX},
+      {"synthetic-dep", required_argument, 0, OPT_SYNTHETIC_DEP},
+      {"synthetic-taken", required_argument, 0, OPT_SYNTHETIC_TAKEN},
+      {"synthetic-predictable", required_argument, 0, OPT_SYNTHETIC_PREDICTABLE},
+      {"synthetic-footprint", required_argument, 0, OPT_SYNTHETIC_FOOTPRINT},
+      {"synthetic-stride", required_argument, 0, OPT_SYNTHETIC_STRIDE},
+      {"seed", required_argument, 0, OPT_SEED},
+      {"warmup", required_argument, 0, 'w'},
+      {"help", no_argument, 0, 'h'},
+      {0, 0, 0, 0}
     };
     int option_index = 0;
     bool initialized = false;
     FILE *binary;
     string processor_type;
+    string sweep_out = "sweep.csv";
+    size_t serve_images = 16;
 
     // Initialize memory
     Memory memory;
@@ -105,10 +319,12 @@ int main(int argc, char *argv[]) {
     // Initialize reg_file
     Registers reg_file;
     reg_file.pc = 0;
-    uint32_t end_pc;
+    uint32_t end_pc = 0;
+
+    ParameterRegistry registry(sim_options.pipeline, sim_options.cache);
 
     while (true) {
-      char c = getopt_long(argc, argv, "b:p:h", long_options, &option_index);
+      int c = getopt_long(argc, argv, "b:p:hc:o:r:s:k:S:E:P:t:vw:", long_options, &option_index);
       if (c == -1) {
           if (!initialized) {
               print_help();
@@ -122,11 +338,371 @@ int main(int argc, char *argv[]) {
           case 'h':
               print_help();
               exit(0);
-          case 'b':
+          case 'b': {
               end_pc = load(optarg, memory);
+              sim_options.binaries.push_back(string(optarg));
+              string error;
+              sim_options.symbols = SymbolTable();
+              sim_options.symbols.load_elf(optarg, error); //a binary without symbols is profiled by address
+              break;
+          }
+          case 'c':
+              sim_options.checkpointAt = strtoull(optarg, NULL, 10);
+              break;
+          case 'o':
+              sim_options.checkpointOut = string(optarg);
+              break;
+          case 'r':
+              sim_options.restore = string(optarg);
+              break;
+          case 's':
+              sim_options.simpointInterval = strtoull(optarg, NULL, 10);
+              break;
+          case 'k':
+              sim_options.simpointMaxK = strtoul(optarg, NULL, 10);
+              break;
+          case 'S':
+              sim_options.smartsUnit = strtoull(optarg, NULL, 10);
+              break;
+          case 'E':
+              sim_options.smartsError = strtod(optarg, NULL);
+              break;
+          case 'P':
+              sim_options.parallelIntervals = strtoull(optarg, NULL, 10);
+              break;
+          case 't':
+              sim_options.threads = strtoul(optarg, NULL, 10);
+              break;
+          case 'v':
+              sim_options.verify = true;
+              break;
+          case OPT_CONFIG: {
+              string error;
+              if (!registry.load(optarg, error)) {
+                  cout << "Bad --config: " << error << "\n";
+                  exit(1);
+              }
+              break;
+          }
+          case OPT_SET: {
+              string error;
+              if (!registry.set(optarg, error)) {
+                  cout << "Bad --set: " << error << "\n";
+                  exit(1);
+              }
+              break;
+          }
+          case OPT_PRINT_CONFIG:
+              cout << registry.ini();
+              exit(0);
+          case OPT_SWEEP_OUT:
+              sweep_out = string(optarg);
+              break;
+          case OPT_SWEEP: {
+              if (!one_run_mode("--sweep") || !whole_runs_only()) {
+                  exit(1);
+              }
+              string error;
+              if (!registry.validate(error)) {
+                  cout << "Bad configuration: " << error << "\n";
+                  exit(1);
+              }
+              SweepPlan plan;
+              if (!plan.load(optarg, sim_options.pipeline, sim_options.cache, error)) {
+                  cout << "Bad --sweep: " << error << "\n";
+                  exit(1);
+              }
+              // Every program is loaded once, the runs copy its image
+              for (size_t i = 0; i < plan.images.size(); i++) {
+                  ProgramImage &image = plan.images[i];
+                  image.end_pc = load_program(image.path, image.memory, error);
+                  if (image.end_pc == 0 || !program_key(image.path, image.key, error)) {
+                      cout << "Cannot load " << image.path << ": " << error << "\n";
+                      exit(1);
+                  }
+              }
+              sweep_main_loop(plan, sweep_out);
+              exit(0);
+          }
+          case OPT_SERVE_IMAGES:
+              serve_images = strtoul(optarg, NULL, 10);
+              if (serve_images == 0) {
+                  cout << "--serve-images must be at least 1\n";
+                  exit(1);
+              }
+              break;
+          case OPT_SERVE: {
+              if (!one_run_mode("--serve") || !whole_runs_only()) {
+                  exit(1);
+              }
+              string error;
+              if (!registry.validate(error)) {
+                  cout << "Bad configuration: " << error << "\n";
+                  exit(1);
+              }
+              serve_main_loop(optarg, serve_images);
+              exit(0);
+          }
+          case OPT_CLIENT:
+              if (!one_run_mode("--client")) {
+                  exit(1);
+              }
+              exit(run_client(optarg));
+          case OPT_NO_CACHE:
+              sim_options.resultCache = false;
+              break;
+          case OPT_REFRESH:
+              sim_options.refreshCache = true;
+              break;
+          case OPT_CACHE_DIR:
+              sim_options.cacheDir = optarg;
+              break;
+          case OPT_CACHE_SIZE:
+              sim_options.cacheBytes = strtoull(optarg, NULL, 10) << 20;
+              if (sim_options.cacheBytes == 0) {
+                  cout << "--cache-size must be at least 1\n";
+                  exit(1);
+              }
+              break;
+          case OPT_MEM_LATENCY:
+              set_parameter(registry, "--mem-latency", "pipeline.mem_latency", optarg);
+              break;
+          case OPT_MUL_LATENCY:
+              set_parameter(registry, "--mul-latency", "pipeline.mul_latency", optarg);
+              break;
+          case OPT_DIV_LATENCY:
+              set_parameter(registry, "--div-latency", "pipeline.div_latency", optarg);
+              break;
+          case OPT_MUL_UNPIPELINED:
+              set_parameter(registry, "--mul-unpipelined", "pipeline.mul_pipelined", "false");
+              break;
+          case OPT_DIV_PIPELINED:
+              set_parameter(registry, "--div-pipelined", "pipeline.div_pipelined", "true");
+              break;
+          case OPT_CORES:
+              sim_options.cores = strtoul(optarg, NULL, 10);
+              if (sim_options.cores < 1 || sim_options.cores > 32) {
+                  cout << "--cores must be between 1 and 32\n";
+                  exit(1);
+              }
+              break;
+          case OPT_QUANTUM:
+              sim_options.quantum = strtoull(optarg, NULL, 10);
+              break;
+          case OPT_COHERENCE:
+              set_parameter(registry, "--coherence", "cache.protocol", optarg);
+              break;
+          case OPT_SMT:
+              sim_options.smtThreads = strtoul(optarg, NULL, 10);
+              if (sim_options.smtThreads != 1 && sim_options.smtThreads != 2 && sim_options.smtThreads != 4) {
+                  cout << "--smt must be 2 or 4\n";
+                  exit(1);
+              }
+              break;
+          case OPT_SMT_FETCH:
+              set_parameter(registry, "--smt-fetch", "smt.fetch", optarg);
+              break;
+          case OPT_QUIET:
+              sim_options.quiet = true;
+              break;
+          case OPT_CHECK:
+              sim_options.check = true;
+              break;
+          case OPT_PROFILE:
+              sim_options.profileOut = string(optarg);
+              break;
+          case OPT_PROFILE_STACKS:
+              sim_options.profileStacks = string(optarg);
+              break;
+          case OPT_CPI_STACK:
+              sim_options.cpiStack = true;
+              break;
+          case OPT_ROI_FAST_FORWARD:
+              sim_options.roiFastForward = true;
+              break;
+          case OPT_STATS_INTERVAL:
+              sim_options.statsInterval = strtoull(optarg, NULL, 10);
+              if (sim_options.statsInterval == 0) {
+                  cout << "--stats-interval must be at least 1\n";
+                  exit(1);
+              }
+              break;
+          case OPT_STATS_WARMUP:
+              sim_options.statsWarmup = strtoull(optarg, NULL, 10);
+              break;
+          case OPT_STATS_OUT:
+              sim_options.statsOut = string(optarg);
+              break;
+          case OPT_STATS_FORMAT:
+              if (string(optarg) == "csv") {
+                  sim_options.statsBinary = false;
+              } else if (string(optarg) == "binary") {
+                  sim_options.statsBinary = true;
+              } else {
+                  cout << "--stats-format must be csv or binary\n";
+                  exit(1);
+              }
+              break;
+          case OPT_PIPEVIEW:
+              sim_options.pipeviewOut = string(optarg);
+              break;
+          case OPT_PIPEVIEW_FROM:
+              sim_options.pipeviewFrom = strtoull(optarg, NULL, 10);
+              break;
+          case OPT_PIPEVIEW_CYCLES:
+              sim_options.pipeviewCycles = strtoull(optarg, NULL, 10);
+              break;
+          case OPT_ASM: {
+              string error;
+              memory = Memory();
+              Assembler assembler;
+              end_pc = assembler.assemble(optarg, memory, error);
+              if (end_pc == 0) {
+                  cout << "Failed to assemble: " << error << "\n";
+                  exit(1);
+              }
+              sim_options.binaries.push_back(string(optarg));
+              sim_options.symbols = SymbolTable();
+              assembler.symbols(sim_options.symbols);
+              break;
+          }
+          case OPT_SYNTHETIC:
+              sim_options.synthetic.instructions = strtoull(optarg, NULL, 10);
+              break;
+          case OPT_SYNTHETIC_MIX: {
+              SyntheticConfig &synthetic = sim_options.synthetic;
+              int fields = sscanf(optarg, "%u:%u:%u:%u:%u", &synthetic.mix[SYNTH_ALU], &synthetic.mix[SYNTH_LOAD],
+                      &synthetic.mix[SYNTH_STORE], &synthetic.mix[SYNTH_BRANCH], &synthetic.mix[SYNTH_MULDIV]);
+              if (fields != SYNTH_CLASSES) {
+                  cout << "--synthetic-mix takes five weights, alu:load:store:branch:muldiv\n";
+                  exit(1);
+              }
+              break;
+          }
+          case OPT_SYNTHETIC_DEP:
+              sim_options.synthetic.depDistance = strtod(optarg, NULL);
+              break;
+          case OPT_SYNTHETIC_TAKEN:
+              sim_options.synthetic.takenRate = strtod(optarg, NULL);
+              break;
+          case OPT_SYNTHETIC_PREDICTABLE:
+              sim_options.synthetic.predictability = strtod(optarg, NULL);
+              break;
+          case OPT_SYNTHETIC_FOOTPRINT:
+              sim_options.synthetic.footprint = strtoul(optarg, NULL, 10);
+              break;
+          case OPT_SYNTHETIC_STRIDE:
+              sim_options.synthetic.stride = strtoul(optarg, NULL, 10);
+              break;
+          case OPT_SEED:
+              sim_options.synthetic.seed = strtoul(optarg, NULL, 10);
+              break;
+          case 'w':
+              sim_options.warmup = strtoull(optarg, NULL, 10);
               break;
           case 'p':
+              if (sim_options.checkpointAt != UINT64_MAX && sim_options.checkpointOut.empty()) {
+                  cout << "--checkpoint-at needs --checkpoint-out\n";
+                  exit(1);
+              }
               processor_type = string(optarg);
+              if (!one_run_mode("--processor")) {
+                  exit(1);
+              }
+              {
+                  string error;
+                  if (!registry.validate(error)) {
+                      cout << "Bad configuration: " << error << "\n";
+                      exit(1);
+                  }
+                  if (!registry.check_used(processor_type, sim_options.cores, sim_options.smtThreads, error)) {
+                      cout << error << "\n";
+                      exit(1);
+                  }
+              }
+              if (sim_options.cores > 1 && (processor_type == "single-cycle" || sim_options.checkpointAt != UINT64_MAX || !sim_options.restore.empty())) {
+                  cout << "--cores needs a pipeline model and cannot be combined with checkpoints\n";
+                  exit(1);
+              }
+              if (sim_options.check && (sim_options.cores > 1 || sim_options.smtThreads > 1 || !sim_options.restore.empty() ||
+                      sim_options.simpointInterval != 0 || sim_options.smartsUnit != 0 || sim_options.parallelIntervals != 0)) {
+                  cout << "--check runs whole programs on one core and cannot be combined with --cores, --smt, --restore, sampling or --parallel\n";
+                  exit(1);
+              }
+              if ((!sim_options.profileOut.empty() || !sim_options.profileStacks.empty()) && (processor_type == "single-cycle" ||
+                      sim_options.cores > 1 || sim_options.smtThreads > 1 || sim_options.simpointInterval != 0 || sim_options.smartsUnit != 0 || sim_options.parallelIntervals != 0)) {
+                  cout << "--profile needs a pipeline model on one core and cannot be combined with --cores, --smt, sampling or --parallel\n";
+                  exit(1);
+              }
+              if ((sim_options.cpiStack || sim_options.statsInterval != 0) && (processor_type == "single-cycle" || sim_options.cores > 1 || sim_options.smtThreads > 1 || !sim_options.restore.empty() ||
+                      sim_options.simpointInterval != 0 || sim_options.smartsUnit != 0 || sim_options.parallelIntervals != 0)) {
+                  cout << "--cpi-stack and --stats-interval need a pipeline model on one core and cannot be combined with --cores, --smt, --restore, sampling or --parallel\n";
+                  exit(1);
+              }
+              if (sim_options.roiFastForward && (processor_type == "single-cycle" || !sim_options.restore.empty() || sim_options.checkpointAt != UINT64_MAX ||
+                      sim_options.check || !sim_options.profileOut.empty() || !sim_options.profileStacks.empty() || !sim_options.pipeviewOut.empty() ||
+                      sim_options.statsInterval != 0)) {
+                  cout << "--roi-fast-forward needs a pipeline model and cannot be combined with checkpoints, --check, --profile,\n"
+                          "--pipeview or --stats-interval\n";
+                  exit(1);
+              }
+              if (!sim_options.pipeviewOut.empty() && (processor_type == "single-cycle" || sim_options.cores > 1 || sim_options.smtThreads > 1 ||
+                      sim_options.simpointInterval != 0 || sim_options.smartsUnit != 0 || sim_options.parallelIntervals != 0)) {
+                  cout << "--pipeview needs a pipeline model on one core and cannot be combined with --cores, --smt, sampling or --parallel\n";
+                  exit(1);
+              }
+              if (sim_options.synthetic.instructions != 0) {
+                  sim_options.symbols = SymbolTable();
+                  if (sim_options.smtThreads > 1) {
+                      cout << "--synthetic cannot be combined with --smt, give the threads --bmk or --asm programs\n";
+                      exit(1);
+                  }
+                  string error;
+                  memory = Memory();
+                  end_pc = SyntheticGenerator(sim_options.synthetic).generate(memory, error);
+                  if (end_pc == 0) {
+                      cout << "Cannot generate the synthetic program: " << error << "\n";
+                      exit(1);
+                  }
+              }
+              if (sim_options.smtThreads > 1) {
+                  if (processor_type == "single-cycle" || sim_options.checkpointAt != UINT64_MAX || !sim_options.restore.empty()) {
+                      cout << "--smt needs a pipeline model and cannot be combined with checkpoints\n";
+                      exit(1);
+                  }
+                  if (sim_options.binaries.empty()) {
+                      cout << "--smt needs at least one --bmk or --asm\n";
+                      exit(1);
+                  }
+                  // Every thread gets an equal slice of memory for its program
+                  memory = Memory();
+                  uint32_t span = memory.words() * 4 / sim_options.smtThreads;
+                  for (unsigned t = 0; t < sim_options.smtThreads; t++) {
+                      ThreadImage image;
+                      image.path = sim_options.binaries[t % sim_options.binaries.size()];
+                      image.base = t * span;
+                      uint32_t size; //bytes from the base the program takes
+                      if (is_assembly(image.path)) {
+                          string error;
+                          Assembler assembler;
+                          assembler.pack(); //.data at ASM_DATA would leave no room for four threads
+                          image.end_pc = assembler.assemble(image.path, memory, error, image.base);
+                          if (image.end_pc == 0) {
+                              cout << "Failed to assemble: " << error << "\n";
+                              exit(1);
+                          }
+                          size = assembler.footprint();
+                      } else {
+                          image.end_pc = load(image.path.c_str(), memory, image.base);
+                          size = image.end_pc;
+                      }
+                      if (size > span) {
+                          cout << image.path << " does not fit in the " << span << " bytes of a thread\n";
+                          exit(1);
+                      }
+                      sim_options.smtImages.push_back(image);
+                  }
+              }
               if (processor_type == "single-cycle") {
                   single_cycle_main_loop(reg_file, memory, end_pc);
               } else if (processor_type == "pipelined") {
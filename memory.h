@@ -3,12 +3,15 @@
 #include <vector>
 #include <cstdint>
 #include <iostream>
+#include "counters.h"
 
 class Memory {
     private:
         std::vector<uint32_t> mem;
     public:
-        Memory() {
+        GuestCounters *counters; //answers the counter page above the memory, NULL when the run keeps none
+
+        Memory() : counters(NULL) {
             mem.resize(65536, 0);
         }
 	// address is the adress which needs to be read or written from
@@ -17,6 +20,10 @@ class Memory {
 	// mem_read specifies whether memory should be read or not
 	// mem_write specifies whether memory whould be written to or not
         void access(uint32_t address, uint32_t &read_data, uint32_t write_data, bool mem_read, bool mem_write) {
+			if (address >= COUNTER_PAGE) {
+				counter_access(address, read_data, mem_read, mem_write);
+				return;
+			}
 			if (mem_read) {
 				read_data = mem[address / 4];
 			}
@@ -24,6 +31,24 @@ class Memory {
 				mem[address / 4] = write_data;
 			}
         }
+        // the counter page (counters.h), reads are 0 and stores ignored without counters
+        void counter_access(uint32_t address, uint32_t &read_data, bool mem_read, bool mem_write) {
+			address &= ~3u;
+			if (mem_read) {
+				read_data = counters ? counters->read(address) : 0;
+			}
+			if (mem_write && counters) {
+				counters->write(address);
+			}
+        }
+        // number of words of memory
+        uint32_t words() const {
+            return mem.size();
+        }
+        // direct pointer to the word at the given word index, for bulk copies
+        uint32_t *data(uint32_t word) {
+            return &mem[word];
+        }
         // given a starting address and number of words from that starting address
         // this function prints int values at the memory
         void print(uint32_t address, int num_words) {
@@ -0,0 +1,52 @@
+#ifndef MULDIV
+#define MULDIV
+#include <cstdint>
+#include <algorithm>
+#include "control.h"
+#include "options.h"
+
+// Multiply and divide units of the in-order pipelines. MULT/DIV compute HI and
+// LO when they execute, but the result only counts as available latency cycles
+// after they entered EX: MFHI/MFLO interlock in decode until then. A pipelined
+// unit takes a new operation every cycle, an unpipelined one only once its
+// previous operation has finished. Times are in engine cycles.
+class MulDivUnit {
+	private:
+		uint32_t latency[2];   //multiplier, divider
+		bool pipelined[2];
+		uint64_t unitFree[2];  //first cycle each unit can take an operation into EX
+		uint64_t hiLoReady;    //first cycle MFHI/MFLO can be in EX
+
+	public:
+		MulDivUnit(const PipelineConfig &config = PipelineConfig()) : hiLoReady(0) {
+			latency[0] = std::max<uint32_t>(config.mulLatency, 1);
+			latency[1] = std::max<uint32_t>(config.divLatency, 1);
+			pipelined[0] = config.mulPipelined;
+			pipelined[1] = config.divPipelined;
+			unitFree[0] = 0;
+			unitFree[1] = 0;
+		}
+
+		// False if the instruction would hit a structural or HI/LO hazard entering EX at cycle
+		bool can_issue(const control_t &control, uint64_t cycle) const {
+			if (control.mulDiv == true) {
+				return unitFree[control.divide] <= cycle;
+			}
+			if (control.moveFromHi == true || control.moveFromLo == true) {
+				return hiLoReady <= cycle;
+			}
+			return true;
+		}
+
+		// The instruction has been issued and enters EX at cycle
+		void issue(const control_t &control, uint64_t cycle) {
+			if (control.mulDiv == false) {
+				return;
+			}
+			unsigned unit = control.divide;
+			unitFree[unit] = cycle + (pipelined[unit] ? 1 : latency[unit]);
+			hiLoReady = std::max(hiLoReady, cycle + latency[unit]);
+		}
+};
+
+#endif
@@ -0,0 +1,172 @@
+#ifndef MULTICORE
+#define MULTICORE
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include "memory.h"
+#include "reg_file.h"
+#include "coherence.h"
+#include "options.h"
+
+// Multicore runs. sim_options.cores copies of a pipeline model execute the
+// same program against one Memory, each with a private coherent L1
+// (coherence.h). A core learns its number from R4 ($a0) and the number of
+// cores from R5 ($a1).
+//
+// The cores are spread over host threads. Every thread advances its cores
+// cycle by cycle to the end of the current quantum of sim_options.quantum
+// cycles, then waits at a barrier for the others. Within a quantum cores on
+// different threads drift apart by up to a quantum, which is the price of
+// running them in parallel. On a single host thread every core advances in
+// lockstep and the run is deterministic.
+
+// Barrier that also reports whether every thread arrived with nothing left to run
+class QuantumBarrier {
+	private:
+		std::mutex lock;
+		std::condition_variable released;
+		unsigned threads;
+		unsigned arrived;
+		unsigned finished;   //arrivals of the current quantum with no core left to run
+		uint64_t generation;
+		bool allFinished;    //outcome of the last completed quantum
+
+	public:
+		QuantumBarrier(unsigned threads) : threads(threads), arrived(0), finished(0), generation(0), allFinished(false) {}
+
+		// Waits for every thread, returns true once all of them are finished
+		bool arrive(bool done) {
+			std::unique_lock<std::mutex> guard(lock);
+			uint64_t quantum = generation;
+			finished += done;
+			if (++arrived == threads) {
+				allFinished = finished == threads;
+				arrived = 0;
+				finished = 0;
+				generation++;
+				released.notify_all();
+				return allFinished;
+			}
+			while (generation == quantum) {
+				released.wait(guard);
+			}
+			return allFinished;
+		}
+};
+
+// The cores of a multicore run and what each has counted
+template <class Processor>
+class MulticoreRun {
+	public:
+		unsigned cores;
+		CoherentMemory coherent;
+		std::vector<Registers> regs;
+		std::vector<std::unique_ptr<Processor> > processors;
+		std::vector<uint64_t> cycles;
+		std::vector<uint64_t> instructions;
+
+		MulticoreRun(Registers &reg_file, Memory &memory, uint32_t end_pc, unsigned cores, const PipelineConfig &pipeline, const CacheConfig &cache) :
+				cores(cores), coherent(memory, cores, cache), regs(cores, reg_file), processors(cores), cycles(cores, 0), instructions(cores, 0) {
+			for (unsigned c = 0; c < cores; c++) {
+				uint32_t dummy1, dummy2;
+				regs[c].access(0, 0, dummy1, dummy2, 4, true, c);     //$a0 = core number
+				regs[c].access(0, 0, dummy1, dummy2, 5, true, cores); //$a1 = number of cores
+				processors[c].reset(new Processor(regs[c], memory, end_pc, pipeline));
+				processors[c]->attach(&coherent, c);
+			}
+		}
+
+		// Runs every core to the end of the program on this many host threads
+		void simulate(unsigned threads, uint64_t quantum) {
+			std::vector<char> done(cores, false);
+			//Thread t runs cores t, t + threads, ...
+			QuantumBarrier barrier(threads);
+			std::vector<std::thread> workers;
+			for (unsigned t = 0; t < threads; t++) {
+				workers.push_back(std::thread([&, t]() {
+					for (uint64_t quantumEnd = quantum; ; quantumEnd += quantum) {
+						for (uint64_t now = quantumEnd - quantum; now < quantumEnd; now++) {
+							for (unsigned c = t; c < cores; c += threads) {
+								if (done[c] || cycles[c] != now) {
+									continue; //finished, or skipping idle cycles
+								}
+								uint32_t committed = 0;
+								done[c] = processors[c]->cycle(committed);
+								cycles[c]++;
+								instructions[c] += committed;
+								if (!done[c]) {
+									uint64_t idle = std::min(processors[c]->idle(), quantumEnd - cycles[c]);
+									processors[c]->skip(idle);
+									cycles[c] += idle;
+								}
+							}
+						}
+						bool finished = true;
+						for (unsigned c = t; c < cores; c += threads) {
+							finished = finished && done[c];
+						}
+						if (barrier.arrive(finished)) {
+							break;
+						}
+					}
+				}));
+			}
+			for (unsigned t = 0; t < threads; t++) {
+				workers[t].join();
+			}
+		}
+
+		// Cycles of the core that finished last
+		uint64_t longest() const {
+			return *std::max_element(cycles.begin(), cycles.end());
+		}
+
+		uint64_t total_instructions() const {
+			uint64_t total = 0;
+			for (unsigned c = 0; c < cores; c++) {
+				total += instructions[c];
+			}
+			return total;
+		}
+};
+
+template <class Processor>
+void multicore_run(const char *model, Registers &reg_file, Memory &memory, uint32_t end_pc) {
+	unsigned cores = sim_options.cores;
+	uint64_t quantum = std::max<uint64_t>(1, sim_options.quantum);
+	MulticoreRun<Processor> run(reg_file, memory, end_pc, cores, sim_options.pipeline, sim_options.cache);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	unsigned threads = sim_options.threads != 0 ? sim_options.threads : std::max(1u, std::thread::hardware_concurrency());
+	threads = std::min(threads, cores);
+	run.simulate(threads, quantum);
+	std::chrono::duration<double> hostTime = std::chrono::steady_clock::now() - start;
+
+	uint64_t totalCycles = 0;
+	CoherenceStats total;
+	std::cout << "Multicore: " << cores << " " << model << " cores, " << (sim_options.cache.mesi ? "MESI" : "MSI") << " coherence, "
+			<< quantum << "-cycle quantum on " << threads << " host threads\n";
+	for (unsigned c = 0; c < cores; c++) {
+		const CoherenceStats &stats = run.coherent.stats(c);
+		std::cout << "CORE " << c << ": " << run.instructions[c] << " instructions, " << run.cycles[c] << " cycles, CPI "
+				<< (double)run.cycles[c] / run.instructions[c] << ", L1 hit rate " << 100 * stats.hit_rate() << "%\n";
+		run.regs[c].print();
+		totalCycles += run.cycles[c];
+		total.add(stats);
+	}
+	uint64_t totalInstructions = run.total_instructions();
+	uint64_t longest = run.longest();
+	std::cout << "Coherence: " << total.reads << " reads, " << total.writes << " writes, " << total.readMisses << " read misses, "
+			<< total.writeMisses << " write misses, " << total.upgrades << " upgrades, " << total.invalidations << " invalidations, "
+			<< total.transfers << " cache-to-cache transfers, " << total.writebacks << " writebacks\n";
+	std::cout << "Cycles = " << longest << ", instructions = " << totalInstructions << ", IPC = " << (double)totalInstructions / longest << "\n";
+	std::cout << "Host time: " << hostTime.count() << " s\n";
+	std::cout << "CPI = " << (double)totalCycles / totalInstructions << "\n";
+}
+
+#endif
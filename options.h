@@ -0,0 +1,126 @@
+#ifndef OPTIONS
+#define OPTIONS
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "symbols.h"
+
+// Which hardware thread a multithreaded pipeline fetches from each cycle
+enum smt_fetch_policy {
+	SMT_FETCH_ROUND_ROBIN,    //take turns
+	SMT_FETCH_ICOUNT,         //the thread with the fewest instructions in fetch and decode
+	SMT_FETCH_SWITCH_ON_STALL //stay with one thread until it stalls in decode or is flushed
+};
+
+// Timing parameters of the in-order pipelines
+struct PipelineConfig {
+	uint32_t memLatency;  //cycles a data memory access spends in MEM
+	uint32_t mulLatency;  //cycles from a multiply entering EX until MFHI/MFLO can use its result
+	uint32_t divLatency;  //same for a divide
+	bool mulPipelined;    //the multiplier takes a new operation every cycle
+	bool divPipelined;    //the divider takes a new operation every cycle
+	smt_fetch_policy smtFetch;
+	uint32_t bhtEntries;  //2-bit counters of the branch predictor, a power of two
+	uint32_t historyBits; //branch outcomes the predictor's global history keeps
+
+	PipelineConfig() : memLatency(1), mulLatency(4), divLatency(16), mulPipelined(true), divPipelined(false), smtFetch(SMT_FETCH_ICOUNT),
+			bhtEntries(256), historyBits(8) {}
+};
+
+// Private L1 data caches and the coherence protocol of a multicore run
+struct CacheConfig {
+	uint32_t size;            //bytes per L1
+	uint32_t ways;
+	uint32_t lineBytes;
+	uint32_t hitLatency;      //cycles an L1 hit spends in MEM
+	uint32_t memoryLatency;   //a miss served by memory
+	uint32_t transferLatency; //a miss served from another core's modified copy
+	uint32_t upgradeLatency;  //a write to a shared line, invalidating the other copies
+	bool mesi;                //grant Exclusive to a lone reader (MESI) rather than Shared (MSI)
+
+	CacheConfig() : size(8192), ways(4), lineBytes(32), hitLatency(1), memoryLatency(20), transferLatency(12), upgradeLatency(6), mesi(true) {}
+};
+
+// Instruction classes of a synthetic program, in --synthetic-mix order
+enum synthetic_class {
+	SYNTH_ALU,
+	SYNTH_LOAD,
+	SYNTH_STORE,
+	SYNTH_BRANCH,
+	SYNTH_MULDIV,
+	SYNTH_CLASSES
+};
+
+// Parameters of a generated program (synthetic.h)
+struct SyntheticConfig {
+	uint64_t instructions;        //dynamic instructions to aim for, 0 to run --bmk instead
+	unsigned mix[SYNTH_CLASSES];  //relative weight of each instruction class
+	double depDistance;           //mean distance in results from a producer to its consumer
+	double takenRate;             //fraction of branches taken
+	double predictability;        //fraction of branches with a fixed outcome, the others are random
+	uint32_t footprint;           //bytes the loads and stores cycle through
+	uint32_t stride;              //bytes between consecutive data accesses
+	uint32_t seed;
+
+	SyntheticConfig() : instructions(0), depDistance(4), takenRate(0.5), predictability(0.9), footprint(16384), stride(4), seed(1) {
+		mix[SYNTH_ALU] = 50;
+		mix[SYNTH_LOAD] = 20;
+		mix[SYNTH_STORE] = 10;
+		mix[SYNTH_BRANCH] = 15;
+		mix[SYNTH_MULDIV] = 5;
+	}
+};
+
+// A program loaded for one hardware thread. Its addresses are offset by base.
+struct ThreadImage {
+	std::string path;
+	uint32_t base;
+	uint32_t end_pc;
+};
+
+// Run options set from the command line in main.cpp and read by the main loops
+struct SimOptions {
+	uint64_t checkpointAt;     //cycle at which to save a checkpoint, UINT64_MAX for never
+	std::string checkpointOut; //file the checkpoint is written to
+	std::string restore;       //checkpoint to resume from, empty to start from the binary
+	uint64_t simpointInterval; //SimPoint interval length in instructions, 0 to simulate the whole program
+	unsigned simpointMaxK;     //most clusters SimPoint may pick
+	uint64_t smartsUnit;       //SMARTS measurement unit in instructions, 0 to simulate the whole program
+	double smartsError;        //relative half-width of the 95% confidence interval SMARTS aims for
+	uint64_t parallelIntervals; //intervals simulated side by side on host threads, 0 to simulate in one piece
+	unsigned threads;          //host threads, 0 for one per host core
+	bool verify;               //also simulate the whole program to measure the sampling error
+	uint64_t warmup;           //instructions simulated in detail before measuring a sample, UINT64_MAX for the default
+	unsigned cores;            //cores sharing memory, each a copy of the chosen model
+	uint64_t quantum;          //cycles the cores of a multicore run advance between synchronizations
+	unsigned smtThreads;       //hardware threads sharing one pipeline
+	std::vector<std::string> binaries;  //every --bmk and --asm given, in order
+	std::vector<ThreadImage> smtImages; //program of each hardware thread, loaded by main.cpp
+	bool quiet;                //skip the per-cycle state dumps, report only the CPI
+	bool check;                //compare every retired instruction with the functional model
+	std::string profileOut;    //flat profile and call graph of the guest, empty for none
+	std::string profileStacks; //folded stacks of the guest, empty for none
+	SymbolTable symbols;       //code symbols of the program, for the profile
+	bool cpiStack;             //print where the cycles went, per CPI stack category
+	bool roiFastForward;       //simulate only the guest's region of interest in detail
+	uint64_t statsInterval;    //cycles per record of the statistics time series, 0 for none
+	uint64_t statsWarmup;      //cycles before the first record, not counted
+	std::string statsOut;      //file of the time series
+	bool statsBinary;          //binary records instead of CSV
+	std::string pipeviewOut;   //Konata trace of the pipeline, empty for none
+	uint64_t pipeviewFrom;     //first cycle traced
+	uint64_t pipeviewCycles;   //cycles traced from pipeviewFrom
+	bool resultCache;          //look up and store the results of --sweep and --serve runs
+	bool refreshCache;         //store them without looking them up
+	std::string cacheDir;      //directory of the result cache, empty for the default
+	uint64_t cacheBytes;       //size the result cache is kept under
+	PipelineConfig pipeline;
+	CacheConfig cache;
+	SyntheticConfig synthetic;
+
+	SimOptions() : checkpointAt(UINT64_MAX), simpointInterval(0), simpointMaxK(10), smartsUnit(0), smartsError(0.03), parallelIntervals(0), threads(0), verify(false), warmup(UINT64_MAX), cores(1), quantum(1000), smtThreads(1), quiet(false), check(false), cpiStack(false), roiFastForward(false), statsInterval(0), statsWarmup(0), statsBinary(false), pipeviewFrom(0), pipeviewCycles(100000), resultCache(true), refreshCache(false), cacheBytes(64ull << 20) {}
+};
+
+extern SimOptions sim_options;
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef PARALLEL
+#define PARALLEL
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include "memory.h"
+#include "reg_file.h"
+#include "functional.h"
+#include "sampling.h"
+#include "options.h"
+
+// Parallel interval simulation. A functional pre-pass splits the program into
+// sim_options.parallelIntervals equal intervals and captures a checkpoint a
+// warm-up prefix ahead of each. The intervals are then simulated in detail on
+// host threads, independently of each other, and their cycle and instruction
+// counts are summed in program order so the result does not depend on thread
+// scheduling.
+
+template <class Processor>
+void parallel_run(Registers &reg_file, Memory &memory, uint32_t end_pc) {
+	Registers startRegs = reg_file;
+	Memory startMemory = memory;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	//Functional pre-pass for the program length, then one more to take the checkpoints
+	uint64_t total = 0;
+	FunctionalCore core(reg_file, memory);
+	while (reg_file.pc != end_pc) {
+		core.step();
+		total++;
+	}
+	uint64_t intervals = std::max<uint64_t>(1, std::min<uint64_t>(sim_options.parallelIntervals, total));
+	uint64_t length = (total + intervals - 1) / intervals;
+	uint64_t warmup = sim_options.warmup != UINT64_MAX ? sim_options.warmup : length / 10;
+
+	reg_file = startRegs;
+	memory = startMemory;
+	std::vector<ArchCheckpoint> checkpoints(intervals);
+	uint64_t executed = 0;
+	for (uint64_t i = 0; i < intervals; i++) {
+		uint64_t begin = std::min(i * length, total); //intervals past the end are left empty
+		uint64_t skip = begin - std::min(begin, warmup);
+		while (executed < skip) {
+			core.step();
+			executed++;
+		}
+		checkpoints[i].reg_file = reg_file;
+		checkpoints[i].memory = memory;
+		checkpoints[i].skip = skip;
+		checkpoints[i].warmup = begin - skip;
+		checkpoints[i].measure = std::min(length, total - begin); //the last interval runs to the end of the program
+	}
+	std::chrono::duration<double> prepassTime = std::chrono::steady_clock::now() - start;
+
+	//Detailed intervals, each thread takes the next unclaimed one
+	start = std::chrono::steady_clock::now();
+	unsigned threads = sim_options.threads != 0 ? sim_options.threads : std::max(1u, std::thread::hardware_concurrency());
+	threads = std::min<uint64_t>(threads, intervals);
+	std::vector<DetailedStats> stats(intervals);
+	std::atomic<uint64_t> nextInterval(0);
+	std::vector<std::thread> workers;
+	for (unsigned t = 0; t < threads; t++) {
+		workers.push_back(std::thread([&]() {
+			for (uint64_t i = nextInterval++; i < intervals; i = nextInterval++) {
+				stats[i] = detailed_run<Processor>(checkpoints[i], end_pc);
+			}
+		}));
+	}
+	for (unsigned t = 0; t < threads; t++) {
+		workers[t].join();
+	}
+	std::chrono::duration<double> detailedTime = std::chrono::steady_clock::now() - start;
+
+	uint64_t cycles = 0;
+	uint64_t instructions = 0;
+	std::cout << "Parallel: " << intervals << " intervals of " << length << " instructions (+" << warmup << " warm-up) on " << threads << " threads\n";
+	for (uint64_t i = 0; i < intervals; i++) {
+		cycles += stats[i].cycles;
+		instructions += stats[i].instructions;
+		std::cout << "  interval " << i << ": " << stats[i].instructions << " instructions, " << stats[i].cycles << " cycles, CPI " << stats[i].cpi() << "\n";
+	}
+	double cpi = instructions == 0 ? 0 : (double)cycles / instructions;
+	std::cout << "Cycles = " << cycles << ", instructions = " << instructions << "\n";
+	std::cout << "Host time: pre-pass " << prepassTime.count() << " s, detailed " << detailedTime.count() << " s\n";
+	if (sim_options.verify) {
+		report_full_run<Processor>(startRegs, startMemory, end_pc, cpi);
+	}
+	std::cout << "CPI = " << cpi << "\n";
+}
+
+#endif
@@ -0,0 +1,875 @@
+#ifndef PIPELINE
+#define PIPELINE
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+#include "memory.h"
+#include "reg_file.h"
+#include "ALU.h"
+#include "control.h"
+#include "state.h"
+#include "predictor.h"
+#include "scoreboard.h"
+#include "timing_wheel.h"
+#include "datapath.h"
+#include "muldiv.h"
+#include "coherence.h"
+#include "checker.h"
+#include "profiler.h"
+#include "pipeview.h"
+#include "cpistack.h"
+#include "options.h"
+
+// Generic in-order pipeline engine. Every 5-stage model (pipelined, speculative,
+// io-superscalar) is an instantiation of InOrderPipeline with a set of policies:
+//   FetchPolicy - branch predictor consulted at fetch (NoPredictor, GHRPredictor)
+//   Width       - number of lanes issued per cycle
+//   Forwarding  - forwarding network between the pipeline registers
+//   HazardUnit  - stall detection in decode
+// Lane 0 always holds the oldest instruction of a group. The forwarding network
+// and hazard unit both work from a register scoreboard (scoreboard.h).
+// A bubble records why it was made and the cycle it reaches writeback is
+// charged to that reason in a CPI stack (cpistack.h).
+// MULT/DIV run on a separate multiply/divide unit (muldiv.h) and only MFHI/MFLO
+// wait for them. Data memory accesses take memLatency cycles. A longer access schedules its
+// completion on the timing wheel (timing_wheel.h) and freezes everything
+// behind MEM, the cycles until it completes can be skipped in bulk. In a
+// multicore run the latency of each access comes from the core's coherent L1
+// instead (coherence.h).
+// With Threads > 1 the pipeline is shared by several hardware threads, each
+// with its own Registers, PC and program at its own offset in memory. Every
+// pipeline register carries the thread of its instruction, hazards and
+// forwarding only look at producers of the same thread, and a mispredict only
+// squashes its own thread. A fetch policy (smt_fetch_policy) picks the thread
+// fetched each cycle.
+
+// EX->EX, MEM->EX and MEM->MEM (load then store) forwarding paths. Operands
+// are taken from the youngest producer recorded in the scoreboard.
+struct FullForwarding {
+	//MEM->MEM Forwarding, the load has just been written into memwb and the store has not executed yet
+	template <unsigned Width>
+	static void memory_to_memory(const MEMWB (&memwb)[Width], IDEX (&idex)[Width]) {
+		for (unsigned i = 0; i < Width; i++) {
+			if (idex[i].valid && idex[i].storeDataFromLoad) {
+				idex[i].readData2 = memwb[idex[i].storeDataLane].memReadData; //SW rt = LW rt
+			}
+		}
+	}
+
+	//MEM->EX and EX->EX Forwarding into a newly decoded idex
+	template <unsigned Width, unsigned Threads>
+	static void execute(const Scoreboard<Width, Threads> &scoreboard, const EXMEM (&exmem)[Width], const MEMWB (&memwb)[Width], IDEX &idex) {
+		idex.readData1 = scoreboard.value(idex.thread, idex.Rs, idex.readData1, exmem, memwb);
+		idex.storeDataFromLoad = false;
+		if (idex.control.mem_write == true && (scoreboard.load_pending(idex.thread) & (1u << idex.Rt)) != 0) {
+			idex.storeDataFromLoad = true; //store data arrives MEM->MEM next cycle
+			idex.storeDataLane = scoreboard.producer_lane(idex.thread, idex.Rt);
+		}
+		else if (idex.control.ALU_src == 0 || idex.control.mem_write == true) {
+			idex.readData2 = scoreboard.value(idex.thread, idex.Rt, idex.readData2, exmem, memwb);
+		}
+	}
+};
+
+// Stalls a decoding instruction that reads a register still being loaded, or
+// one written by an older instruction of its own group and thread. Store data
+// coming from a load does not stall, it is forwarded MEM->MEM.
+struct LoadUseHazard {
+	template <unsigned Width, unsigned Threads>
+	static bool stall(const Scoreboard<Width, Threads> &scoreboard, const IFID &ifid, const control_t &control, uint32_t groupWrites) {
+		if (!ifid.valid) {
+			return false;
+		}
+		uint32_t sources = 1u << ifid.Rs;
+		uint32_t storeData = 0;
+		if (control.mem_write == true) {
+			storeData = 1u << ifid.Rt;
+		}
+		else if (control.ALU_src == 0) {
+			sources |= 1u << ifid.Rt;
+		}
+		return ((sources & (scoreboard.load_pending(ifid.thread) | groupWrites)) | (storeData & groupWrites)) != 0;
+	}
+};
+
+template <class FetchPolicy, unsigned Width, class Forwarding, class HazardUnit, unsigned Threads = 1>
+class InOrderPipeline {
+	private:
+		Registers *regs[Threads];  //architectural state of each hardware thread
+		uint32_t base[Threads];    //where each thread's address 0 is in memory
+		uint32_t endPC[Threads];
+		bool finished[Threads];    //the thread's last instruction has retired
+		uint64_t retiredCount[Threads];
+		uint64_t branchCount;      //conditional branches resolved in EX
+		uint64_t mispredictCount;  //of them, the ones that redirected the fetch
+		uint64_t loadCount;        //data accesses made in MEM
+		uint64_t storeCount;
+		smt_fetch_policy fetchPolicy;
+		unsigned fetchThread;      //thread fetched from last
+		Memory &memory;
+		ALU alu[Width];
+		FetchPolicy predictor;
+		Scoreboard<Width, Threads> scoreboard;
+		PipelineLatches<Width> latches[2];
+		PipelineLatches<Width> *cur;  //pipeline registers at the start of the cycle
+		PipelineLatches<Width> *next; //pipeline registers written during the cycle
+		TimingWheel<64> events;
+		MulDivUnit muldiv;
+		uint32_t memLatency; //cycles a data memory access spends in MEM
+		bool memPending;     //an access is waiting for EVENT_MEM_COMPLETE
+		bool memReady;       //the access has completed and may leave MEM this cycle
+		bool fetching;       //cleared while the pipeline drains
+		CoherentMemory *coherent; //shared memory of a multicore run, NULL for a single core
+		unsigned core;            //this pipeline's core number in it
+		LockstepChecker *checker; //golden model retirements are compared with, NULL when not checking
+		GuestProfiler *profiler;  //charged every cycle, NULL when not profiling
+		PipeTrace *tracer;        //told where every instruction is each cycle, NULL when not tracing
+		CpiStack *cpiStack;       //charged every cycle, NULL when not accounting
+		uint32_t fetched;         //instructions fetched, the id of the next one
+
+		static unsigned slot(unsigned thread) {
+			return Threads == 1 ? 0 : thread;
+		}
+
+		Registers &thread_regs(unsigned thread) {
+			return *regs[slot(thread)];
+		}
+
+		//Memory address of a thread's address
+		uint32_t physical(unsigned thread, uint32_t address) const {
+			return Threads == 1 ? address : address + base[thread];
+		}
+
+		//Writeback -> Data writes into PC/Register file
+		void writeback(const MEMWB &memwb) {
+			Registers &reg_file = thread_regs(memwb.thread);
+			uint32_t dummy1 = 0;
+			uint32_t dummy2 = 0;
+
+			if (memwb.control.loadUpperImm == 1) { //Load Upper Immediate
+				uint32_t temp = memwb.instruction << 16; //makes Imm most significant 16 bits
+				reg_file.access(0, 0, dummy1, dummy2, memwb.regDestination, memwb.control.reg_write, temp); //writes data back
+			}
+			else if (memwb.control.jumpLink == 0 && memwb.jumpReg == 0 && memwb.control.branch == 0 && memwb.control.branchNotEqual == 0) { //Prevents Jump and Link from working correctly
+				if (memwb.control.mem_to_reg == 1) { //write back memory read result
+					reg_file.access(0, 0, dummy1, dummy2, memwb.regDestination, memwb.control.reg_write, memwb.memReadData); //RegDst determined in EX stage for Pipeline processor instead
+				}
+				else { //write back ALU result
+					reg_file.access(0, 0, dummy1, dummy2, memwb.regDestination, memwb.control.reg_write, memwb.ALUresult);
+				}
+			}
+		}
+
+		//What the instruction in memwb does at writeback, for the checker
+		static Retirement retirement(const MEMWB &memwb) {
+			Retirement r;
+			bool writes = memwb.control.reg_write && memwb.control.jumpLink == 0 && memwb.jumpReg == 0 && memwb.control.branch == 0;
+			r.pc = memwb.PC - 4;
+			r.dest = writes ? memwb.regDestination : 0;
+			r.value = memwb.control.loadUpperImm ? memwb.instruction << 16 : memwb.control.mem_to_reg ? memwb.memReadData : memwb.ALUresult;
+			r.store = memwb.control.mem_write;
+			r.address = memwb.ALUresult;
+			r.data = memwb.memReadData;
+			return r;
+		}
+
+		//Memory -> MEMWB Pipeline
+		void memory_access(const EXMEM &exmem, MEMWB &memwb) {
+			memwb.valid = exmem.valid;
+			memwb.bubble = exmem.bubble;
+			memwb.id = exmem.id;
+			if (!exmem.valid) {
+				return;
+			}
+			uint32_t address = exmem.ALUresult >= COUNTER_PAGE ? exmem.ALUresult : physical(exmem.thread, exmem.ALUresult);
+			loadCount += exmem.control.mem_read;
+			storeCount += exmem.control.mem_write;
+			if (coherent && (exmem.control.mem_read || exmem.control.mem_write) && address < COUNTER_PAGE) {
+				memwb.memReadData = coherent->access(exmem.control, address, exmem.readData2);
+			}
+			else if (!exmem.control.mem_write || address < COUNTER_PAGE) { //counter page stores act when they retire
+				memwb.memReadData = memory_stage(memory, exmem.control, address, exmem.readData2);
+			}
+			if (exmem.control.mem_write) {
+				memwb.memReadData = exmem.readData2; //a store reads nothing, keep its data for the checker
+			}
+			memwb.control = exmem.control;
+			memwb.instruction = exmem.instruction;
+			memwb.ALUresult = exmem.ALUresult;
+			memwb.jumpReg = exmem.jumpReg;
+			memwb.regDestination = exmem.regDestination;
+			memwb.PC = exmem.PC;
+			memwb.PCsrc = exmem.PCsrc;
+			memwb.thread = exmem.thread;
+		}
+
+		//Execute -> ALU, writes the result into exmem
+		void execute(ALU &alu, const IDEX &idex, EXMEM &exmem) {
+			exmem.valid = idex.valid;
+			exmem.bubble = idex.bubble;
+			exmem.id = idex.id;
+			if (!idex.valid) {
+				return;
+			}
+			alu.generate_control_inputs(idex.control.ALU_op, idex.Funct, idex.opcode);
+			uint32_t signExtend = idex.signExtendImm;
+			if (alu.zeroExtend == true) { //Special cases: Andi and Ori
+				signExtend = idex.Imm;
+			}
+			uint32_t readData1Temp = idex.readData1;
+			if (alu.shift == true) { //Shifts
+				readData1Temp = idex.Shamt;
+			}
+			uint32_t zeroFlag = 0;
+			if (idex.control.loadUpperImm == true) {
+				exmem.ALUresult = (uint32_t)idex.Imm << 16; //the value written back, so it can be forwarded
+			}
+			else if (idex.control.moveFromHi == true) {
+				exmem.ALUresult = thread_regs(idex.thread).hi;
+			}
+			else if (idex.control.moveFromLo == true) {
+				exmem.ALUresult = thread_regs(idex.thread).lo;
+			}
+			else if (idex.control.ALU_src == 0) {
+				exmem.ALUresult = alu.execute(readData1Temp, idex.readData2, zeroFlag);
+			}
+			else {
+				exmem.ALUresult = alu.execute(readData1Temp, signExtend, zeroFlag);
+			}
+
+			exmem.control = idex.control;
+			exmem.instruction = idex.instruction;
+			exmem.PC = idex.PC;
+			exmem.PCbranch = (idex.signExtendImm << 2) + idex.PC; //branch Address
+			exmem.zeroFlag = zeroFlag;
+			exmem.readData1 = readData1Temp;
+			exmem.readData2 = idex.readData2;
+			exmem.regDestination = idex.control.reg_dest ? idex.Rd : idex.Rt;
+			exmem.jumpReg = alu.jumpReg;
+			exmem.branchPred = idex.branchPred;
+			exmem.thread = idex.thread;
+		}
+
+		//Jump and Branch, returns the next PC if this instruction redirects the fetch
+		uint32_t resolve(EXMEM &exmem) {
+			uint32_t dummy1 = 0;
+			uint32_t dummy2 = 0;
+			uint32_t jumpAddress = exmem.instruction & 0b11111111111111111111111111; //Instruction [25-0]
+			uint32_t PCoption = exmem.PC; //Chooses to jump to this or to PC+4
+			exmem.PCsrc = false;
+			if (exmem.control.jump == 1) {
+				if (exmem.control.jumpLink == 1) {
+					uint32_t temp = exmem.PC + 4; //PC + 8
+					thread_regs(exmem.thread).access(0, 0, dummy1, dummy2, 31, exmem.control.reg_write, temp); //R31 = PC + 8
+				}
+				jumpAddress = jumpAddress << 2;
+				uint32_t temp = exmem.PC & 0b11110000000000000000000000000000; //PC + 4 [31-28]
+				jumpAddress += temp; //Jump Address [31=0]
+				PCoption = jumpAddress; //next PC jump address
+				exmem.PCsrc = true;
+			}
+			else if (exmem.control.branch == 1) {
+				bool taken = exmem.zeroFlag != exmem.control.branchNotEqual; //BEQ taken on zero, BNE on not zero
+				predictor.update(exmem.PC-4, taken);
+				if (taken) {
+					PCoption = exmem.PCbranch;
+					exmem.PCsrc = true;
+				}
+			}
+			else if (exmem.jumpReg == true) { //controls Jump Register MUX
+				PCoption = exmem.readData1;
+				exmem.PCsrc = true;
+			}
+			return PCoption;
+		}
+
+		//Decode -> Process instruction
+		void decode(const IFID &ifid, const control_t &controlUnit, IDEX &idex) {
+			idex.valid = ifid.valid;
+			idex.bubble = ifid.bubble;
+			idex.id = ifid.id;
+			if (!ifid.valid) {
+				return;
+			}
+			uint32_t readData1;
+			uint32_t readData2;
+			thread_regs(ifid.thread).access(ifid.Rs, ifid.Rt, readData1, readData2, 0, 0, 0);
+
+			idex.control = controlUnit;
+			idex.instruction = ifid.instruction;
+			idex.PC = ifid.PC;
+			idex.readData1 = readData1;
+			idex.readData2 = readData2;
+			idex.Rs = ifid.Rs;
+			idex.Rt = ifid.Rt;
+			idex.Rd = ifid.Rd;
+			idex.opcode = ifid.opcode;
+			idex.Imm = ifid.Imm;
+			idex.signExtendImm = (int32_t)(int16_t)ifid.Imm; //sign-extend
+			idex.Shamt = ifid.Shamt;
+			idex.Funct = ifid.Funct;
+			idex.branchPred = ifid.branchPred;
+			idex.thread = ifid.thread;
+		}
+
+		//True if an instruction about to enter MEM accesses data memory
+		bool memory_op_waiting() const {
+			for (unsigned l = 0; l < Width; l++) {
+				const EXMEM &exmem = cur->exmem[l];
+				if (exmem.valid && (exmem.control.mem_read || exmem.control.mem_write)) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		//Cycles the accesses about to enter MEM take, the slowest of the group
+		uint32_t data_latency() {
+			if (!coherent) {
+				return memLatency;
+			}
+			uint32_t latency = 0;
+			for (unsigned l = 0; l < Width; l++) {
+				const EXMEM &exmem = cur->exmem[l];
+				if (exmem.valid && (exmem.control.mem_read || exmem.control.mem_write) && exmem.ALUresult < COUNTER_PAGE) {
+					latency = std::max(latency, coherent->transaction(core, physical(exmem.thread, exmem.ALUresult), exmem.control.mem_write));
+				}
+			}
+			return latency;
+		}
+
+		//Hold IF through EX in place and let a memory stall bubble into MEMWB
+		void freeze() {
+			for (unsigned l = 0; l < Width; l++) {
+				next->ifid[l] = cur->ifid[l];
+				next->idex[l] = cur->idex[l];
+				next->exmem[l] = cur->exmem[l];
+				next->memwb[l].valid = false;
+				next->memwb[l].bubble = CPI_MEMORY;
+			}
+		}
+
+		//True if the thread may fetch this cycle, it is not being redirected and has not fetched past its end
+		bool can_fetch(unsigned thread, uint32_t flushed) const {
+			if ((flushed & (1u << thread)) != 0) {
+				return false;
+			}
+			return Threads == 1 || (!finished[thread] && regs[thread]->pc <= endPC[thread]);
+		}
+
+		//Thread to fetch from this cycle, Threads if none can. stalled is the
+		//thread whose instruction stalled in decode, kept the number of
+		//instructions left in the IFID.
+		unsigned fetch_thread(uint32_t flushed, unsigned stalled, unsigned kept) {
+			if (Threads == 1) {
+				return can_fetch(0, flushed) ? 0 : Threads;
+			}
+			if (fetchPolicy == SMT_FETCH_SWITCH_ON_STALL && stalled != fetchThread && can_fetch(fetchThread, flushed)) {
+				return fetchThread;
+			}
+			unsigned count[Threads] = {0};
+			if (fetchPolicy == SMT_FETCH_ICOUNT) {
+				for (unsigned l = 0; l < Width; l++) {
+					if (l < kept && next->ifid[l].valid) {
+						count[next->ifid[l].thread]++;
+					}
+					if (next->idex[l].valid) {
+						count[next->idex[l].thread]++;
+					}
+				}
+			}
+			//Round-robin from the thread after the last one, ICOUNT takes the emptiest on the way
+			unsigned chosen = Threads;
+			for (unsigned i = 1; i <= Threads; i++) {
+				unsigned t = (fetchThread + i) % Threads;
+				if (can_fetch(t, flushed) && (chosen == Threads || count[t] < count[chosen])) {
+					chosen = t;
+				}
+			}
+			if (chosen != Threads) {
+				fetchThread = chosen;
+			}
+			return chosen;
+		}
+
+		bool all_finished() const {
+			for (unsigned t = 0; t < Threads; t++) {
+				if (!finished[t]) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		//Fetch -> Retrieve instruction from PC
+		void fetch(IFID &ifid, unsigned thread) {
+			Registers &reg_file = thread_regs(thread);
+			uint32_t instruction;
+			memory.access(physical(thread, reg_file.pc), instruction, 0, 1, 0);
+			ifid.valid = true;
+			ifid.bubble = CPI_BASE;
+			ifid.id = fetched++;
+			ifid.thread = thread;
+			ifid.PC = reg_file.pc + 4; //save PC + 4 and propagate
+			ifid.instruction = instruction;
+			ifid.opcode = instruction >> 26; //Instruction[31-26]
+			ifid.Rs = (instruction >> 21) & 0b11111; //Instruction [25-21]
+			ifid.Rt = (instruction >> 16) & 0b11111; //Instruction [20-16]
+			ifid.Rd = (instruction >> 11) & 0b11111; //Instruction [15-11]
+			ifid.Imm = instruction & 0b1111111111111111; //Instruction [15-0]
+			ifid.Shamt = (instruction >> 6) & 0b11111; //Instruction [10-6]
+			ifid.Funct = instruction & 0b111111; //Instruction [5-0]
+			ifid.branchPred = false;
+
+			if (ifid.opcode == 4 || ifid.opcode == 5) { //BEQ or BNE
+				ifid.branchPred = predictor.predict(reg_file.pc);
+				if (ifid.branchPred == true) { //predict "Taken"
+					reg_file.pc += (uint32_t)(int32_t)(int16_t)ifid.Imm << 2;
+				}
+			}
+			reg_file.pc += 4;
+		}
+
+		//PC of the oldest instruction in flight that has not reached writeback, the next fetch if there is none
+		uint32_t head_pc() const {
+			for (unsigned l = 0; l < Width; l++) {
+				if (cur->exmem[l].valid) {
+					return cur->exmem[l].PC - 4;
+				}
+			}
+			for (unsigned l = 0; l < Width; l++) {
+				if (cur->idex[l].valid) {
+					return cur->idex[l].PC - 4;
+				}
+			}
+			for (unsigned l = 0; l < Width; l++) {
+				if (cur->ifid[l].valid) {
+					return cur->ifid[l].PC - 4;
+				}
+			}
+			return regs[0]->pc;
+		}
+
+		//Reports where every instruction is at the end of the cycle, from the registers it wrote
+		void trace_cycle() {
+			uint64_t time = events.time();
+			if (!tracer->tracing(time)) {
+				return;
+			}
+			for (unsigned l = 0; l < Width; l++) {
+				const MEMWB &memwb = next->memwb[l];
+				if (memwb.valid) {
+					tracer->stage(time, memwb.id, memwb.PC - 4, memwb.instruction, memwb.thread, l, STAGE_MEM);
+				}
+				const EXMEM &exmem = next->exmem[l];
+				if (exmem.valid) {
+					tracer->stage(time, exmem.id, exmem.PC - 4, exmem.instruction, exmem.thread, l, STAGE_EX);
+				}
+				const IDEX &idex = next->idex[l];
+				if (idex.valid) {
+					tracer->stage(time, idex.id, idex.PC - 4, idex.instruction, idex.thread, l, STAGE_ID);
+				}
+				const IFID &ifid = next->ifid[l];
+				if (ifid.valid) {
+					tracer->stage(time, ifid.id, ifid.PC - 4, ifid.instruction, ifid.thread, l, STAGE_IF);
+				}
+			}
+			tracer->end_cycle(time);
+		}
+
+		//Charges the cycle about to be simulated to the head of the pipeline
+		void profile_cycle() {
+			for (unsigned l = 0; l < Width; l++) {
+				if (cur->memwb[l].valid) {
+					profiler->charge(cur->memwb[l].PC - 4, PROFILE_BASE, 1);
+					return;
+				}
+			}
+			profiler->charge(head_pc(), cpi_flush(first_bubble()) ? PROFILE_FLUSH : PROFILE_STALL, 1);
+		}
+
+		//Why the oldest empty lane of memwb is empty, CPI_BASE if a full group retires
+		cpi_category first_bubble() const {
+			for (unsigned l = 0; l < Width; l++) {
+				if (!cur->memwb[l].valid) {
+					return (cpi_category)cur->memwb[l].bubble;
+				}
+			}
+			return CPI_BASE;
+		}
+
+	public:
+		// Everything needed to resume the pipeline. It is plain data so a
+		// checkpoint stores it as raw bytes.
+		struct Snapshot {
+			PipelineLatches<Width> latches;
+			FetchPolicy predictor;
+			MulDivUnit muldiv;
+			uint64_t time;         //engine cycle, the multiply/divide unit times are relative to it
+			uint64_t memRemaining; //cycles until the pending access completes
+			bool memPending;
+		};
+
+		InOrderPipeline(Registers &reg_file, Memory &memory, uint32_t end_pc, const PipelineConfig &config = PipelineConfig()) :
+				branchCount(0), mispredictCount(0), loadCount(0), storeCount(0), fetchPolicy(config.smtFetch), fetchThread(0), memory(memory), predictor(config), muldiv(config), memLatency(config.memLatency), memPending(false), memReady(false), fetching(true), coherent(NULL), core(0), checker(NULL), profiler(NULL), tracer(NULL), cpiStack(NULL), fetched(0) {
+			for (unsigned t = 0; t < Threads; t++) {
+				regs[t] = &reg_file;
+				base[t] = 0;
+				endPC[t] = end_pc;
+				finished[t] = t != 0; //until set_thread gives it a program
+				retiredCount[t] = 0;
+			}
+			cur = &latches[0];
+			next = &latches[1];
+			cur->clear();
+			next->clear();
+		}
+
+		// Gives a hardware thread its registers and the program loaded at base
+		void set_thread(unsigned thread, Registers &reg_file, uint32_t threadBase, uint32_t end_pc) {
+			regs[thread] = &reg_file;
+			base[thread] = threadBase;
+			endPC[thread] = end_pc;
+			finished[thread] = false;
+		}
+
+		// Instructions a hardware thread has retired
+		uint64_t retired(unsigned thread) const {
+			return retiredCount[thread];
+		}
+
+		// Event counts of the whole run, for interval statistics
+		uint64_t branches() const {
+			return branchCount;
+		}
+
+		uint64_t mispredicts() const {
+			return mispredictCount;
+		}
+
+		uint64_t loads() const {
+			return loadCount;
+		}
+
+		uint64_t stores() const {
+			return storeCount;
+		}
+
+		// True once a hardware thread has retired its last instruction
+		bool thread_finished(unsigned thread) const {
+			return finished[thread];
+		}
+
+		// Routes data accesses through a core's L1 in a multicore run
+		void attach(CoherentMemory *memory, unsigned coreNumber) {
+			coherent = memory;
+			core = coreNumber;
+		}
+
+		// Compares every retiring instruction with a golden model
+		void check(LockstepChecker *golden) {
+			checker = golden;
+		}
+
+		// Charges every cycle and follows calls for a guest profile
+		void profile(GuestProfiler *guestProfiler) {
+			profiler = guestProfiler;
+		}
+
+		// Writes the life of every instruction to a pipeline viewer trace
+		void trace(PipeTrace *pipeTrace) {
+			tracer = pipeTrace;
+		}
+
+		// Charges every cycle to a CPI stack category
+		void account(CpiStack *stack) {
+			cpiStack = stack;
+		}
+
+		// Advance the pipeline by one clock. committed is set to the number of
+		// instructions written back, returns true once the last instruction has
+		// left the pipeline.
+		bool cycle(uint32_t &committed) {
+			bool endIt = false;
+			committed = 0;
+
+			Event event;
+			while (events.pop(event)) {
+				if (event.kind == EVENT_MEM_COMPLETE) {
+					memReady = true;
+				}
+			}
+
+			if (profiler) {
+				profile_cycle();
+			}
+			if (cpiStack) {
+				cpiStack->charge(first_bubble());
+			}
+			for (unsigned l = 0; l < Width; l++) {
+				const MEMWB &memwb = cur->memwb[l];
+				unsigned t = slot(memwb.thread);
+				if (memwb.valid && !finished[t]) {
+					if (memwb.PC - 4 == endPC[t]) { //memwb.PC carries PC+4, the slot at end_pc holds no instruction
+						finished[t] = true;
+						endIt = all_finished();
+						continue;
+					}
+					if (checker) {
+						checker->retire(retirement(memwb));
+					}
+					if (profiler) {
+						profiler->retire(memwb.PC - 4, memwb.instruction);
+					}
+					if (memwb.control.mem_write && memwb.ALUresult >= COUNTER_PAGE && memory.counters) {
+						memory.counters->write(memwb.ALUresult & ~3u, committed); //ROI markers count the lanes retired ahead of them
+					}
+					writeback(memwb);
+					committed++;
+					retiredCount[t]++;
+				}
+			}
+
+			//A multi-cycle access holds everything behind MEM until it completes
+			if (!memPending && !memReady && (memLatency > 1 || coherent) && memory_op_waiting()) {
+				uint32_t latency = data_latency();
+				if (latency > 1) {
+					events.schedule(latency - 1, EVENT_MEM_COMPLETE);
+					memPending = true;
+				}
+			}
+			if (memPending && !memReady) {
+				freeze();
+				if (tracer) {
+					trace_cycle();
+				}
+				std::swap(cur, next);
+				events.advance(1);
+				return endIt;
+			}
+			memPending = false;
+			memReady = false;
+
+			//MEMWB Pipeline -> Memory writes into pipeline
+			for (unsigned l = 0; l < Width; l++) {
+				memory_access(cur->exmem[l], next->memwb[l]);
+			}
+			Forwarding::memory_to_memory(next->memwb, cur->idex);
+
+			//EXMEM Pipeline -> ALU result writes into pipeline
+			for (unsigned l = 0; l < Width; l++) {
+				execute(alu[l], cur->idex[l], next->exmem[l]);
+			}
+
+			//The oldest lane of a thread whose outcome differs from the prediction redirects its fetch, younger lanes of the thread are squashed
+			uint32_t flushed = 0; //threads redirected this cycle
+			uint32_t PCoption[Threads] = {};       //only read for the threads in flushed
+			cpi_category flushCause[Threads] = {};
+			cpi_category redirect = CPI_FILL; //cause of the last redirect, what an unfetched lane waits on
+			for (unsigned l = 0; l < Width; l++) {
+				EXMEM &exmem = next->exmem[l];
+				if (!exmem.valid) {
+					continue;
+				}
+				unsigned t = slot(exmem.thread);
+				if (flushed & (1u << t)) {
+					exmem.valid = false;
+					exmem.bubble = flushCause[t];
+					continue;
+				}
+				PCoption[t] = resolve(exmem);
+				if (exmem.PCsrc != exmem.branchPred) {
+					flushed |= 1u << t;
+					flushCause[t] = exmem.control.branch ? CPI_MISPREDICT : CPI_REDIRECT;
+					redirect = flushCause[t];
+					mispredictCount += exmem.control.branch;
+				}
+				branchCount += exmem.control.branch;
+			}
+
+			//HI/LO are written once it is known the instruction was not squashed
+			for (unsigned l = 0; l < Width; l++) {
+				const EXMEM &exmem = next->exmem[l];
+				if (exmem.valid && exmem.control.mulDiv) {
+					Registers &reg_file = thread_regs(exmem.thread);
+					ALU::multiply_divide(exmem.instruction & 0b111111, exmem.readData1, exmem.readData2, reg_file.hi, reg_file.lo);
+				}
+			}
+
+			//IDEX Pipeline -> Lanes issue in order until the first stalled one
+			scoreboard.build(next->exmem, next->memwb);
+			uint32_t groupWrites[Threads] = {0}; //registers written by the lanes issued so far
+			unsigned issued = 0;
+			unsigned stalled = Threads; //thread of the stalled instruction
+			cpi_category stall = CPI_BASE;
+			while (issued < Width) {
+				const IFID &ifid = cur->ifid[issued];
+				unsigned t = slot(ifid.thread);
+				const control_t &controlUnit = decoded_control(ifid.opcode, ifid.Funct);
+				if (HazardUnit::stall(scoreboard, ifid, controlUnit, groupWrites[t])) {
+					stalled = t;
+					//Held only for the older lane of its group, it would issue alone
+					stall = HazardUnit::stall(scoreboard, ifid, controlUnit, 0) ? CPI_LOAD_USE : CPI_SECOND_LANE;
+					break;
+				}
+				if (ifid.valid && !muldiv.can_issue(controlUnit, events.time() + 1)) { //structural or HI/LO hazard
+					stalled = t;
+					stall = CPI_STRUCTURAL;
+					break;
+				}
+				if (ifid.valid && (flushed & (1u << t)) == 0) {
+					muldiv.issue(controlUnit, events.time() + 1);
+				}
+				decode(ifid, controlUnit, next->idex[issued]);
+				if (ifid.valid) {
+					Forwarding::execute(scoreboard, next->exmem, next->memwb, next->idex[issued]);
+				}
+				uint32_t dest = destination(ifid, controlUnit);
+				if (dest != 0) {
+					groupWrites[t] |= 1u << dest;
+				}
+				issued++;
+			}
+			for (unsigned l = issued; l < Width; l++) {
+				next->idex[l].valid = false; //STALL, nothing is written to the idex
+				next->idex[l].bubble = stall;
+			}
+
+			//IFID Pipeline -> Actual!=Predicted empties the ifid and idex of the redirected threads
+			for (unsigned t = 0; t < Threads; t++) {
+				if (flushed & (1u << t)) {
+					thread_regs(t).pc = PCoption[t];
+				}
+			}
+			if (flushed) {
+				for (unsigned l = 0; l < Width; l++) {
+					unsigned t = slot(next->idex[l].thread);
+					if (flushed & (1u << t)) {
+						next->idex[l].valid = false;
+						next->idex[l].bubble = flushCause[t];
+					}
+				}
+			}
+
+			//Stalled instructions move to the oldest lanes, fetch fills the rest
+			unsigned kept = 0;
+			for (unsigned l = issued; l < Width; l++) {
+				if ((flushed & (1u << slot(cur->ifid[l].thread))) == 0) {
+					next->ifid[kept++] = cur->ifid[l];
+				}
+			}
+			unsigned thread = fetching ? fetch_thread(flushed, stalled, kept) : Threads;
+			for (unsigned l = kept; l < Width; l++) {
+				if (thread != Threads) {
+					fetch(next->ifid[l], thread);
+				}
+				else {
+					next->ifid[l].valid = false;
+					next->ifid[l].bubble = redirect; //the redirected thread fetches from next cycle
+				}
+			}
+
+			if (tracer) {
+				trace_cycle();
+			}
+			std::swap(cur, next);
+			events.advance(1);
+			return endIt;
+		}
+
+		// Number of upcoming cycles in which the pipeline only waits on an
+		// event. Nothing changes state during them, so skip() can jump over them
+		// while the caller accounts for them as ordinary cycles.
+		uint64_t idle() const {
+			if (!memPending) {
+				return 0;
+			}
+			for (unsigned l = 0; l < Width; l++) {
+				if (cur->memwb[l].valid) {
+					return 0;
+				}
+			}
+			return events.next_time() - events.time();
+		}
+
+		void skip(uint64_t cycles) {
+			if (profiler && cycles != 0) {
+				profiler->charge(head_pc(), PROFILE_STALL, cycles);
+			}
+			if (cpiStack && cycles != 0) {
+				cpiStack->charge(CPI_MEMORY, cycles);
+			}
+			if (tracer && cycles != 0 && tracer->tracing(events.time())) {
+				tracer->wait(events.time(), cycles);
+			}
+			events.advance(cycles);
+		}
+
+		// True when no instruction is in flight
+		bool empty() const {
+			for (unsigned l = 0; l < Width; l++) {
+				if (cur->ifid[l].valid || cur->idex[l].valid || cur->exmem[l].valid || cur->memwb[l].valid) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// Stops fetching and runs until every instruction in flight has retired,
+		// which leaves reg_file.pc at the next instruction to execute so a
+		// functional model can take over. Returns the number of instructions
+		// retired, ended is set if the program finished meanwhile.
+		uint64_t drain(bool &ended) {
+			uint64_t retired = 0;
+			ended = false;
+			fetching = false;
+			while (!empty()) {
+				uint32_t committed = 0;
+				ended |= cycle(committed);
+				retired += committed;
+				skip(idle());
+			}
+			fetching = true;
+			return retired;
+		}
+
+		// Functional warming: trains the predictor with a branch executed outside the pipeline
+		void train_predictor(uint32_t PC, bool taken) {
+			predictor.update(PC, taken);
+		}
+
+		// State between two cycles
+		void save(Snapshot &snapshot) const {
+			snapshot.latches = *cur;
+			snapshot.predictor = predictor;
+			snapshot.muldiv = muldiv;
+			snapshot.time = events.time();
+			snapshot.memPending = memPending;
+			snapshot.memRemaining = memPending ? events.next_time() - events.time() : 0;
+		}
+
+		void restore(const Snapshot &snapshot) {
+			*cur = snapshot.latches;
+			predictor = snapshot.predictor;
+			muldiv = snapshot.muldiv;
+			events = TimingWheel<64>();
+			events.advance(snapshot.time);
+			memPending = snapshot.memPending;
+			memReady = false;
+			if (memPending) {
+				events.schedule(snapshot.memRemaining, EVENT_MEM_COMPLETE);
+			}
+		}
+};
+
+// The 5-stage models
+typedef InOrderPipeline<NoPredictor, 1, FullForwarding, LoadUseHazard> PipelinedProcessor;
+typedef InOrderPipeline<GHRPredictor, 1, FullForwarding, LoadUseHazard> SpeculativeProcessor;
+typedef InOrderPipeline<GHRPredictor, 2, FullForwarding, LoadUseHazard> IOSuperscalarProcessor;
+
+// The same models shared by several hardware threads
+template <unsigned Threads> using PipelinedSMT = InOrderPipeline<NoPredictor, 1, FullForwarding, LoadUseHazard, Threads>;
+template <unsigned Threads> using SpeculativeSMT = InOrderPipeline<GHRPredictor, 1, FullForwarding, LoadUseHazard, Threads>;
+template <unsigned Threads> using IOSuperscalarSMT = InOrderPipeline<GHRPredictor, 2, FullForwarding, LoadUseHazard, Threads>;
+
+#endif
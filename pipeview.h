@@ -0,0 +1,255 @@
+#ifndef PIPEVIEW
+#define PIPEVIEW
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <sstream>
+
+// Instruction lifecycle trace of the pipeline models in the Kanata format
+// read by the Konata pipeline viewer. Each cycle the pipeline reports which
+// instruction sits in each pipeline register and the trace turns that into
+// stage changes: an instruction fetched into IFID is in IF, then ID in IDEX,
+// EX in EXMEM, MEM in MEMWB and WB the cycle it is written back. One that
+// leaves without reaching writeback was squashed and is shown flushed. Cycles
+// spent in a stage beyond the first are counted as stalls in its label.
+//
+// Only cycles in [from, from + cycles) are traced and the output is buffered,
+// so a window of a long run stays cheap.
+
+// Assembly of an instruction the control table decodes, for the labels
+static std::string disassemble(uint32_t instruction) {
+	static const char *const rtype[64] = {
+		"sll", 0, "srl", 0, 0, 0, 0, 0, "jr", 0, 0, 0, 0, 0, 0, 0,
+		"mfhi", 0, "mflo", 0, 0, 0, 0, 0, "mult", "multu", "div", "divu", 0, 0, 0, 0,
+		"add", "addu", "sub", "subu", "and", "or", 0, "nor", 0, 0, "slt", "sltu"};
+	static const char *const itype[64] = {
+		0, 0, "j", "jal", "beq", "bne", 0, 0, "addi", "addiu", "slti", "sltiu", "andi", "ori", 0, "lui",
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, "lw", "lbu", "lhu", 0, 0, "sb", "sh", 0, "sw"};
+	uint32_t opcode = instruction >> 26;
+	uint32_t rs = (instruction >> 21) & 0b11111;
+	uint32_t rt = (instruction >> 16) & 0b11111;
+	uint32_t rd = (instruction >> 11) & 0b11111;
+	uint32_t funct = instruction & 0b111111;
+	int32_t imm = (int16_t)(instruction & 0xFFFF);
+	const char *name = opcode == 0 ? rtype[funct] : itype[opcode];
+	std::ostringstream out;
+	if (instruction == 0) {
+		return "nop";
+	}
+	if (name == 0) {
+		out << ".word 0x" << std::hex << instruction;
+		return out.str();
+	}
+	out << name << " ";
+	if (opcode == 0) {
+		if (funct == 0 || funct == 2) {
+			out << "$" << rd << ", $" << rt << ", " << ((instruction >> 6) & 0b11111);
+		}
+		else if (funct == 8) {
+			out << "$" << rs;
+		}
+		else if (funct == 16 || funct == 18) {
+			out << "$" << rd;
+		}
+		else if (funct >= 24 && funct <= 27) {
+			out << "$" << rs << ", $" << rt;
+		}
+		else {
+			out << "$" << rd << ", $" << rs << ", $" << rt;
+		}
+	}
+	else if (opcode == 2 || opcode == 3) {
+		out << "0x" << std::hex << ((instruction & 0x3FFFFFF) << 2);
+	}
+	else if (opcode == 4 || opcode == 5) {
+		out << "$" << rs << ", $" << rt << ", " << imm;
+	}
+	else if (opcode == 15) {
+		out << "$" << rt << ", 0x" << std::hex << (instruction & 0xFFFF);
+	}
+	else if (opcode == 12 || opcode == 13) { //zero-extended
+		out << "$" << rt << ", $" << rs << ", 0x" << std::hex << (instruction & 0xFFFF);
+	}
+	else if (opcode >= 32) {
+		out << "$" << rt << ", " << imm << "($" << rs << ")";
+	}
+	else {
+		out << "$" << rt << ", $" << rs << ", " << imm;
+	}
+	return out.str();
+}
+
+enum pipe_stage {STAGE_IF, STAGE_ID, STAGE_EX, STAGE_MEM, STAGE_WB, STAGE_NONE};
+
+class PipeTrace {
+	private:
+		static const unsigned RING = 256; //more than can be in flight, indexed by id
+		static const size_t FLUSH_AT = 1 << 20;
+
+		struct Record {
+			uint32_t id;
+			pipe_stage stage;
+			unsigned stalls;       //cycles in the stage beyond the first
+			bool seen;             //reported again this cycle
+		};
+
+		FILE *file;
+		std::string buffer;
+		uint64_t from;
+		uint64_t until;
+		uint64_t written;          //cycle the last events were written at
+		uint64_t retired;
+		bool started;
+		Record ring[RING];
+		std::vector<uint32_t> inFlight;   //ids traced so far that have not left
+		std::vector<uint32_t> writingBack; //ids in WB this cycle, retired at the next
+
+		static const char *name(pipe_stage stage) {
+			static const char *const names[] = {"IF", "ID", "EX", "MEM", "WB"};
+			return names[stage];
+		}
+
+		void event(uint64_t cycle, const std::string &line) {
+			if (!started) {
+				std::ostringstream header;
+				header << "Kanata\t0004\nC=\t" << cycle << "\n";
+				buffer += header.str();
+				written = cycle;
+				started = true;
+			}
+			if (cycle > written) {
+				std::ostringstream advance;
+				advance << "C\t" << cycle - written << "\n";
+				buffer += advance.str();
+				written = cycle;
+			}
+			buffer += line;
+			if (buffer.size() >= FLUSH_AT) {
+				flush();
+			}
+		}
+
+		//Ends the instruction's current stage, noting the cycles it stalled in it
+		void leave(uint64_t cycle, Record &record) {
+			std::ostringstream out;
+			if (record.stalls > 0) {
+				out << "L\t" << record.id << "\t1\t, " << name(record.stage) << " stalled " << record.stalls << "\n";
+			}
+			out << "E\t" << record.id << "\t0\t" << name(record.stage) << "\n";
+			event(cycle, out.str());
+			record.stalls = 0;
+		}
+
+		void enter(uint64_t cycle, Record &record, pipe_stage stage) {
+			if (record.stage != STAGE_NONE) {
+				leave(cycle, record);
+			}
+			record.stage = stage;
+			std::ostringstream out;
+			out << "S\t" << record.id << "\t0\t" << name(stage) << "\n";
+			event(cycle, out.str());
+		}
+
+		void end(uint64_t cycle, Record &record, bool flushed) {
+			if (flushed) {
+				std::ostringstream out;
+				out << "L\t" << record.id << "\t1\t, squashed in " << name(record.stage) << "\n";
+				event(cycle, out.str());
+			}
+			leave(cycle, record);
+			std::ostringstream retire;
+			retire << "R\t" << record.id << "\t" << (flushed ? 0 : retired++) << "\t" << (flushed ? 1 : 0) << "\n";
+			event(cycle, retire.str());
+			record.stage = STAGE_NONE;
+		}
+
+		//Instructions written back last cycle retire
+		void retire(uint64_t cycle) {
+			for (size_t i = 0; i < writingBack.size(); i++) {
+				end(cycle, ring[writingBack[i] % RING], false);
+			}
+			writingBack.clear();
+		}
+
+	public:
+		PipeTrace(FILE *file, uint64_t from, uint64_t cycles) :
+				file(file), from(from), until(cycles > UINT64_MAX - from ? UINT64_MAX : from + cycles), written(0), retired(0), started(false) {
+			for (unsigned i = 0; i < RING; i++) {
+				ring[i].stage = STAGE_NONE;
+			}
+		}
+
+		~PipeTrace() {
+			if (started && tracing(written + 1)) {
+				retire(written + 1); //what the last cycle wrote back
+			}
+			flush();
+		}
+
+		bool tracing(uint64_t cycle) const {
+			return cycle >= from && cycle < until;
+		}
+
+		// The instruction id is in the stage during cycle, lane is its place in a superscalar group
+		void stage(uint64_t cycle, uint32_t id, uint32_t pc, uint32_t instruction, unsigned thread, unsigned lane, pipe_stage stage) {
+			Record &record = ring[id % RING];
+			if (record.stage == STAGE_NONE || record.id != id) {
+				record.id = id;
+				record.stage = STAGE_NONE;
+				record.stalls = 0;
+				inFlight.push_back(id);
+				std::ostringstream out;
+				out << "I\t" << id << "\t" << id << "\t" << thread << "\n"
+						<< "L\t" << id << "\t0\t" << std::hex << pc << std::dec << ": " << disassemble(instruction) << "\n"
+						<< "L\t" << id << "\t1\tfetched in lane " << lane << "\n";
+				event(cycle, out.str());
+			}
+			record.seen = true;
+			if (record.stage == stage) {
+				record.stalls++;
+			}
+			else {
+				enter(cycle, record, stage);
+			}
+		}
+
+		// Called once every instruction in flight has been reported for the cycle
+		void end_cycle(uint64_t cycle) {
+			retire(cycle);
+			size_t kept = 0;
+			for (size_t i = 0; i < inFlight.size(); i++) {
+				Record &record = ring[inFlight[i] % RING];
+				if (record.seen) {
+					record.seen = false;
+					inFlight[kept++] = inFlight[i];
+				}
+				else if (record.stage == STAGE_MEM) {
+					enter(cycle, record, STAGE_WB); //written back at the start of the cycle
+					writingBack.push_back(record.id);
+				}
+				else {
+					end(cycle, record, true);
+				}
+			}
+			inFlight.resize(kept);
+		}
+
+		// Nothing moves for cycles cycles from cycle on, the pipeline is waiting on memory
+		void wait(uint64_t cycle, uint64_t cycles) {
+			retire(cycle);
+			for (size_t i = 0; i < inFlight.size(); i++) {
+				ring[inFlight[i] % RING].stalls += cycles;
+			}
+		}
+
+		void flush() {
+			if (!buffer.empty()) {
+				fwrite(buffer.data(), 1, buffer.size(), file);
+				buffer.clear();
+			}
+		}
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef PREDICTOR
+#define PREDICTOR
+#include <cstdint>
+#include <algorithm>
+#include "options.h"
+
+// Branch prediction policies used by the fetch stage of the pipeline engine.
+// predict() is called with the address of a BEQ/BNE being fetched and
+// update() with the resolved direction once the branch reaches EXMEM.
+
+// No prediction, every branch is fetched as not taken (pipelined processor)
+struct NoPredictor {
+	NoPredictor(const PipelineConfig &config = PipelineConfig()) {}
+
+	bool predict(uint32_t PC) {
+		return false;
+	}
+	void update(uint32_t PC, bool actual) {}
+};
+
+// 2-bit saturating counters indexed by PC XOR global history (speculative processors).
+// The table has config.bhtEntries counters, a power of two, and the GHR keeps
+// the last config.historyBits outcomes with the newest in its top bit. The
+// table is a fixed array sized for the largest configuration so snapshots of
+// the predictor stay plain data.
+const uint32_t GHR_MAX_ENTRIES = 65536;
+const uint32_t GHR_MAX_HISTORY = 16;
+
+class GHRPredictor {
+	private:
+		uint32_t GHR;
+		uint32_t indexMask;          //bhtEntries - 1
+		uint32_t historyTop;         //bit the newest outcome goes in, 0 without history
+		uint8_t BHT[GHR_MAX_ENTRIES];    //Branch History Table
+
+	public:
+		GHRPredictor(const PipelineConfig &config = PipelineConfig()) {
+			GHR = 0;
+			indexMask = std::min(config.bhtEntries, GHR_MAX_ENTRIES) - 1;
+			historyTop = config.historyBits ? 1u << (std::min(config.historyBits, GHR_MAX_HISTORY) - 1) : 0;
+			for (uint32_t i=0; i<=indexMask; i++) {
+				BHT[i] = 1; //initalize to all "weakly NT"
+				//00 - strongly NT
+				//01 - weakly NT
+				//10 - weakly T
+				//11 - strongly T
+			}
+		}
+
+		//Predict
+		bool predict(uint32_t PC) {
+			uint32_t BHTIndex = (PC ^ GHR) & indexMask; //low bits of program counter XOR'ed with the GHR
+			int predict = BHT[BHTIndex];
+			if (predict == 0 || predict == 1) { //00 or 01 (strongly NT or weakly NT)
+				return false;
+			}
+			return true;
+		}
+
+		//Update
+		void update(uint32_t PC, bool actual) {
+			uint32_t predicted = (PC ^ GHR) & indexMask;
+			if (actual == true) { //Taken
+				BHT[predicted] = std::min(BHT[predicted]+1, 3);
+				GHR = GHR >> 1;
+				GHR |= historyTop; //update most significant bit to 1
+			}
+			else { //Not Taken
+				BHT[predicted] = std::max(BHT[predicted]-1, 0);
+				GHR = GHR >> 1; //updates most significant bit to 0
+			}
+		}
+};
+
+#endif
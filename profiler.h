@@ -0,0 +1,217 @@
+#ifndef PROFILER
+#define PROFILER
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include "symbols.h"
+
+// Guest profiler for the pipeline models. Every simulated cycle is charged to
+// the instruction at the head of the pipeline, the oldest one in flight:
+//   base  - an instruction retired this cycle
+//   stall - nothing retired because of a hazard, the multiply/divide unit, a
+//           memory access or an empty fetch
+//   flush - nothing retired because a mispredict or jump squashed the
+//           instructions that would have
+// Calls and returns are followed at retirement, JAL enters the function at its
+// target and JR $ra leaves it. Each path of calls is a context of a calling
+// context tree that is charged alongside the PC, which gives inclusive time,
+// the call graph and folded stacks for flame graphs.
+
+enum profile_category {PROFILE_BASE, PROFILE_STALL, PROFILE_FLUSH, PROFILE_CATEGORIES};
+
+class GuestProfiler {
+	private:
+		struct Context {
+			uint32_t function; //entry address
+			uint32_t parent;   //index of the calling context
+			uint64_t calls;
+			uint64_t cycles[PROFILE_CATEGORIES];
+		};
+
+		struct Counts {
+			uint64_t cycles[PROFILE_CATEGORIES];
+			uint64_t calls;
+
+			uint64_t total() const {
+				return cycles[PROFILE_BASE] + cycles[PROFILE_STALL] + cycles[PROFILE_FLUSH];
+			}
+		};
+
+		struct Edge {
+			uint64_t calls;
+			uint64_t cycles; //inclusive cycles of the callee when called from here, 0 for a recursive call
+		};
+
+		uint32_t end_pc;
+		std::vector<uint64_t> pcCycles;   //PROFILE_CATEGORIES per text word, the last word counts everything from end_pc on
+		std::vector<Context> contexts;    //contexts[0] is the program entry, a context comes after its parent
+		std::map<std::pair<uint32_t, uint32_t>, uint32_t> children; //(parent, function) -> context
+		uint32_t current;
+		uint64_t total[PROFILE_CATEGORIES];
+
+		static uint64_t sum(const uint64_t *cycles) {
+			return cycles[PROFILE_BASE] + cycles[PROFILE_STALL] + cycles[PROFILE_FLUSH];
+		}
+
+		void call(uint32_t target) {
+			std::pair<uint32_t, uint32_t> key(current, target);
+			std::map<std::pair<uint32_t, uint32_t>, uint32_t>::const_iterator child = children.find(key);
+			if (child == children.end()) {
+				Context context = {target, current, 0, {0, 0, 0}};
+				contexts.push_back(context);
+				child = children.insert(std::make_pair(key, (uint32_t)contexts.size() - 1)).first;
+			}
+			current = child->second;
+			contexts[current].calls++;
+		}
+
+		//Cycles spent in each context and the contexts it called
+		std::vector<uint64_t> inclusive() const {
+			std::vector<uint64_t> cycles(contexts.size());
+			for (size_t c = contexts.size(); c-- > 0;) {
+				cycles[c] += sum(contexts[c].cycles);
+				if (c != 0) {
+					cycles[contexts[c].parent] += cycles[c];
+				}
+			}
+			return cycles;
+		}
+
+		//True if the function is also entered further up the path of context c
+		bool recursive(size_t c) const {
+			for (size_t up = c; up != 0;) {
+				up = contexts[up].parent;
+				if (contexts[up].function == contexts[c].function) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		static void row(std::ostream &out, const uint64_t *cycles, uint64_t all) {
+			uint64_t self = sum(cycles);
+			out << std::setw(7) << std::fixed << std::setprecision(2) << (all ? 100.0 * self / all : 0.0) << "% "
+					<< std::setw(12) << self << std::setw(12) << cycles[PROFILE_BASE] << std::setw(12) << cycles[PROFILE_STALL]
+					<< std::setw(12) << cycles[PROFILE_FLUSH];
+		}
+
+	public:
+		GuestProfiler(uint32_t end_pc, uint32_t entry = 0) : end_pc(end_pc), pcCycles((end_pc / 4 + 1) * PROFILE_CATEGORIES), current(0) {
+			Context root = {entry, 0, 1, {0, 0, 0}};
+			contexts.push_back(root);
+			std::fill(total, total + PROFILE_CATEGORIES, 0);
+		}
+
+		// Charges cycles to the instruction at pc and the current context
+		void charge(uint32_t pc, profile_category category, uint64_t cycles) {
+			size_t word = std::min(pc, end_pc) / 4;
+			pcCycles[word * PROFILE_CATEGORIES + category] += cycles;
+			contexts[current].cycles[category] += cycles;
+			total[category] += cycles;
+		}
+
+		// Follows calls and returns through an instruction that retired
+		void retire(uint32_t pc, uint32_t instruction) {
+			uint32_t opcode = instruction >> 26;
+			if (opcode == 3) { //JAL
+				call(((instruction & 0x3FFFFFF) << 2) | ((pc + 4) & 0xF0000000));
+			}
+			else if (opcode == 0 && (instruction & 0b111111) == 8 && ((instruction >> 21) & 0b11111) == 31 && current != 0) { //JR $ra
+				current = contexts[current].parent;
+			}
+		}
+
+		uint64_t cycles() const {
+			return sum(total);
+		}
+
+		// Flat profile of the functions, the call graph and the hottest PCs
+		void report(std::ostream &out, SymbolTable &symbols, unsigned hottest = 20) const {
+			uint64_t all = cycles();
+			out << "Guest profile: " << all << " cycles, " << total[PROFILE_BASE] << " base, " << total[PROFILE_STALL] << " stall, "
+					<< total[PROFILE_FLUSH] << " flush\n\n";
+
+			//Functions by the cycles spent in them
+			std::vector<uint64_t> tree = inclusive();
+			std::map<uint32_t, Counts> functions;
+			std::map<std::pair<uint32_t, uint32_t>, Edge> edges; //(caller, callee)
+			for (size_t c = 0; c < contexts.size(); c++) {
+				Counts &function = functions[contexts[c].function];
+				for (unsigned k = 0; k < PROFILE_CATEGORIES; k++) {
+					function.cycles[k] += contexts[c].cycles[k];
+				}
+				if (c != 0) {
+					function.calls += contexts[c].calls;
+					Edge &edge = edges[std::make_pair(contexts[contexts[c].parent].function, contexts[c].function)];
+					edge.calls += contexts[c].calls;
+					if (!recursive(c)) {
+						edge.cycles += tree[c];
+					}
+				}
+			}
+			std::map<uint32_t, uint64_t> below; //inclusive cycles, a recursive call counted once
+			for (size_t c = 0; c < contexts.size(); c++) {
+				if (!recursive(c)) {
+					below[contexts[c].function] += tree[c];
+				}
+			}
+			std::vector<std::pair<uint64_t, uint32_t> > order;
+			for (std::map<uint32_t, Counts>::const_iterator f = functions.begin(); f != functions.end(); f++) {
+				order.push_back(std::make_pair(f->second.total(), f->first));
+			}
+			std::sort(order.rbegin(), order.rend());
+			out << "Flat profile\n"
+					"   self%         self        base       stall       flush   inclusive       calls  function\n";
+			for (size_t i = 0; i < order.size(); i++) {
+				const Counts &function = functions[order[i].second];
+				row(out, function.cycles, all);
+				out << std::setw(12) << below[order[i].second] << std::setw(12) << function.calls << "  " << symbols.describe(order[i].second) << "\n";
+			}
+
+			out << "\nCall graph\n"
+					"       calls   inclusive  caller -> callee\n";
+			for (std::map<std::pair<uint32_t, uint32_t>, Edge>::const_iterator e = edges.begin(); e != edges.end(); e++) {
+				out << std::setw(12) << e->second.calls << std::setw(12) << e->second.cycles << "  "
+						<< symbols.describe(e->first.first) << " -> " << symbols.describe(e->first.second) << "\n";
+			}
+
+			//PCs by the cycles charged to them
+			std::vector<std::pair<uint64_t, uint32_t> > pcs;
+			for (size_t word = 0; word * PROFILE_CATEGORIES < pcCycles.size(); word++) {
+				uint64_t cycles = sum(&pcCycles[word * PROFILE_CATEGORIES]);
+				if (cycles != 0) {
+					pcs.push_back(std::make_pair(cycles, word * 4));
+				}
+			}
+			std::sort(pcs.rbegin(), pcs.rend());
+			pcs.resize(std::min<size_t>(pcs.size(), hottest));
+			out << "\nHottest PCs\n"
+					"   self%         self        base       stall       flush          pc  location\n";
+			for (size_t i = 0; i < pcs.size(); i++) {
+				row(out, &pcCycles[pcs[i].second / 4 * PROFILE_CATEGORIES], all);
+				out << std::setw(12) << std::hex << pcs[i].second << std::dec << "  "
+						<< (pcs[i].second == end_pc ? std::string("(past the end)") : symbols.describe(pcs[i].second)) << "\n";
+			}
+		}
+
+		// One line per calling context, "entry;caller;callee cycles", for flamegraph.pl
+		void folded(std::ostream &out, SymbolTable &symbols) const {
+			std::vector<std::string> paths(contexts.size());
+			for (size_t c = 0; c < contexts.size(); c++) {
+				std::string name = symbols.describe(contexts[c].function);
+				std::replace(name.begin(), name.end(), ';', ':');
+				std::replace(name.begin(), name.end(), ' ', '_');
+				paths[c] = c == 0 ? name : paths[contexts[c].parent] + ";" + name;
+				uint64_t cycles = sum(contexts[c].cycles);
+				if (cycles != 0) {
+					out << paths[c] << " " << cycles << "\n";
+				}
+			}
+		}
+};
+
+#endif
@@ -8,9 +8,9 @@ class Registers {
         std::vector<int32_t> R;
     public:
         uint32_t pc;
-        Registers() {
-            R.resize(32,0);
-        }
+        uint32_t hi; // HI and LO, written by multiply and divide
+        uint32_t lo;
+        Registers() : R(32, 0), hi(0), lo(0) {}
 	// read_reg_1, read_reg_2 are register numbers from which the data should be read
 	// read_data_1, read_data_2 are variables into which the data is read. These are passed by reference
 	// write_reg is the register number to which the data needs to be written
@@ -26,8 +26,11 @@ class Registers {
         }
 	// Prints the contents of all the registers
         void print() {
+            print(std::cout);
+        }
+        void print(std::ostream &out) {
             for(int i = 0; i < 32; ++i) {
-                std::cout << "R[" << i << "]: " << R[i] << "\n";
+                out << "R[" << i << "]: " << R[i] << "\n";
             }
         }
 	// Prints the contents of the register specified by reg 
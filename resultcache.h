@@ -0,0 +1,205 @@
+#ifndef RESULTCACHE
+#define RESULTCACHE
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include "loader.h"
+#include "sweep.h"
+
+// On-disk cache of the results of --sweep and --serve runs. The models are
+// deterministic, so a run is fully described by its program (program_key()),
+// processor, cores, effective configuration (ParameterRegistry::ini()) and the
+// simulator that ran it, identified by the hash of its own executable. The
+// hash of that description names a file in the cache directory holding the
+// description followed by the counts; a hit is only taken if the stored
+// description matches, so colliding hashes just miss. The description starts
+// with RESULT_SCHEMA, raised whenever what the counts mean changes, so entries
+// of older simulators are never taken even where the build hash falls back to
+// the build time.
+//
+// Hits refresh the file's modification time. Once the files add up to more
+// than the size bound, the least recently used are removed until they take
+// three quarters of it. Entries are written to a temporary file and renamed
+// into place, so concurrent runs and processes never see a partial one.
+
+// Version of the counts stored, 2 since the pipelines stopped counting the slot at end_pc
+static const unsigned RESULT_SCHEMA = 2;
+
+class ResultCache {
+	private:
+		std::mutex lock;
+		std::string dir;
+		uint64_t limit;  //bytes the entries may take
+		uint64_t used;   //bytes they take, as far as this process knows
+		bool reading;    //false for --refresh, runs are made again and stored
+
+		// Hash of the running simulator, so results of another build are never used
+		static const std::string &build_id() {
+			static std::string id;
+			static std::once_flag once;
+			std::call_once(once, []() {
+				std::string error;
+				if (!file_hash("/proc/self/exe", id, error)) {
+					id = std::string(__DATE__) + " " + __TIME__;
+				}
+			});
+			return id;
+		}
+
+		static std::string describe(const ProgramImage &image, const SweepJob &job) {
+			SweepJob copy = job;
+			return "schema " + std::to_string(RESULT_SCHEMA) + "\nprogram " + image.key + "\nprocessor " + job.model + "\ncores " + std::to_string(job.cores) + "\nbuild " + build_id() + "\n" +
+					ParameterRegistry(copy.pipeline, copy.cache).ini();
+		}
+
+		std::string path_of(const std::string &description) const {
+			return dir + "/" + fnv_hex(description) + ".result";
+		}
+
+		struct File {
+			std::string path;
+			uint64_t bytes;
+			time_t used;
+
+			bool operator<(const File &other) const {
+				return used < other.used;
+			}
+		};
+
+		// Every entry in the directory, and the bytes they take
+		uint64_t scan(std::vector<File> &files) const {
+			uint64_t total = 0;
+			DIR *d = opendir(dir.c_str());
+			if (!d) {
+				return 0;
+			}
+			while (dirent *entry = readdir(d)) {
+				std::string name = entry->d_name;
+				struct stat st;
+				File file = {dir + "/" + name, 0, 0};
+				if (name.size() > 7 && name.compare(name.size() - 7, 7, ".result") == 0 && stat(file.path.c_str(), &st) == 0) {
+					file.bytes = st.st_size;
+					file.used = st.st_mtime;
+					files.push_back(file);
+					total += file.bytes;
+				}
+			}
+			closedir(d);
+			return total;
+		}
+
+		// Drops the least recently used entries once they are over the bound, with lock held
+		void evict() {
+			if (used <= limit) {
+				return;
+			}
+			std::vector<File> files;
+			used = scan(files);
+			std::sort(files.begin(), files.end());
+			for (size_t i = 0; i < files.size() && used > limit / 4 * 3; i++) {
+				if (unlink(files[i].path.c_str()) == 0) {
+					used -= files[i].bytes;
+				}
+			}
+		}
+
+	public:
+		ResultCache(const std::string &dir, uint64_t limit, bool reading) : dir(dir), limit(limit), used(0), reading(reading) {}
+
+		// Creates the directory if need be
+		bool open(std::string &error) {
+			std::string path;
+			std::stringstream parts(dir);
+			std::string part;
+			while (std::getline(parts, part, '/')) {
+				path += part;
+				if (!path.empty()) {
+					mkdir(path.c_str(), 0777);
+				}
+				path += "/";
+			}
+			struct stat st;
+			if (stat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+				error = "cannot create the result cache " + dir;
+				return false;
+			}
+			std::vector<File> files;
+			used = scan(files);
+			return true;
+		}
+
+		// The stored result of the run, false if there is none
+		bool find(const ProgramImage &image, const SweepJob &job, SweepResult &result) {
+			if (!reading) {
+				return false;
+			}
+			std::string description = describe(image, job);
+			std::string path = path_of(description);
+			std::ifstream in(path.c_str());
+			if (!in) {
+				return false;
+			}
+			std::stringstream text;
+			text << in.rdbuf();
+			std::string stored = text.str();
+			if (stored.compare(0, description.size(), description) != 0) {
+				return false;
+			}
+			std::istringstream counts(stored.substr(description.size()));
+			std::string separator;
+			unsigned long long c[6];
+			if (!(counts >> separator >> c[0] >> c[1] >> c[2] >> c[3] >> c[4] >> c[5]) || separator != "--") {
+				return false;
+			}
+			SweepResult stats = {c[0], c[1], c[2], c[3], c[4], c[5], 0, true};
+			result = stats;
+			utime(path.c_str(), NULL);
+			return true;
+		}
+
+		void store(const ProgramImage &image, const SweepJob &job, const SweepResult &result) {
+			std::string description = describe(image, job);
+			std::string path = path_of(description);
+			char counts[200];
+			snprintf(counts, sizeof(counts), "--\n%llu %llu %llu %llu %llu %llu\n", (unsigned long long)result.cycles, (unsigned long long)result.instructions,
+					(unsigned long long)result.branches, (unsigned long long)result.mispredicts, (unsigned long long)result.loads, (unsigned long long)result.stores);
+			std::string entry = description + counts;
+			char temp[32];
+			snprintf(temp, sizeof(temp), ".%ld.%p", (long)getpid(), (void *)&entry);
+			std::string tempPath = path + temp;
+			FILE *file = fopen(tempPath.c_str(), "w");
+			if (!file) {
+				return; //a cache that cannot be written only costs the time of the next run
+			}
+			bool written = fwrite(entry.data(), 1, entry.size(), file) == entry.size();
+			if (fclose(file) != 0 || !written || rename(tempPath.c_str(), path.c_str()) != 0) {
+				unlink(tempPath.c_str());
+				return;
+			}
+			std::lock_guard<std::mutex> guard(lock);
+			used += entry.size();
+			evict();
+		}
+};
+
+// Directory of the result cache when --cache-dir is not given
+static inline std::string default_cache_dir() {
+	const char *xdg = getenv("XDG_CACHE_HOME");
+	if (xdg && *xdg) {
+		return std::string(xdg) + "/processor";
+	}
+	const char *home = getenv("HOME");
+	return home && *home ? std::string(home) + "/.cache/processor" : ".processor-cache";
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef ROI
+#define ROI
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <chrono>
+#include <memory>
+#include "memory.h"
+#include "reg_file.h"
+#include "functional.h"
+#include "counters.h"
+#include "cpistack.h"
+#include "options.h"
+
+// --roi-fast-forward: only the region of interest the guest marks through the
+// counter page (counters.h) is simulated in detail. Everything outside it runs
+// on the functional model, which trains the timing model's branch predictor
+// on the way like SMARTS does. A begin marker switches to the pipeline at the
+// next instruction, an end marker drains it and hands back to the functional
+// model. Fast-forwarded instructions count one cycle each on the guest's
+// cycle counter, and the cycles of the drain after an ROI are not counted.
+
+template <class Processor>
+void roi_run(Registers &reg_file, Memory &memory, uint32_t end_pc) {
+	GuestCounters guest;
+	std::unique_ptr<CpiStack> cpiStack;
+	Processor processor(reg_file, memory, end_pc, sim_options.pipeline);
+	if (sim_options.cpiStack) {
+		cpiStack.reset(new CpiStack());
+		processor.account(cpiStack.get());
+		guest.watch(cpiStack.get());
+	}
+	memory.counters = &guest;
+	FunctionalCore core(reg_file, memory);
+	uint64_t cycles = 0;
+	uint64_t instructions = 0;
+	uint64_t fastForwarded = 0;
+	bool ended = false;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	while (!ended) {
+		//Functional up to the next ROI
+		while (!guest.in_roi() && reg_file.pc != end_pc) {
+			uint32_t pc = reg_file.pc;
+			guest.tick(cycles, instructions);
+			core.step();
+			if (core.branched) {
+				processor.train_predictor(pc, core.taken);
+			}
+			cycles++;
+			instructions++;
+			fastForwarded++;
+		}
+		if (reg_file.pc == end_pc) {
+			break;
+		}
+
+		//Detailed until it ends
+		while (guest.in_roi() && !ended) {
+			uint32_t committed = 0;
+			guest.tick(cycles, instructions);
+			ended = processor.cycle(committed);
+			cycles++;
+			instructions += committed;
+			uint64_t idle = processor.idle();
+			processor.skip(idle);
+			cycles += idle;
+		}
+		if (!ended) {
+			bool drained = false;
+			instructions += processor.drain(drained);
+			ended = drained;
+		}
+	}
+	guest.finish(cycles, instructions);
+	memory.counters = NULL;
+	std::chrono::duration<double> hostTime = std::chrono::steady_clock::now() - start;
+
+	if (guest.roi_regions() == 0) {
+		std::cout << "ROI: the program marked no region of interest, nothing was simulated in detail\n";
+		exit(1);
+	}
+	std::cout << "ROI: " << guest.roi_regions() << (guest.roi_regions() == 1 ? " region, " : " regions, ") << guest.roi_cycles() << " cycles, "
+			<< guest.roi_instructions() << " instructions in detail, " << fastForwarded << " fast-forwarded\n";
+	std::cout << "Host time: " << hostTime.count() << " s\n";
+	if (cpiStack) {
+		guest.roi_stack().report(std::cout, guest.roi_instructions());
+	}
+	std::cout << "CPI = " << (double)guest.roi_cycles() / guest.roi_instructions() << "\n";
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef SAMPLING
+#define SAMPLING
+#include <cstdint>
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include "memory.h"
+#include "reg_file.h"
+#include "options.h"
+
+// Detailed runs shared by the sampling modes (simpoint.h, smarts.h)
+
+// Architectural state at the start of a detailed run
+struct ArchCheckpoint {
+	Registers reg_file;
+	Memory memory;
+	uint64_t skip;    //instructions before the checkpoint
+	uint64_t warmup;  //instructions simulated in detail before measuring
+	uint64_t measure; //instructions measured
+};
+
+// Cycles and instructions of the measured part of a detailed run
+struct DetailedStats {
+	uint64_t cycles;
+	uint64_t instructions;
+
+	double cpi() const {
+		return instructions == 0 ? 0 : (double)cycles / instructions;
+	}
+};
+
+// Simulates a checkpoint in detail, the warm-up instructions are not measured.
+// A cycle that retires across either end of the measured instructions has its
+// cycle counted and only its instructions inside them, so runs over adjacent
+// instructions add up to exactly the instructions between them.
+template <class Processor>
+DetailedStats detailed_run(ArchCheckpoint &checkpoint, uint32_t end_pc) {
+	Processor processor(checkpoint.reg_file, checkpoint.memory, end_pc, sim_options.pipeline);
+	uint64_t cycles = 0;
+	uint64_t committed = 0;
+	uint64_t startCycle = 0;
+	uint64_t startCommitted = 0;
+	bool measuring = checkpoint.warmup == 0;
+	while (committed < checkpoint.warmup || committed - checkpoint.warmup < checkpoint.measure) {
+		uint32_t insts = 0;
+		bool endIt = processor.cycle(insts);
+		cycles++;
+		committed += insts;
+		if (!measuring && committed >= checkpoint.warmup) {
+			measuring = true;
+			startCycle = cycles;
+			startCommitted = checkpoint.warmup;
+		}
+		if (endIt) {
+			break;
+		}
+		uint64_t idle = processor.idle();
+		processor.skip(idle);
+		cycles += idle;
+	}
+	uint64_t measured = std::min(committed - startCommitted, checkpoint.measure);
+	DetailedStats stats = {cycles - startCycle, measured};
+	return stats;
+}
+
+template <class Processor>
+double detailed_cpi(ArchCheckpoint &checkpoint, uint32_t end_pc) {
+	return detailed_run<Processor>(checkpoint, end_pc).cpi();
+}
+
+// Simulates the whole program in detail and reports how far a sampled CPI estimate is from it
+template <class Processor>
+void report_full_run(const Registers &startRegs, const Memory &startMemory, uint32_t end_pc, double estimate) {
+	ArchCheckpoint full = {startRegs, startMemory, 0, 0, UINT64_MAX};
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	double fullCpi = detailed_cpi<Processor>(full, end_pc);
+	std::chrono::duration<double> fullTime = std::chrono::steady_clock::now() - start;
+	std::cout << "Full run CPI = " << fullCpi << ", error = " << 100 * (estimate - fullCpi) / fullCpi << "%, full run host time " << fullTime.count() << " s\n";
+}
+
+#endif
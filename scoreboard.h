@@ -0,0 +1,111 @@
+#ifndef SCOREBOARD
+#define SCOREBOARD
+#include <cstdint>
+#include "control.h"
+#include "state.h"
+
+// Register scoreboard shared by the pipeline models. It is rebuilt every cycle
+// from the EXMEM and MEMWB registers, oldest instructions first, so every
+// register with an in-flight write maps to the stage and lane of its youngest
+// producer. Hazard checks are then a mask test and forwarding is a lookup of
+// the producer, both linear in the pipeline width. With several hardware
+// threads every thread has its own set of registers and producers.
+
+enum producer_stage {
+	STAGE_EXMEM,
+	STAGE_MEMWB
+};
+
+// Register an instruction writes back, 0 if none ($0 never needs forwarding).
+// jal writes $31 directly in EX and jr never writes back.
+template <class Latch>
+inline uint32_t destination(const Latch &latch) {
+	if (!latch.valid || latch.control.reg_write == false || latch.control.jumpLink == true || latch.jumpReg == true || latch.control.branch == true) {
+		return 0;
+	}
+	return latch.regDestination;
+}
+
+// Same as above for an instruction still in decode
+inline uint32_t destination(const IFID &ifid, const control_t &control) {
+	if (!ifid.valid || control.reg_write == false || control.jumpLink == true) {
+		return 0;
+	}
+	return control.reg_dest ? ifid.Rd : ifid.Rt;
+}
+
+template <unsigned Width, unsigned Threads = 1>
+class Scoreboard {
+	private:
+		uint8_t stage[Threads][32]; //producer_stage of the youngest writer of each register
+		uint8_t lane[Threads][32];  //and the lane it is in
+
+		static unsigned slot(unsigned thread) {
+			return Threads == 1 ? 0 : thread;
+		}
+
+		void record(unsigned thread, uint32_t dest, producer_stage producer, unsigned l, bool load) {
+			if (dest == 0) {
+				return;
+			}
+			unsigned t = slot(thread);
+			uint32_t bit = 1u << dest;
+			pending[t] |= bit;
+			if (load) {
+				loadPending[t] |= bit;
+			}
+			else {
+				loadPending[t] &= ~bit;
+			}
+			stage[t][dest] = producer;
+			lane[t][dest] = l;
+		}
+
+	public:
+		uint32_t pending[Threads];     //registers with a write in flight
+		uint32_t loadPending[Threads]; //registers whose youngest writer is a load that has not read memory yet
+
+		Scoreboard() {
+			for (unsigned t = 0; t < Threads; t++) {
+				pending[t] = 0;
+				loadPending[t] = 0;
+			}
+		}
+
+		void build(const EXMEM (&exmem)[Width], const MEMWB (&memwb)[Width]) {
+			for (unsigned t = 0; t < Threads; t++) {
+				pending[t] = 0;
+				loadPending[t] = 0;
+			}
+			for (unsigned l = 0; l < Width; l++) {
+				record(memwb[l].thread, destination(memwb[l]), STAGE_MEMWB, l, false);
+			}
+			for (unsigned l = 0; l < Width; l++) {
+				record(exmem[l].thread, destination(exmem[l]), STAGE_EXMEM, l, exmem[l].control.mem_read);
+			}
+		}
+
+		uint32_t load_pending(unsigned thread) const {
+			return loadPending[slot(thread)];
+		}
+
+		unsigned producer_lane(unsigned thread, uint32_t reg) const {
+			return lane[slot(thread)][reg];
+		}
+
+		// Current value of the thread's reg, from its youngest producer or the
+		// register file. Must not be called for a register in loadPending.
+		uint32_t value(unsigned thread, uint32_t reg, uint32_t regFileValue, const EXMEM (&exmem)[Width], const MEMWB (&memwb)[Width]) const {
+			unsigned t = slot(thread);
+			if ((pending[t] & (1u << reg)) == 0) {
+				return regFileValue;
+			}
+			if (stage[t][reg] == STAGE_EXMEM) {
+				return exmem[lane[t][reg]].ALUresult;
+			}
+			const MEMWB &producer = memwb[lane[t][reg]];
+			return producer.control.mem_to_reg ? producer.memReadData : producer.ALUresult;
+		}
+};
+
+#endif
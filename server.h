@@ -0,0 +1,363 @@
+#ifndef SERVER
+#define SERVER
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <string>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "options.h"
+#include "config.h"
+#include "json.h"
+#include "loader.h"
+#include "sweep.h"
+#include "threadpool.h"
+
+// Simulation server for --serve. It listens on a Unix domain socket for
+// requests, one JSON object per line:
+//   {"id": "7", "program": "bench/crc.s", "processor": "speculative",
+//    "config": {"predictor": {"bht_entries": 1024}}}
+// where config is optional and takes the keys of a --config JSON file, on top
+// of the configuration the server was started with. Each request becomes a
+// run on a work-stealing thread pool, and its result goes back on the same
+// connection as one JSON line as soon as it is done, so results of one
+// connection may come back in any order; id, echoed as a string, tells them
+// apart:
+//   {"id": "7", "ok": true, "image": "hit", "cycles": 105392, ...}
+//   {"id": "8", "ok": false, "error": "unknown parameter predictor.bht"}
+// A connection is closed once the client has shut down its side and every
+// result has been sent.
+//
+// Loaded programs stay in an LRU cache keyed by a hash of the file's bytes, so
+// runs of a program already seen skip reading, parsing and assembling it and
+// only copy its memory image, and a rebuilt file is loaded afresh. Runs made
+// before, by this server or any other process, come from the result cache
+// (resultcache.h) and answer with "cached": true.
+
+// Loaded program images by the hash of their files, least recently used dropped first
+class ImageCache {
+	private:
+		typedef std::pair<std::string, std::shared_ptr<const ProgramImage> > Entry;
+
+		std::mutex lock;
+		size_t capacity;
+		std::list<Entry> entries; //most recently used first
+		std::unordered_map<std::string, std::list<Entry>::iterator> byKey;
+
+	public:
+		ImageCache(size_t capacity) : capacity(std::max<size_t>(1, capacity)) {}
+
+		// The image of the program at path, NULL with an error if it does not load
+		std::shared_ptr<const ProgramImage> get(const std::string &path, bool &hit, std::string &error) {
+			std::string k;
+			if (!program_key(path, k, error)) {
+				return NULL;
+			}
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				std::unordered_map<std::string, std::list<Entry>::iterator>::iterator found = byKey.find(k);
+				hit = found != byKey.end();
+				if (hit) {
+					entries.splice(entries.begin(), entries, found->second);
+					return found->second->second;
+				}
+			}
+			//Loaded outside the lock, two requests missing on the same file both load it
+			std::shared_ptr<ProgramImage> image(new ProgramImage());
+			image->path = path;
+			image->key = k;
+			image->end_pc = load_program(path, image->memory, error);
+			if (image->end_pc == 0) {
+				return NULL;
+			}
+			std::lock_guard<std::mutex> guard(lock);
+			if (byKey.find(k) == byKey.end()) {
+				entries.push_front(Entry(k, image));
+				byKey[k] = entries.begin();
+				if (entries.size() > capacity) {
+					byKey.erase(entries.back().first);
+					entries.pop_back();
+				}
+			}
+			return image;
+		}
+};
+
+class SimulationServer {
+	private:
+		// A client's connection, shared by its reader and the runs it asked for
+		struct Connection {
+			int fd;
+			std::mutex lock;
+			std::condition_variable done; //a run finished
+			unsigned pending;             //runs not answered yet
+
+			Connection(int fd) : fd(fd), pending(0) {}
+
+			void send(const std::string &line) {
+				std::lock_guard<std::mutex> guard(lock);
+				for (size_t sent = 0; sent < line.size();) {
+					ssize_t n = ::send(fd, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+					if (n <= 0) {
+						return; //the client went away, its results are dropped
+					}
+					sent += n;
+				}
+			}
+		};
+
+		std::string path;
+		int listener;
+		PipelineConfig pipeline; //configuration requests start from
+		CacheConfig cache;
+		ImageCache images;
+		WorkStealingPool pool;
+		std::function<SweepResult(const ProgramImage &, const SweepJob &)> simulate;
+
+		static std::string failure(const std::string &id, const std::string &error) {
+			return "{\"id\": " + json_quote(id) + ", \"ok\": false, \"error\": " + json_quote(error) + "}\n";
+		}
+
+		// Reads a request line into the program and the job, false with an error
+		bool parse(const std::string &line, std::string &id, std::string &program, SweepJob &job, std::string &error) {
+			job.pipeline = pipeline;
+			job.cache = cache;
+			ParameterRegistry registry(job.pipeline, job.cache);
+			JsonReader json(line);
+			if (!json.next('{')) {
+				error = "a request is a JSON object";
+				return false;
+			}
+			while (!json.peek('}')) {
+				std::string name;
+				if (!json.string(name) || !json.next(':')) {
+					error = "expected \"key\":";
+					return false;
+				}
+				std::string value;
+				if (name == "config") {
+					if (!registry.set_json(json, error)) {
+						return false;
+					}
+				}
+				else if (name != "id" && name != "program" && name != "processor") {
+					error = "unknown request key " + name;
+					return false;
+				}
+				else if (!json.scalar(value)) {
+					error = "expected the value of " + name;
+					return false;
+				}
+				if (name == "id") {
+					id = value;
+				}
+				else if (name == "program") {
+					program = value;
+				}
+				else if (name == "processor") {
+					job.model = value;
+				}
+				if (!json.next(',')) {
+					break;
+				}
+			}
+			if (!json.next('}') || !json.done()) {
+				error = "expected one JSON object on the line";
+				return false;
+			}
+			if (program.empty() || job.model.empty()) {
+				error = "a request needs a program and a processor";
+				return false;
+			}
+			if (!SweepPlan::sweepable(job.model)) {
+				error = "processor " + job.model + " cannot be run by the server";
+				return false;
+			}
+			return registry.validate(error) && registry.check_used(job.model, 1, 1, error);
+		}
+
+		void run(std::shared_ptr<Connection> connection, const std::string &id, const std::string &program, const SweepJob &job) {
+			bool hit = false;
+			std::string error;
+			std::shared_ptr<const ProgramImage> image = images.get(program, hit, error);
+			if (!image) {
+				connection->send(failure(id, error));
+				return;
+			}
+			SweepResult r = simulate(*image, job);
+			char counts[512];
+			snprintf(counts, sizeof(counts), "\"cycles\": %llu, \"instructions\": %llu, \"cpi\": %.6f, \"branches\": %llu, \"mispredicts\": %llu, "
+					"\"loads\": %llu, \"stores\": %llu, \"wall_time\": %.6f, \"cached\": %s", (unsigned long long)r.cycles, (unsigned long long)r.instructions,
+					r.instructions ? (double)r.cycles / r.instructions : 0.0, (unsigned long long)r.branches, (unsigned long long)r.mispredicts,
+					(unsigned long long)r.loads, (unsigned long long)r.stores, r.wallTime, r.cached ? "true" : "false");
+			connection->send("{\"id\": " + json_quote(id) + ", \"ok\": true, \"image\": \"" + (hit ? "hit" : "miss") + "\", " + counts + "}\n");
+		}
+
+		// Reads the requests of a connection until the client shuts down its side, then waits for their results
+		void serve(int fd) {
+			std::shared_ptr<Connection> connection(new Connection(fd));
+			std::string buffer;
+			char data[4096];
+			ssize_t n;
+			while ((n = read(fd, data, sizeof(data))) > 0) {
+				buffer.append(data, n);
+				size_t end;
+				while ((end = buffer.find('\n')) != std::string::npos) {
+					std::string line = buffer.substr(0, end);
+					buffer.erase(0, end + 1);
+					if (line.find_first_not_of(" \t\r") == std::string::npos) {
+						continue;
+					}
+					std::string id;
+					std::string program;
+					SweepJob job;
+					std::string error;
+					if (!parse(line, id, program, job, error)) {
+						connection->send(failure(id, error));
+						continue;
+					}
+					{
+						std::lock_guard<std::mutex> guard(connection->lock);
+						connection->pending++;
+					}
+					pool.submit([this, connection, id, program, job]() {
+						run(connection, id, program, job);
+						std::lock_guard<std::mutex> guard(connection->lock);
+						connection->pending--;
+						connection->done.notify_all();
+					});
+				}
+			}
+			std::unique_lock<std::mutex> guard(connection->lock);
+			connection->done.wait(guard, [&connection]() {
+				return connection->pending == 0;
+			});
+			close(fd);
+		}
+
+		static char *socket_path() {
+			static char path[sizeof(((sockaddr_un *)0)->sun_path)];
+			return path;
+		}
+
+		static void stop(int signal) {
+			unlink(socket_path());
+			_exit(0);
+		}
+
+	public:
+		SimulationServer(const std::string &path, unsigned threads, size_t cachedImages, const PipelineConfig &pipeline, const CacheConfig &cache,
+				std::function<SweepResult(const ProgramImage &, const SweepJob &)> simulate) :
+				path(path), listener(-1), pipeline(pipeline), cache(cache), images(cachedImages), pool(threads), simulate(simulate) {}
+
+		// Binds the socket, replacing a stale one at path
+		bool listen(std::string &error) {
+			sockaddr_un address;
+			memset(&address, 0, sizeof(address));
+			address.sun_family = AF_UNIX;
+			if (path.size() >= sizeof(address.sun_path)) {
+				error = "socket path too long: " + path;
+				return false;
+			}
+			strcpy(address.sun_path, path.c_str());
+			struct stat st;
+			if (stat(path.c_str(), &st) == 0) {
+				if (!S_ISSOCK(st.st_mode)) {
+					error = path + " exists and is not a socket";
+					return false;
+				}
+				unlink(path.c_str());
+			}
+			listener = socket(AF_UNIX, SOCK_STREAM, 0);
+			if (listener < 0 || bind(listener, (sockaddr *)&address, sizeof(address)) != 0 || ::listen(listener, 64) != 0) {
+				error = std::string("cannot listen on ") + path + ": " + strerror(errno);
+				return false;
+			}
+			strcpy(socket_path(), path.c_str());
+			signal(SIGINT, stop);
+			signal(SIGTERM, stop);
+			return true;
+		}
+
+		// Serves every client on its own thread, until the process is stopped
+		void run() {
+			while (true) {
+				int fd = accept(listener, NULL, NULL);
+				if (fd < 0) {
+					continue;
+				}
+				std::thread(&SimulationServer::serve, this, fd).detach();
+			}
+		}
+};
+
+// --client: sends the request lines of stdin to a server and writes its answers to stdout
+static inline int run_client(const std::string &path) {
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (path.size() >= sizeof(address.sun_path) || fd < 0) {
+		std::cout << "Cannot connect to " << path << "\n";
+		return 1;
+	}
+	strcpy(address.sun_path, path.c_str());
+	if (connect(fd, (sockaddr *)&address, sizeof(address)) != 0) {
+		std::cout << "Cannot connect to " << path << ": " << strerror(errno) << "\n";
+		return 1;
+	}
+	//Requests and answers interleave, so a long batch cannot fill both directions of the socket
+	bool sending = true;
+	char data[4096];
+	while (true) {
+		pollfd fds[2] = {{fd, POLLIN, 0}, {STDIN_FILENO, POLLIN, 0}};
+		if (poll(fds, sending ? 2 : 1, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return 1;
+		}
+		if (fds[0].revents) {
+			ssize_t n = read(fd, data, sizeof(data));
+			if (n <= 0) {
+				break; //every answer is in
+			}
+			fwrite(data, 1, n, stdout);
+			fflush(stdout);
+		}
+		if (sending && fds[1].revents) {
+			ssize_t n = read(STDIN_FILENO, data, sizeof(data));
+			if (n <= 0) {
+				shutdown(fd, SHUT_WR);
+				sending = false;
+				continue;
+			}
+			for (ssize_t sent = 0; sent < n;) {
+				ssize_t m = send(fd, data + sent, n - sent, MSG_NOSIGNAL);
+				if (m <= 0) {
+					return 1;
+				}
+				sent += m;
+			}
+		}
+	}
+	close(fd);
+	return 0;
+}
+
+#endif
@@ -0,0 +1,319 @@
+#ifndef SIMPOINT
+#define SIMPOINT
+#include <cstdint>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <unordered_map>
+#include "memory.h"
+#include "reg_file.h"
+#include "functional.h"
+#include "sampling.h"
+#include "options.h"
+
+// SimPoint sampling. A functional profiling pass records a basic block vector
+// (BBV) for every interval of sim_options.simpointInterval instructions. The
+// BBVs are normalised, reduced by random projection and clustered with k-means,
+// picking the number of clusters by BIC. Only the interval closest to each
+// cluster centre is simulated in detail, starting from an architectural
+// checkpoint captured by a second functional pass, and its CPI is weighted by
+// the share of instructions its cluster covers.
+
+static const unsigned SIMPOINT_DIMENSIONS = 15;  //dimensions after random projection
+static const unsigned SIMPOINT_ITERATIONS = 100; //k-means iteration limit
+static const double SIMPOINT_BIC_THRESHOLD = 0.9; //smallest k scoring this fraction of the best BIC
+
+// Projected BBVs of a program, one row of SIMPOINT_DIMENSIONS per interval
+struct BBVProfile {
+	std::vector<double> points;
+	std::vector<uint64_t> instructions; //instructions in each interval (the last may be short)
+	uint64_t total;
+
+	double *point(size_t interval) {
+		return &points[interval * SIMPOINT_DIMENSIONS];
+	}
+	size_t intervals() const {
+		return instructions.size();
+	}
+};
+
+// Functional pass over the whole program collecting one projected BBV per interval
+inline void profile_bbvs(Registers &reg_file, Memory &memory, uint32_t end_pc, uint64_t interval, BBVProfile &profile) {
+	FunctionalCore core(reg_file, memory);
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+	std::unordered_map<uint32_t, uint32_t> blockIds; //block start PC -> BBV dimension
+	std::vector<double> projection; //SIMPOINT_DIMENSIONS random weights per dimension, made as blocks are discovered
+	std::vector<uint64_t> counts;   //instructions executed per block in the current interval
+	std::vector<uint32_t> touched;  //blocks with a non-zero count
+
+	uint32_t blockStart = reg_file.pc;
+	uint64_t blockLength = 0;
+	uint64_t inInterval = 0;
+	profile.total = 0;
+
+	//Charge the block executed so far to the current interval
+	auto end_block = [&]() {
+		if (blockLength == 0) {
+			return;
+		}
+		std::unordered_map<uint32_t, uint32_t>::iterator it = blockIds.find(blockStart);
+		uint32_t id;
+		if (it == blockIds.end()) {
+			id = blockIds.size();
+			blockIds[blockStart] = id;
+			counts.push_back(0);
+			for (unsigned d = 0; d < SIMPOINT_DIMENSIONS; d++) {
+				projection.push_back(uniform(rng));
+			}
+		}
+		else {
+			id = it->second;
+		}
+		if (counts[id] == 0) {
+			touched.push_back(id);
+		}
+		counts[id] += blockLength;
+		blockLength = 0;
+	};
+	auto end_interval = [&]() {
+		if (inInterval == 0) {
+			return;
+		}
+		double point[SIMPOINT_DIMENSIONS] = {0};
+		for (size_t i = 0; i < touched.size(); i++) {
+			double share = (double)counts[touched[i]] / inInterval;
+			for (unsigned d = 0; d < SIMPOINT_DIMENSIONS; d++) {
+				point[d] += share * projection[touched[i] * SIMPOINT_DIMENSIONS + d];
+			}
+			counts[touched[i]] = 0;
+		}
+		touched.clear();
+		profile.points.insert(profile.points.end(), point, point + SIMPOINT_DIMENSIONS);
+		profile.instructions.push_back(inInterval);
+		inInterval = 0;
+	};
+
+	while (reg_file.pc != end_pc) {
+		uint32_t pc = reg_file.pc;
+		bool endsBlock = core.step();
+		blockLength++;
+		inInterval++;
+		profile.total++;
+		if (endsBlock) {
+			end_block();
+			blockStart = reg_file.pc;
+		}
+		if (inInterval == interval) {
+			end_block(); //a block split by the interval boundary is charged to both
+			blockStart = endsBlock ? reg_file.pc : pc + 4;
+			end_interval();
+		}
+	}
+	end_block();
+	end_interval();
+}
+
+inline double squared_distance(const double *a, const double *b) {
+	double sum = 0;
+	for (unsigned d = 0; d < SIMPOINT_DIMENSIONS; d++) {
+		sum += (a[d] - b[d]) * (a[d] - b[d]);
+	}
+	return sum;
+}
+
+// Lloyd's k-means seeded farthest-first from interval 0, fills assignment and
+// centres and returns the total squared distance to the centres
+inline double kmeans(BBVProfile &profile, unsigned k, std::vector<unsigned> &assignment, std::vector<double> &centres) {
+	size_t n = profile.intervals();
+	centres.assign(profile.point(0), profile.point(0) + SIMPOINT_DIMENSIONS);
+	std::vector<double> nearest(n);
+	for (size_t i = 0; i < n; i++) {
+		nearest[i] = squared_distance(profile.point(i), &centres[0]);
+	}
+	for (unsigned c = 1; c < k; c++) {
+		size_t farthest = std::max_element(nearest.begin(), nearest.end()) - nearest.begin();
+		centres.insert(centres.end(), profile.point(farthest), profile.point(farthest) + SIMPOINT_DIMENSIONS);
+		for (size_t i = 0; i < n; i++) {
+			nearest[i] = std::min(nearest[i], squared_distance(profile.point(i), &centres[c * SIMPOINT_DIMENSIONS]));
+		}
+	}
+
+	assignment.assign(n, k);
+	double distortion = 0;
+	for (unsigned iteration = 0; iteration < SIMPOINT_ITERATIONS; iteration++) {
+		bool changed = false;
+		distortion = 0;
+		for (size_t i = 0; i < n; i++) {
+			unsigned best = 0;
+			double bestDistance = squared_distance(profile.point(i), &centres[0]);
+			for (unsigned c = 1; c < k; c++) {
+				double distance = squared_distance(profile.point(i), &centres[c * SIMPOINT_DIMENSIONS]);
+				if (distance < bestDistance) {
+					best = c;
+					bestDistance = distance;
+				}
+			}
+			changed |= assignment[i] != best;
+			assignment[i] = best;
+			distortion += bestDistance;
+		}
+		if (!changed) {
+			break;
+		}
+		std::vector<double> sums(k * SIMPOINT_DIMENSIONS, 0);
+		std::vector<unsigned> sizes(k, 0);
+		for (size_t i = 0; i < n; i++) {
+			sizes[assignment[i]]++;
+			for (unsigned d = 0; d < SIMPOINT_DIMENSIONS; d++) {
+				sums[assignment[i] * SIMPOINT_DIMENSIONS + d] += profile.point(i)[d];
+			}
+		}
+		for (unsigned c = 0; c < k; c++) {
+			for (unsigned d = 0; sizes[c] != 0 && d < SIMPOINT_DIMENSIONS; d++) { //an emptied cluster keeps its centre
+				centres[c * SIMPOINT_DIMENSIONS + d] = sums[c * SIMPOINT_DIMENSIONS + d] / sizes[c];
+			}
+		}
+	}
+	return distortion;
+}
+
+// Bayesian information criterion of a clustering under a spherical Gaussian model (X-means)
+inline double bic(size_t n, unsigned k, const std::vector<unsigned> &assignment, double distortion) {
+	const double d = SIMPOINT_DIMENSIONS;
+	double variance = n > k ? distortion / (d * (n - k)) : 0;
+	variance = std::max(variance, 1e-12);
+	std::vector<size_t> sizes(k, 0);
+	for (size_t i = 0; i < n; i++) {
+		sizes[assignment[i]]++;
+	}
+	double likelihood = 0;
+	for (unsigned c = 0; c < k; c++) {
+		double size = sizes[c];
+		if (size == 0) {
+			continue;
+		}
+		likelihood += size * std::log(size) - size * std::log((double)n) - size * d / 2 * std::log(2 * std::acos(-1.0) * variance) - (size - 1) * d / 2;
+	}
+	return likelihood - k * (d + 1) / 2 * std::log((double)n);
+}
+
+struct SimPoint {
+	size_t interval; //representative interval of the cluster
+	double weight;   //share of all instructions in the cluster
+	double cpi;
+};
+
+// Clusters the profile and returns one simulation point per non-empty cluster
+inline std::vector<SimPoint> pick_simpoints(BBVProfile &profile, unsigned maxK) {
+	size_t n = profile.intervals();
+	maxK = std::max(1u, (unsigned)std::min<size_t>(maxK, n));
+	std::vector<std::vector<unsigned> > assignments(maxK + 1);
+	std::vector<std::vector<double> > centres(maxK + 1);
+	std::vector<double> scores(maxK + 1);
+	for (unsigned k = 1; k <= maxK; k++) {
+		double distortion = kmeans(profile, k, assignments[k], centres[k]);
+		scores[k] = bic(n, k, assignments[k], distortion);
+	}
+	double best = *std::max_element(scores.begin() + 1, scores.end());
+	double worst = *std::min_element(scores.begin() + 1, scores.end());
+	unsigned k = 1;
+	while (k < maxK && scores[k] < worst + SIMPOINT_BIC_THRESHOLD * (best - worst)) {
+		k++;
+	}
+
+	std::vector<SimPoint> points;
+	for (unsigned c = 0; c < k; c++) {
+		SimPoint point = {n, 0, 0};
+		double closest = 0;
+		uint64_t instructions = 0;
+		for (size_t i = 0; i < n; i++) {
+			if (assignments[k][i] != c) {
+				continue;
+			}
+			instructions += profile.instructions[i];
+			double distance = squared_distance(profile.point(i), &centres[k][c * SIMPOINT_DIMENSIONS]);
+			if (point.interval == n || distance < closest) {
+				point.interval = i;
+				closest = distance;
+			}
+		}
+		if (instructions != 0) {
+			point.weight = (double)instructions / profile.total;
+			points.push_back(point);
+		}
+	}
+	return points;
+}
+
+// Runs the whole SimPoint flow for one timing model and reports the weighted CPI
+template <class Processor>
+void simpoint_run(Registers &reg_file, Memory &memory, uint32_t end_pc) {
+	uint64_t interval = sim_options.simpointInterval;
+	uint64_t warmup = sim_options.warmup != UINT64_MAX ? sim_options.warmup : interval / 10;
+	Registers startRegs = reg_file;
+	Memory startMemory = memory;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	//Profile, cluster and pick the representative intervals
+	BBVProfile profile;
+	profile_bbvs(reg_file, memory, end_pc, interval, profile);
+	if (profile.intervals() == 0) {
+		std::cout << "SimPoint: program is empty\n";
+		return;
+	}
+	std::vector<SimPoint> points = pick_simpoints(profile, sim_options.simpointMaxK);
+	std::chrono::duration<double> profileTime = std::chrono::steady_clock::now() - start;
+
+	//Second functional pass capturing a checkpoint ahead of every representative
+	std::vector<ArchCheckpoint> checkpoints;
+	std::vector<size_t> order(points.size());
+	for (size_t p = 0; p < points.size(); p++) {
+		order[p] = p;
+	}
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return points[a].interval < points[b].interval; });
+	reg_file = startRegs;
+	memory = startMemory;
+	FunctionalCore core(reg_file, memory);
+	uint64_t executed = 0;
+	checkpoints.resize(points.size());
+	for (size_t o = 0; o < order.size(); o++) {
+		uint64_t begin = points[order[o]].interval * interval;
+		uint64_t skip = begin - std::min(begin, warmup);
+		while (executed < skip) {
+			core.step();
+			executed++;
+		}
+		ArchCheckpoint &checkpoint = checkpoints[order[o]];
+		checkpoint.reg_file = reg_file;
+		checkpoint.memory = memory;
+		checkpoint.skip = skip;
+		checkpoint.warmup = begin - skip;
+		checkpoint.measure = profile.instructions[points[order[o]].interval];
+	}
+
+	//Detailed simulation of the representatives only
+	start = std::chrono::steady_clock::now();
+	double cpi = 0;
+	uint64_t detailed = 0;
+	std::cout << "SimPoint: " << profile.intervals() << " intervals of " << interval << " instructions, " << points.size() << " clusters\n";
+	for (size_t p = 0; p < points.size(); p++) {
+		points[p].cpi = detailed_cpi<Processor>(checkpoints[p], end_pc);
+		cpi += points[p].weight * points[p].cpi;
+		detailed += checkpoints[p].warmup + checkpoints[p].measure;
+		std::cout << "  interval " << points[p].interval << ": weight " << points[p].weight << ", CPI " << points[p].cpi << "\n";
+	}
+	std::chrono::duration<double> detailedTime = std::chrono::steady_clock::now() - start;
+	std::cout << "Detailed instructions: " << detailed << " of " << profile.total << " (" << (double)profile.total / std::max<uint64_t>(detailed, 1) << "x fewer)\n";
+	std::cout << "Host time: profiling " << profileTime.count() << " s, detailed " << detailedTime.count() << " s\n";
+
+	if (sim_options.verify) {
+		report_full_run<Processor>(startRegs, startMemory, end_pc, cpi);
+	}
+	std::cout << "CPI = " << cpi << "\n";
+}
+
+#endif
@@ -0,0 +1,234 @@
+#include <cstdint>
+#include <algorithm>
+#include <sstream>
+#include "simulator.h"
+#include "pipeline.h"
+#include "singlecycle.h"
+#include "loader.h"
+#include "sweep.h"
+
+using namespace std;
+
+// A processor model as the Simulator drives it, one cycle at a time
+class Simulator::Core {
+	public:
+		bool speculative; //stops before counting the final cycle and dumps the next PC, as pipeline_run does for them
+
+		Core(bool speculative) : speculative(speculative) {}
+		virtual ~Core() {}
+		virtual bool cycle(uint32_t &committed) = 0;
+		virtual uint64_t idle() const = 0;
+		virtual void skip(uint64_t cycles) = 0;
+		virtual uint64_t branches() const = 0;
+		virtual uint64_t mispredicts() const = 0;
+		virtual uint64_t loads() const = 0;
+		virtual uint64_t stores() const = 0;
+};
+
+template <class Processor>
+class Simulator::ProcessorCore : public Simulator::Core {
+	private:
+		Processor processor;
+
+	public:
+		ProcessorCore(bool speculative, Registers &reg_file, Memory &memory, uint32_t end_pc, const PipelineConfig &config) :
+				Core(speculative), processor(reg_file, memory, end_pc, config) {}
+
+		bool cycle(uint32_t &committed) {
+			return processor.cycle(committed);
+		}
+		uint64_t idle() const {
+			return processor.idle();
+		}
+		void skip(uint64_t cycles) {
+			processor.skip(cycles);
+		}
+		uint64_t branches() const {
+			return processor.branches();
+		}
+		uint64_t mispredicts() const {
+			return processor.mispredicts();
+		}
+		uint64_t loads() const {
+			return processor.loads();
+		}
+		uint64_t stores() const {
+			return processor.stores();
+		}
+};
+
+Simulator::Simulator(const string &model, const PipelineConfig &config) :
+		model(model), config(config), end_pc(0), num_cycles(0), num_instrs(0), finished(true), sink(NULL), tracing(false) {
+	reg_file.pc = 0;
+	memory.counters = &guest;
+}
+
+Simulator::~Simulator() {}
+
+bool Simulator::supports(const string &model) {
+	return SweepPlan::sweepable(model);
+}
+
+bool Simulator::load(const string &path, string &error) {
+	if (!supports(model)) {
+		error = "processor " + model + " cannot be simulated";
+		return false;
+	}
+	memory = Memory();
+	return start(load_program(path, memory, error), error);
+}
+
+bool Simulator::load(const void *elf, size_t size, string &error) {
+	if (!supports(model)) {
+		error = "processor " + model + " cannot be simulated";
+		return false;
+	}
+	memory = Memory();
+	return start(load_elf((const char *)elf, size, memory, error), error);
+}
+
+// Resets the run to the start of the program now in memory, which ends at program_end (0 if it failed to load)
+bool Simulator::start(uint32_t program_end, string &error) {
+	core.reset();
+	reg_file = Registers();
+	reg_file.pc = 0;
+	guest = GuestCounters();
+	memory.counters = &guest;
+	end_pc = program_end;
+	num_cycles = 0;
+	num_instrs = 0;
+	finished = true;
+	if (end_pc == 0) {
+		return false;
+	}
+	if (model == "pipelined") {
+		core.reset(new ProcessorCore<PipelinedProcessor>(false, reg_file, memory, end_pc, config));
+	} else if (model == "speculative") {
+		core.reset(new ProcessorCore<SpeculativeProcessor>(true, reg_file, memory, end_pc, config));
+	} else if (model == "io-superscalar") {
+		core.reset(new ProcessorCore<IOSuperscalarProcessor>(true, reg_file, memory, end_pc, config));
+	} else {
+		core.reset(new ProcessorCore<SingleCycleProcessor>(false, reg_file, memory, end_pc, config));
+	}
+	finished = false;
+	return true;
+}
+
+// The registers after the cycle num_cycles, as the main loops print them
+void Simulator::dump() {
+	if (!tracing || !sink) {
+		return;
+	}
+	ostringstream out;
+	out << "CYCLE" << num_cycles << "\n";
+	if (core->speculative) {
+		out << "PC of next is: " << reg_file.pc << "\n";
+	}
+	reg_file.print(out);
+	sink->write(out.str());
+}
+
+// Simulates up to limit cycles, stopping early after a cycle that leaves the
+// fetch PC at stopPC (with atPC, setting reached) or stopInstrs instructions retired
+uint64_t Simulator::advance(uint64_t limit, bool atPC, uint32_t stopPC, uint64_t stopInstrs, bool &reached) {
+	uint64_t simulated = 0;
+	reached = false;
+	while (simulated < limit && !finished) {
+		uint32_t committed = 0;
+		guest.tick(num_cycles, num_instrs);
+		bool endIt = core->cycle(committed);
+		num_instrs += committed;
+		if (endIt) {
+			finished = true;
+			if (core->speculative) {
+				break; //the final cycle is not counted
+			}
+		}
+		dump();
+		num_cycles++;
+		simulated++;
+		reached = atPC && reg_file.pc == stopPC;
+		if (finished || reached || num_instrs >= stopInstrs) {
+			break;
+		}
+
+		//Cycles spent waiting on an event change nothing, count them without simulating
+		uint64_t idle = min(core->idle(), limit - simulated);
+		core->skip(idle);
+		for (; idle > 0; idle--) {
+			dump();
+			num_cycles++;
+			simulated++;
+		}
+	}
+	return simulated;
+}
+
+uint64_t Simulator::step(uint64_t cycles) {
+	bool reached;
+	return advance(cycles, false, 0, UINT64_MAX, reached);
+}
+
+bool Simulator::run_until_pc(uint32_t pc, uint64_t limit) {
+	bool reached;
+	advance(limit, true, pc, UINT64_MAX, reached);
+	return reached;
+}
+
+bool Simulator::run_until_instret(uint64_t instructions) {
+	if (num_instrs >= instructions) {
+		return true;
+	}
+	bool reached;
+	advance(UINT64_MAX, false, 0, instructions, reached);
+	return num_instrs >= instructions;
+}
+
+void Simulator::run() {
+	bool reached;
+	advance(UINT64_MAX, false, 0, UINT64_MAX, reached);
+}
+
+uint32_t Simulator::reg(unsigned number) {
+	uint32_t value = 0;
+	uint32_t dummy;
+	if (number < 32) {
+		reg_file.access(number, 0, value, dummy, 0, 0, 0);
+	}
+	return value;
+}
+
+void Simulator::set_reg(unsigned number, uint32_t value) {
+	uint32_t dummy;
+	if (number != 0 && number < 32) {
+		reg_file.access(0, 0, dummy, dummy, number, true, value);
+	}
+}
+
+bool Simulator::read_word(uint32_t address, uint32_t &value) {
+	if (address % 4 != 0 || address >= memory_bytes()) {
+		return false;
+	}
+	memory.access(address, value, 0, true, false);
+	return true;
+}
+
+bool Simulator::write_word(uint32_t address, uint32_t value) {
+	uint32_t dummy;
+	if (address % 4 != 0 || address >= memory_bytes()) {
+		return false;
+	}
+	memory.access(address, dummy, value, false, true);
+	return true;
+}
+
+SimulatorStats Simulator::stats() const {
+	SimulatorStats stats = {num_cycles, num_instrs, 0, 0, 0, 0};
+	if (core) {
+		stats.branches = core->branches();
+		stats.mispredicts = core->mispredicts();
+		stats.loads = core->loads();
+		stats.stores = core->stores();
+	}
+	return stats;
+}
@@ -0,0 +1,145 @@
+#ifndef SIMULATOR
+#define SIMULATOR
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <memory>
+#include <ostream>
+#include "memory.h"
+#include "reg_file.h"
+#include "counters.h"
+#include "options.h"
+
+// Embedding API of libprocessor.a. A Simulator runs one program on one of the
+// sweepable processor models inside the calling process, as far as it is told
+// to, and can be inspected in between:
+//   Simulator sim("speculative");
+//   std::string error;
+//   if (!sim.load("bench/crc.s", error)) ...
+//   sim.run_until_instret(1000);
+//   uint32_t t0 = sim.reg(8);
+//   sim.run();
+//   SimulatorStats stats = sim.stats();
+// Counts match --sweep runs of the same program and configuration. Simulators
+// share no state, so a harness can run any number of them on its own threads.
+// Nothing is written to cout: with tracing on, the per-cycle dumps of the
+// command line go to the output sink instead.
+
+// Where a Simulator's output goes
+class OutputSink {
+	public:
+		virtual ~OutputSink() {}
+		virtual void write(const std::string &text) = 0;
+};
+
+// Writes the output to a stream, e.g. std::cout or a std::ostringstream
+class StreamSink : public OutputSink {
+	private:
+		std::ostream &out;
+
+	public:
+		StreamSink(std::ostream &out) : out(out) {}
+
+		void write(const std::string &text) {
+			out << text;
+		}
+};
+
+// Counts of a run so far
+struct SimulatorStats {
+	uint64_t cycles;
+	uint64_t instructions;
+	uint64_t branches;
+	uint64_t mispredicts;
+	uint64_t loads;
+	uint64_t stores;
+
+	double cpi() const {
+		return instructions ? (double)cycles / instructions : 0.0;
+	}
+};
+
+class Simulator {
+	private:
+		class Core;      //the processor model, simulator.cpp
+		template <class Processor> class ProcessorCore;
+
+		std::string model;
+		PipelineConfig config;
+		Registers reg_file;
+		Memory memory;
+		GuestCounters guest;
+		std::unique_ptr<Core> core;
+		uint32_t end_pc;
+		uint64_t num_cycles;
+		uint64_t num_instrs;
+		bool finished;
+		OutputSink *sink;
+		bool tracing;
+
+		bool start(uint32_t program_end, std::string &error);
+		uint64_t advance(uint64_t limit, bool atPC, uint32_t stopPC, uint64_t stopInstrs, bool &reached);
+		void dump();
+
+		Simulator(const Simulator &);            //the model holds references to the registers and memory
+		Simulator &operator=(const Simulator &);
+
+	public:
+		// model is a sweepable --processor, config its parameters (config.h can fill them in by name)
+		Simulator(const std::string &model = "pipelined", const PipelineConfig &config = PipelineConfig());
+		~Simulator();
+
+		static bool supports(const std::string &model);
+
+		// Loads an ELF binary, or assembles path if it ends in .s, and resets the run.
+		// False with an error if it does not load or the model is not supported.
+		bool load(const std::string &path, std::string &error);
+		// Same for an ELF binary held in memory
+		bool load(const void *elf, size_t size, std::string &error);
+
+		// Simulates up to cycles more cycles, fewer if the program ends. Returns the cycles simulated.
+		uint64_t step(uint64_t cycles);
+		// Runs until a cycle leaves the fetch PC at pc (the next instruction's, single-cycle),
+		// the program ends or limit more cycles are simulated. True if it stopped at pc.
+		bool run_until_pc(uint32_t pc, uint64_t limit = UINT64_MAX);
+		// Runs until at least instructions have retired since the start, or the program ends. True if they have.
+		bool run_until_instret(uint64_t instructions);
+		// Runs the program to its end
+		void run();
+		// The program's last instruction has retired
+		bool done() const {
+			return finished;
+		}
+
+		// Architectural state: registers as the model last wrote them back, memory as a word array
+		uint32_t pc() const {
+			return reg_file.pc;
+		}
+		uint32_t reg(unsigned number);
+		void set_reg(unsigned number, uint32_t value);
+		uint32_t hi() const {
+			return reg_file.hi;
+		}
+		uint32_t lo() const {
+			return reg_file.lo;
+		}
+		// Words at word aligned addresses below memory_bytes(), false for others
+		bool read_word(uint32_t address, uint32_t &value);
+		bool write_word(uint32_t address, uint32_t value);
+		uint32_t memory_bytes() const {
+			return memory.words() * 4;
+		}
+
+		SimulatorStats stats() const;
+
+		// Output from now on goes to sink, NULL drops it. It is not owned.
+		void output(OutputSink *sink) {
+			this->sink = sink;
+		}
+		// Dumps every cycle's registers to the sink as the command line does without --quiet
+		void trace(bool on) {
+			tracing = on;
+		}
+};
+
+#endif
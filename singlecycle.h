@@ -0,0 +1,240 @@
+#ifndef SINGLE_CYCLE
+#define SINGLE_CYCLE
+#include <cstdint>
+#include <iostream>
+#include "memory.h"
+#include "reg_file.h"
+#include "ALU.h"
+#include "control.h"
+#include "checker.h"
+#include "options.h"
+
+// The single-cycle MIPS datapath. Every cycle fetches, executes and writes
+// back one instruction, so it never waits on anything and cycles equal
+// instructions. It offers the cycle(committed) interface of the pipeline
+// models (pipeline.h) so the main loop, sweeps and the Simulator drive it
+// the same way.
+class SingleCycleProcessor {
+	private:
+		Registers &reg_file;
+		Memory &memory;
+		uint32_t end_pc;
+		ALU alu;
+		control_t control;
+		uint64_t branchCount;
+		uint64_t loadCount;
+		uint64_t storeCount;
+		bool verbose;
+		LockstepChecker *checker; //NULL when not checking
+
+	public:
+		// config is taken like the pipelines take it, the datapath has no parameters
+		SingleCycleProcessor(Registers &reg_file, Memory &memory, uint32_t end_pc, const PipelineConfig &config = PipelineConfig()) :
+				reg_file(reg_file), memory(memory), end_pc(end_pc), branchCount(0), loadCount(0), storeCount(0), verbose(false), checker(NULL) {
+			control.clear();
+		}
+
+		// Prints the control signals of every instruction, as the autograder reads them
+		void print_control(bool on) {
+			verbose = on;
+		}
+
+		// Compares every instruction with a golden model
+		void check(LockstepChecker *golden) {
+			checker = golden;
+		}
+
+		// Executes the instruction at the PC, committed is set to 1. Returns
+		// true once the last instruction has run.
+		bool cycle(uint32_t &committed) {
+			// fetch
+			uint32_t pc = reg_file.pc;
+			uint32_t instruction;
+			memory.access(reg_file.pc, instruction, 0, 1, 0);
+			uint32_t opcode = instruction >> 26; //Instruction[31-26]
+			uint32_t Rs = (instruction >> 21) & 0b11111; //Instruction [25-21]
+			uint32_t Rt = (instruction >> 16) & 0b11111; //Instruction [20-16]
+			uint32_t Rd = (instruction >> 11) & 0b11111; //Instruction [15-11]
+			uint32_t Imm = instruction & 0b1111111111111111; //Instruction [15-0]
+			uint32_t Shamt = (instruction >> 6) &0b11111; //Instruction [10-6]
+			uint32_t Funct = instruction & 0b111111; //Instruction [5-0]
+
+			// increment pc
+			reg_file.pc += 4;
+
+			// decode into contol signals
+			control.decode(opcode);
+			if (opcode == 0) {
+				control.decode_funct(Funct);
+			}
+			if (verbose) {
+				control.print(); // used for autograding
+			}
+
+			// Read from reg file
+			uint32_t readData1;
+			uint32_t readData2;
+			reg_file.access(Rs, Rt, readData1, readData2, 0, 0, 0);
+
+			//Sign-extend
+			uint32_t signExtend;
+			if (Imm >> 15 == 1) {
+				signExtend = Imm | 0b11111111111111110000000000000000;
+			}
+			else {
+				signExtend = Imm;
+			}
+
+			// Execution 
+			alu.generate_control_inputs(control.ALU_op, Funct, opcode);
+
+			//Special cases: Andi and Ori
+			if (alu.zeroExtend == true) {
+				signExtend = Imm;
+			}
+
+			//Shifts
+			if (alu.shift == true) {
+				readData1 = Shamt;
+			}
+
+			//ALU
+			uint32_t alu_result;
+			uint32_t zeroFlag = 0;
+			if (control.ALU_src == 0) {
+				alu_result = alu.execute(readData1, readData2, zeroFlag);
+			}
+			else if (control.ALU_src == 1) {
+				alu_result = alu.execute(readData1, signExtend, zeroFlag);
+			}
+
+			//Multiply/divide and moves from HI/LO
+			if (control.mulDiv == 1) {
+				ALU::multiply_divide(Funct, readData1, readData2, reg_file.hi, reg_file.lo);
+			}
+			else if (control.moveFromHi == 1) {
+				alu_result = reg_file.hi;
+			}
+			else if (control.moveFromLo == 1) {
+				alu_result = reg_file.lo;
+			}
+
+			//Branch
+			uint32_t jumpAddress = instruction & 0b11111111111111111111111111; //Instruction [25-0]
+			if (control.jump == 1) {
+				if (control.jumpLink == 1) {
+					uint32_t temp = reg_file.pc + 4; //PC + 8
+					reg_file.access(Rs, Rt, readData1, readData2, 31, control.reg_write, temp); //R31 = PC + 8
+				}
+				jumpAddress = jumpAddress << 2;
+				uint32_t temp = reg_file.pc & 0b11110000000000000000000000000000; //PC + 4 [31-28]
+				jumpAddress += temp; //Jump Address [31=0]
+				reg_file.pc = jumpAddress; //next PC jump address
+			}
+			else if (control.branch == 1 && control.branchNotEqual == 0 && zeroFlag == 1) { //next PC Address MUX
+				reg_file.pc += signExtend << 2;
+			}
+			else if (control.branch == 1 && control.branchNotEqual == 1 && zeroFlag == 0) { //controls BNE MUX
+				reg_file.pc += signExtend << 2;
+			}
+			else if (alu.jumpReg == true) { //controls Jump Register MUX
+				reg_file.pc = readData1;
+			}
+
+			//Store Byte and Halfword
+			uint32_t memReadResult;
+			uint32_t notReadingDataAnyways;
+			if (control.storeByte == 1) {
+				readData2 = readData2 & 0b11111111; //chops 24 bits off from read data 2
+				memory.access(alu_result, memReadResult, 0, true, 0); //M[address + displacement]
+				memReadResult = memReadResult & 0b11111111111111111111111100000000; //M[address + displacement](31:8)
+				memReadResult = memReadResult | readData2;
+				memory.access(alu_result, notReadingDataAnyways, memReadResult, 0, 1); //Store M[address + displacement](7:0) = Rt(7:0)
+			}
+			else if (control.storeHalfWord == 1) {
+				readData2 = readData2 & 0b1111111111111111; //chops 16 bits off from read data 2
+				memory.access(alu_result, memReadResult, 0, true, 0); //M[address + displacement]
+				memReadResult = memReadResult & 0b11111111111111110000000000000000; //M[address + displacement](31:16)
+				memReadResult = memReadResult | readData2;
+				memory.access(alu_result, notReadingDataAnyways, memReadResult, 0, 1); //Store M[address + displacement](15:0) = Rt(15:0)
+			}
+			else {
+				//Memory access
+				memory.access(alu_result, memReadResult, readData2, control.mem_read, control.mem_write); //Load and Store
+			}
+
+			//Load Byte and Halfword
+			if (control.loadByteU == 1) {
+				memReadResult = memReadResult & 0b11111111; //R[rt]=M[R[rs]+SignExtImm](7:0)
+			}
+			else if (control.loadHalfWordU == 1) {
+				memReadResult = memReadResult & 0b1111111111111111; //R[rt]=M[R[rs]+SignExtImm](15:0)
+			}
+
+			//Write Back
+			if (control.loadUpperImm == 1) { //Load Upper Immediate
+				uint32_t temp = Imm << 16;
+				reg_file.access(Rs, Rt, readData1, readData2, Rt, control.reg_write, temp);
+			}
+			else if (control.jumpLink == 0 && alu.jumpReg == 0 && control.branch == 0 && control.branchNotEqual == 0) { //Prevents Jump and Link from working correctly
+				if (control.mem_to_reg == 1) { //write back memory read result
+					if (control.reg_dest == 0) { //use Rt
+						reg_file.access(Rs, Rt, readData1, readData2, Rt, control.reg_write, memReadResult);
+					}
+					else if (control.reg_dest == 1) { //use Rd
+						reg_file.access(Rs, Rt, readData1, readData2, Rd, control.reg_write, memReadResult);
+					}
+				}
+				else if (control.mem_to_reg == 0) { //write back ALU result
+					if (control.reg_dest == 0) {
+						reg_file.access(Rs, Rt, readData1, readData2, Rt, control.reg_write, alu_result);
+					}
+					else if (control.reg_dest == 1) {
+						reg_file.access(Rs, Rt, readData1, readData2, Rd, control.reg_write, alu_result);
+					}
+				}
+			}
+
+
+			if (checker) {
+				Retirement retired = {pc, 0, 0, control.mem_write == 1, alu_result, readData2};
+				if (control.reg_write == 1 && control.jumpLink == 0 && alu.jumpReg == 0 && control.branch == 0) {
+					retired.dest = control.loadUpperImm == 1 || control.reg_dest == 0 ? Rt : Rd;
+					uint32_t dummy;
+					reg_file.access(retired.dest, 0, retired.value, dummy, 0, 0, 0);
+				}
+				checker->retire(retired);
+			}
+			branchCount += control.branch;
+			loadCount += control.mem_read;
+			storeCount += control.mem_write;
+			committed = 1;
+			return reg_file.pc == end_pc;
+		}
+
+		// Nothing ever waits, there are no idle cycles to skip
+		uint64_t idle() const {
+			return 0;
+		}
+
+		void skip(uint64_t cycles) {}
+
+		// Event counts of the whole run
+		uint64_t branches() const {
+			return branchCount;
+		}
+
+		uint64_t mispredicts() const {
+			return 0;
+		}
+
+		uint64_t loads() const {
+			return loadCount;
+		}
+
+		uint64_t stores() const {
+			return storeCount;
+		}
+};
+
+#endif
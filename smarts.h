@@ -0,0 +1,159 @@
+#ifndef SMARTS
+#define SMARTS
+#include <cstdint>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include "memory.h"
+#include "reg_file.h"
+#include "functional.h"
+#include "sampling.h"
+#include "options.h"
+
+// SMARTS sampling. The program is split into equal periods; each period is
+// executed functionally, training the timing model's branch predictor as it
+// goes, except for a detailed warm-up followed by a measurement unit of
+// sim_options.smartsUnit instructions at its end. The CPI estimate is the mean
+// of the unit CPIs with a 95% confidence interval. When that interval is wider
+// than sim_options.smartsError the run is repeated with the number of samples
+// the measured variation calls for.
+
+static const unsigned SMARTS_INITIAL_SAMPLES = 50;
+static const double SMARTS_Z95 = 1.96;
+
+struct SmartsEstimate {
+	std::vector<double> cpis; //CPI of every measured unit
+	uint64_t detailed;        //instructions simulated in detail, warm-up included
+	double mean;
+	double stddev;
+	double halfWidth;         //of the 95% confidence interval
+
+	void summarise() {
+		double sum = 0;
+		for (size_t i = 0; i < cpis.size(); i++) {
+			sum += cpis[i];
+		}
+		mean = cpis.empty() ? 0 : sum / cpis.size();
+		double squares = 0;
+		for (size_t i = 0; i < cpis.size(); i++) {
+			squares += (cpis[i] - mean) * (cpis[i] - mean);
+		}
+		stddev = cpis.size() > 1 ? std::sqrt(squares / (cpis.size() - 1)) : 0;
+		halfWidth = cpis.empty() ? 0 : SMARTS_Z95 * stddev / std::sqrt((double)cpis.size());
+	}
+};
+
+// One sampled pass over the program with the given number of samples
+template <class Processor>
+void smarts_pass(Registers &reg_file, Memory &memory, uint32_t end_pc, uint64_t total, uint64_t samples,
+		uint64_t unit, uint64_t warmup, SmartsEstimate &estimate) {
+	Processor processor(reg_file, memory, end_pc, sim_options.pipeline);
+	FunctionalCore core(reg_file, memory);
+	uint64_t period = total / samples;
+	uint64_t executed = 0;
+	estimate.cpis.clear();
+	estimate.detailed = 0;
+
+	for (uint64_t sample = 0; sample < samples; sample++) {
+		//Functional warming up to the detailed part at the end of the period
+		uint64_t detailedStart = (sample + 1) * period - unit - warmup;
+		while (executed < detailedStart && reg_file.pc != end_pc) {
+			uint32_t pc = reg_file.pc;
+			core.step();
+			if (core.branched) {
+				processor.train_predictor(pc, core.taken);
+			}
+			executed++;
+		}
+		if (reg_file.pc == end_pc) {
+			break;
+		}
+
+		//Detailed warm-up, then the measured unit
+		uint64_t cycles = 0;
+		uint64_t committed = 0;
+		uint64_t startCycle = 0;
+		uint64_t startCommitted = 0;
+		bool ended = false;
+		while (committed < warmup + unit && !ended) {
+			uint32_t insts = 0;
+			ended = processor.cycle(insts);
+			cycles++;
+			committed += insts;
+			if (committed <= warmup) {
+				startCycle = cycles;
+				startCommitted = committed;
+			}
+			uint64_t idle = processor.idle();
+			processor.skip(idle);
+			cycles += idle;
+		}
+		if (committed > startCommitted) {
+			estimate.cpis.push_back((double)(cycles - startCycle) / (committed - startCommitted));
+		}
+
+		//Retire what is in flight so the functional model can take over
+		bool drained = false;
+		if (!ended) {
+			committed += processor.drain(drained);
+		}
+		executed += committed;
+		estimate.detailed += committed;
+		if (ended || drained) {
+			break;
+		}
+	}
+	estimate.summarise();
+}
+
+// Runs SMARTS for one timing model, adding samples until the target error is met
+template <class Processor>
+void smarts_run(Registers &reg_file, Memory &memory, uint32_t end_pc) {
+	uint64_t unit = sim_options.smartsUnit;
+	uint64_t warmup = sim_options.warmup != UINT64_MAX ? sim_options.warmup : 2 * unit;
+	Registers startRegs = reg_file;
+	Memory startMemory = memory;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	//Functional pass for the program length
+	uint64_t total = 0;
+	FunctionalCore core(reg_file, memory);
+	while (reg_file.pc != end_pc) {
+		core.step();
+		total++;
+	}
+	uint64_t maxSamples = std::max<uint64_t>(1, total / (unit + warmup));
+
+	uint64_t samples = std::min<uint64_t>(SMARTS_INITIAL_SAMPLES, maxSamples);
+	SmartsEstimate estimate;
+	while (true) {
+		reg_file = startRegs;
+		memory = startMemory;
+		smarts_pass<Processor>(reg_file, memory, end_pc, total, samples, unit, warmup, estimate);
+		if (estimate.halfWidth <= sim_options.smartsError * estimate.mean || samples == maxSamples) {
+			break;
+		}
+		//n = (z * V / e)^2 samples for coefficient of variation V and relative error e
+		double variation = estimate.stddev / estimate.mean;
+		uint64_t needed = std::ceil(std::pow(SMARTS_Z95 * variation / sim_options.smartsError, 2));
+		if (needed <= samples) {
+			break;
+		}
+		std::cout << "SMARTS: " << samples << " samples give +/-" << 100 * estimate.halfWidth / estimate.mean << "%, retrying with " << std::min(needed, maxSamples) << "\n";
+		samples = std::min(needed, maxSamples);
+	}
+	std::chrono::duration<double> hostTime = std::chrono::steady_clock::now() - start;
+
+	std::cout << "SMARTS: " << total << " instructions, " << estimate.cpis.size() << " units of " << unit << " (+" << warmup << " warm-up) every " << total / samples << "\n";
+	std::cout << "CPI estimate = " << estimate.mean << " +/- " << estimate.halfWidth << " (95% confidence, " << 100 * estimate.halfWidth / estimate.mean << "%)\n";
+	std::cout << "Detailed instructions: " << estimate.detailed << " of " << total << " (" << (double)total / std::max<uint64_t>(estimate.detailed, 1) << "x fewer)\n";
+	std::cout << "Host time: " << hostTime.count() << " s\n";
+	if (sim_options.verify) {
+		report_full_run<Processor>(startRegs, startMemory, end_pc, estimate.mean);
+	}
+	std::cout << "CPI = " << estimate.mean << "\n";
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef SMT
+#define SMT
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include "memory.h"
+#include "reg_file.h"
+#include "options.h"
+
+// Hardware multithreading. sim_options.smtThreads threads share one pipeline,
+// each running the program main.cpp loaded for it (sim_options.smtImages) in
+// its own range of memory. The run ends once every thread has retired its
+// last instruction. It reports the IPC of each thread over the cycles until
+// it finished, and the throughput of the whole run.
+
+template <class Processor, unsigned Threads>
+void smt_threads_run(const char *model, Memory &memory) {
+	const std::vector<ThreadImage> &images = sim_options.smtImages;
+	std::vector<Registers> regs(Threads);
+	Processor processor(regs[0], memory, images[0].end_pc, sim_options.pipeline);
+	for (unsigned t = 0; t < Threads; t++) {
+		regs[t].pc = 0;
+		processor.set_thread(t, regs[t], images[t].base, images[t].end_pc);
+	}
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	uint64_t cycles = 0;
+	uint64_t instructions = 0;
+	std::vector<uint64_t> finishCycle(Threads, 0);
+	while (true) {
+		uint32_t committed = 0;
+		bool ended = processor.cycle(committed);
+		cycles++;
+		instructions += committed;
+		for (unsigned t = 0; t < Threads; t++) {
+			if (finishCycle[t] == 0 && processor.thread_finished(t)) {
+				finishCycle[t] = cycles;
+			}
+		}
+		if (ended) {
+			break;
+		}
+		uint64_t idle = processor.idle();
+		processor.skip(idle);
+		cycles += idle;
+	}
+	std::chrono::duration<double> hostTime = std::chrono::steady_clock::now() - start;
+
+	static const char *policies[] = {"round-robin", "ICOUNT", "switch-on-stall"};
+	std::cout << "SMT: " << Threads << " threads on " << model << ", " << policies[sim_options.pipeline.smtFetch] << " fetch\n";
+	for (unsigned t = 0; t < Threads; t++) {
+		std::cout << "THREAD " << t << " (" << images[t].path << " at " << images[t].base << "): " << processor.retired(t)
+				<< " instructions in " << finishCycle[t] << " cycles, IPC " << (double)processor.retired(t) / finishCycle[t] << "\n";
+		regs[t].print();
+	}
+	std::cout << "Cycles = " << cycles << ", instructions = " << instructions << ", throughput IPC = " << (double)instructions / cycles << "\n";
+	std::cout << "Host time: " << hostTime.count() << " s\n";
+	std::cout << "CPI = " << (double)cycles / instructions << "\n";
+}
+
+// Runs Model<2> or Model<4> for the requested number of threads
+template <template <unsigned> class Model>
+void smt_run(const char *model, Memory &memory) {
+	if (sim_options.smtThreads == 4) {
+		smt_threads_run<Model<4>, 4>(model, memory);
+	}
+	else {
+		smt_threads_run<Model<2>, 2>(model, memory);
+	}
+}
+
+#endif
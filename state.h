@@ -4,35 +4,44 @@
 #include <cstdint>
 #include <iostream>
 #include "control.h"
+#include "cpistack.h"
 // Pipeline registers implementation
+// Register numbers and instruction fields are kept in their natural widths and
+// the flags share one byte with the valid bit. A bubble is any register whose
+// valid bit is clear, the rest of its contents are stale and must not be read.
+// The one exception is the bubble field, why the register is empty as a
+// cpi_category (cpistack.h), which travels down the pipeline with the bubble.
 
 // IFID Pipeline register, only contains instruction and pc + 4
 struct IFID {
-	bool empty;
 	uint32_t PC;
 	uint32_t instruction;
-	uint32_t opcode;
-	uint32_t Rs;
-	uint32_t Rt;
-	uint32_t Rd;
-	uint32_t Imm;
-	uint32_t Shamt;
-	uint32_t Funct;
-	bool branchPred;
+	uint16_t Imm;
+	uint8_t opcode;
+	uint8_t Rs;
+	uint8_t Rt;
+	uint8_t Rd;
+	uint8_t Shamt;
+	uint8_t Funct;
+	uint8_t thread; //hardware thread the instruction belongs to
+	uint32_t id;    //fetch order, names the instruction in a pipeview trace
+	bool valid : 1;
+	bool branchPred : 1;
+	uint8_t bubble : 3;
 
 	void print() {
 		cout << "\n";
 		cout << "IFID: " << "\n";
-		cout << "EMPTY: " << empty << "\n";
+		cout << "VALID: " << valid << "\n";
 		cout << "INSTRUCTION: " << instruction << "\n";
 		cout << "PC: " << PC << "\n";
-		cout << "RS: " << Rs << "\n";
-		cout << "RT: " << Rt << "\n";
-		cout << "RD: " << Rd << "\n";
-		cout << "OPCODE: " << opcode << "\n";
+		cout << "RS: " << (uint32_t)Rs << "\n";
+		cout << "RT: " << (uint32_t)Rt << "\n";
+		cout << "RD: " << (uint32_t)Rd << "\n";
+		cout << "OPCODE: " << (uint32_t)opcode << "\n";
 		cout << "IMM: " << Imm << "\n";
-		cout << "SHAMT: " << Shamt << "\n";
-		cout << "FUNCT: " << Funct << "\n";
+		cout << "SHAMT: " << (uint32_t)Shamt << "\n";
+		cout << "FUNCT: " << (uint32_t)Funct << "\n";
 		cout << "BRANCHPRED: " << branchPred << "\n";
 		cout << "\n";
 	}
@@ -40,67 +49,73 @@ struct IFID {
 
 // IDEX Pipeline register
 struct IDEX {
-	bool empty;
 	control_t control;
 	uint32_t instruction;
 	uint32_t PC;
 	uint32_t readData1;
 	uint32_t readData2;
-	uint32_t Rs;
-	uint32_t Rt;
-	uint32_t Rd;
-	uint32_t opcode;
-	uint32_t Imm;
 	uint32_t signExtendImm;
-	uint32_t Shamt;
-	uint32_t Funct;
-	bool branchPred;
+	uint16_t Imm;
+	uint8_t Rs;
+	uint8_t Rt;
+	uint8_t Rd;
+	uint8_t opcode;
+	uint8_t Shamt;
+	uint8_t Funct;
+	uint8_t storeDataLane;       //lane of the load forwarding the store data MEM->MEM
+	uint8_t thread;
+	uint32_t id;
+	bool valid : 1;
+	bool branchPred : 1;
+	bool storeDataFromLoad : 1;
+	uint8_t bubble : 3;
 
 	void print() {
 		cout << "\n";
 		cout << "IDEX: " << "\n";
-		cout << "EMPTY: " << empty << "\n";
+		cout << "VALID: " << valid << "\n";
 		cout << "CONTROL: " << "\n";
 		control.print();
 		cout << "INSTRUCTION: " << instruction << "\n";
 		cout << "PC: " << PC << "\n";
 		cout << "READDATA1: " << readData1 << "\n";
 		cout << "READDATA2: " << readData2 << "\n";
-		cout << "RS: " << Rs << "\n";
-		cout << "RT: " << Rt << "\n";
-		cout << "RD: " << Rd << "\n";
-		cout << "OPCODE: " << opcode << "\n";
+		cout << "RS: " << (uint32_t)Rs << "\n";
+		cout << "RT: " << (uint32_t)Rt << "\n";
+		cout << "RD: " << (uint32_t)Rd << "\n";
+		cout << "OPCODE: " << (uint32_t)opcode << "\n";
 		cout << "IMM: " << Imm << "\n";
 		cout << "SIGNEXTENDEDIMM: " << signExtendImm << "\n";
-		cout << "SHAMT: " << Shamt << "\n";
-		cout << "FUNCT: " << Funct << "\n";
+		cout << "SHAMT: " << (uint32_t)Shamt << "\n";
+		cout << "FUNCT: " << (uint32_t)Funct << "\n";
 		cout << "BRANCHPRED: " << branchPred << "\n";
+		cout << "STOREDATAFROMLOAD: " << storeDataFromLoad << "\n";
 	}
 };
 
 // EXMEM Pipeline register
 struct EXMEM {
-	bool empty;
 	control_t control;
 	uint32_t instruction;
 	uint32_t PC;
 	uint32_t PCbranch;
-	uint32_t zeroFlag;
 	uint32_t ALUresult;
 	uint32_t readData1;
 	uint32_t readData2;
-	uint32_t Rt;
-	uint32_t Rd;
-	uint32_t regDestination;
-	uint32_t signExtendImm;
-	bool jumpReg;
-	bool PCsrc;
-	bool branchPred;
+	uint8_t regDestination;
+	uint8_t thread;
+	uint32_t id;
+	bool valid : 1;
+	bool zeroFlag : 1;
+	bool jumpReg : 1;
+	bool PCsrc : 1;
+	bool branchPred : 1;
+	uint8_t bubble : 3;
 
 	void print() {
 		cout << "\n";
 		cout << "EXMEM: " << "\n";
-		cout << "EMPTY: " << empty << "\n";
+		cout << "VALID: " << valid << "\n";
 		cout << "CONTROL: " << "\n";
 		control.print();
 		cout << "INSTRUCTION: " << instruction << "\n";
@@ -110,10 +125,7 @@ struct EXMEM {
 		cout << "ALURESULT: " << ALUresult << "\n";
 		cout << "READDATA1: " << readData1 << "\n";
 		cout << "READDATA2: " << readData2 << "\n";
-		cout << "RT: " << Rt << "\n";
-		cout << "RD: " << Rd << "\n";
-		cout << "REGDESTINATION: " << regDestination << "\n";
-		cout << "SIGNEXTENDEDIMM: " << signExtendImm << "\n";
+		cout << "REGDESTINATION: " << (uint32_t)regDestination << "\n";
 		cout << "JUMPREG: " << jumpReg << "\n";
 		cout << "PCSRC: " << PCsrc << "\n";
 		cout << "BRANCHPRED: " << branchPred << "\n";
@@ -122,34 +134,62 @@ struct EXMEM {
 
 // MEMWB Pipeline register
 struct MEMWB {
-	bool empty;
 	control_t control;
 	uint32_t instruction;
-	uint32_t Rt;
-	uint32_t Rd;
 	uint32_t memReadData;
 	uint32_t ALUresult;
-	uint32_t regDestination;
 	uint32_t PC;
-	bool PCsrc;
-	bool jumpReg;
+	uint8_t regDestination;
+	uint8_t thread;
+	uint32_t id;
+	bool valid : 1;
+	bool PCsrc : 1;
+	bool jumpReg : 1;
+	uint8_t bubble : 3;
 
 	void print() {
 		cout << "\n";
 		cout << "MEMWB: " << "\n";
-		cout << "EMPTY: " << empty << "\n";
+		cout << "VALID: " << valid << "\n";
 		cout << "CONTROL: " << "\n";
 		control.print();
 		cout << "ALURESULT: " << ALUresult << "\n";
 		cout << "MEMREADDATA: " << memReadData << "\n";
 		cout << "INSTRUCTION: " << instruction << "\n";
-		cout << "REGDESTINATION: " << regDestination << "\n";
-		cout << "RT: " << Rt << "\n";
-		cout << "RD: " << Rd << "\n";
+		cout << "REGDESTINATION: " << (uint32_t)regDestination << "\n";
 		cout << "JUMPREG: " << jumpReg << "\n";
 		cout << "PC: " << PC << "\n";
 		cout << "PCSrc: " << PCsrc << "\n";
 	}
 };
 
-#endif
\ No newline at end of file
+// One copy of every pipeline register of a Width-wide pipeline. The engine
+// keeps two of these: stages read the current copy and write the next one,
+// and advancing a cycle swaps the two.
+template <unsigned Width>
+struct PipelineLatches {
+	IFID ifid[Width];
+	IDEX idex[Width];
+	EXMEM exmem[Width];
+	MEMWB memwb[Width];
+
+	// Empty every pipeline register
+	void clear() {
+		for (unsigned l = 0; l < Width; l++) {
+			ifid[l].valid = false;
+			idex[l].valid = false;
+			exmem[l].valid = false;
+			memwb[l].valid = false;
+			ifid[l].bubble = CPI_FILL;
+			idex[l].bubble = CPI_FILL;
+			exmem[l].bubble = CPI_FILL;
+			memwb[l].bubble = CPI_FILL;
+			ifid[l].thread = 0;
+			idex[l].thread = 0;
+			exmem[l].thread = 0;
+			memwb[l].thread = 0;
+		}
+	}
+};
+
+#endif
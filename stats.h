@@ -0,0 +1,133 @@
+#ifndef STATS
+#define STATS
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "cpistack.h"
+
+// Time series of a pipeline run for --stats-interval. Every interval cycles a
+// record of what happened during them is written: instructions, IPC, branches
+// and mispredicts, data accesses, and the cycles of every CPI stack category,
+// whose non-base part is the stall cycles. Counters start from zero once the
+// warm-up cycles have passed, so the first record begins there.
+//
+// Both forms start with the effective configuration of the run, the INI text
+// of ParameterRegistry::ini(), so a series can be reproduced. The CSV form
+// has it as # comment lines (lines already comments kept as they are), then a header line, and the rates worked out.
+// The binary form is a 16 byte header, "MIPSSTAT", then the version and the
+// number of fields as uint32_t, then the length of the configuration text as
+// uint32_t and the text, followed by one record per interval of that many
+// uint64_t in host byte order: the first cycle, then the counters in the CSV
+// column order without the rates.
+
+struct StatsCounters {
+	uint64_t cycles;
+	uint64_t instructions;
+	uint64_t branches;
+	uint64_t mispredicts;
+	uint64_t loads;
+	uint64_t stores;
+	uint64_t categories[CPI_CATEGORIES];
+};
+
+enum stats_format {STATS_CSV, STATS_BINARY};
+
+class IntervalStats {
+	private:
+		static const uint32_t VERSION = 2;
+		static const uint32_t FIELDS = 7 + CPI_CATEGORIES;
+
+		FILE *file;
+		stats_format format;
+		uint64_t interval;
+		uint64_t boundary;   //cycle the current record ends at
+		bool started;        //past the warm-up
+		StatsCounters last;  //counters when the current record began
+
+		void header(const std::string &config) {
+			if (format == STATS_BINARY) {
+				uint32_t words[3] = {VERSION, FIELDS, (uint32_t)config.size()};
+				fwrite("MIPSSTAT", 1, 8, file);
+				fwrite(words, sizeof(uint32_t), 3, file);
+				fwrite(config.data(), 1, config.size(), file);
+				return;
+			}
+			size_t line = 0;
+			while (line < config.size()) {
+				size_t end = config.find('\n', line);
+				if (end == std::string::npos) {
+					end = config.size();
+				}
+				std::string text = config.substr(line, end - line);
+				fprintf(file, "%s%s\n", text.empty() ? "#" : text[0] == '#' ? "" : "# ", text.c_str());
+				line = end + 1;
+			}
+			fprintf(file, "cycle,cycles,instructions,ipc,branches,mispredicts,mispredict_rate,loads,stores,stall_cycles");
+			for (unsigned c = 0; c < CPI_CATEGORIES; c++) {
+				fprintf(file, ",%s", CpiStack::key(c));
+			}
+			fprintf(file, "\n");
+		}
+
+		void record(const StatsCounters &now) {
+			StatsCounters d;
+			d.cycles = now.cycles - last.cycles;
+			d.instructions = now.instructions - last.instructions;
+			d.branches = now.branches - last.branches;
+			d.mispredicts = now.mispredicts - last.mispredicts;
+			d.loads = now.loads - last.loads;
+			d.stores = now.stores - last.stores;
+			for (unsigned c = 0; c < CPI_CATEGORIES; c++) {
+				d.categories[c] = now.categories[c] - last.categories[c];
+			}
+			if (format == STATS_BINARY) {
+				uint64_t words[FIELDS] = {last.cycles, d.cycles, d.instructions, d.branches, d.mispredicts, d.loads, d.stores};
+				for (unsigned c = 0; c < CPI_CATEGORIES; c++) {
+					words[7 + c] = d.categories[c];
+				}
+				fwrite(words, sizeof(uint64_t), FIELDS, file);
+			}
+			else {
+				fprintf(file, "%llu,%llu,%llu,%.4f,%llu,%llu,%.4f,%llu,%llu,%llu", (unsigned long long)last.cycles, (unsigned long long)d.cycles,
+						(unsigned long long)d.instructions, d.cycles ? (double)d.instructions / d.cycles : 0.0, (unsigned long long)d.branches,
+						(unsigned long long)d.mispredicts, d.branches ? (double)d.mispredicts / d.branches : 0.0, (unsigned long long)d.loads,
+						(unsigned long long)d.stores, (unsigned long long)(d.cycles - d.categories[CPI_BASE]));
+				for (unsigned c = 0; c < CPI_CATEGORIES; c++) {
+					fprintf(file, ",%llu", (unsigned long long)d.categories[c]);
+				}
+				fprintf(file, "\n");
+			}
+			last = now;
+		}
+
+	public:
+		IntervalStats(FILE *file, stats_format format, uint64_t interval, uint64_t warmup, const std::string &config) :
+				file(file), format(format), interval(interval), boundary(warmup), started(false) {
+			header(config);
+		}
+
+		// Cycle the next record is due at, runs must not skip past it
+		uint64_t due() const {
+			return boundary;
+		}
+
+		// Called with the counters of the whole run once now.cycles reaches due().
+		// The first call ends the warm-up and only starts counting from there.
+		void sample(const StatsCounters &now) {
+			if (started) {
+				record(now);
+			}
+			started = true;
+			last = now;
+			boundary = now.cycles + interval;
+		}
+
+		// Writes the partial record of the cycles since the last one
+		void finish(const StatsCounters &now) {
+			if (started && now.cycles > last.cycles) {
+				record(now);
+			}
+		}
+};
+
+#endif
@@ -0,0 +1,290 @@
+#ifndef SWEEP
+#define SWEEP
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <set>
+#include "memory.h"
+#include "options.h"
+#include "config.h"
+
+// Design-space sweeps for --sweep. A sweep file lists values to try:
+//   program = bench/matmul.s, bench/crc.s    ; .s files are assembled, others loaded as ELF
+//   processor = speculative, io-superscalar
+//   predictor.bht_entries = 256, 1024, 4096
+// and every combination of them is one run. [run] sections add runs of their
+// own: the lines above the first section apply to each of them, with a key
+// the section sets again taking its values from there instead, e.g.
+//   program = bench/quicksort.s
+//   [run]
+//   processor = pipelined
+//   [run]
+//   processor = speculative
+//   predictor.history_bits = 4, 8
+// Any parameter of the registry (config.h) some run reads can be swept,
+// starting from the configuration --config and --set gave. A run leaves out
+// the keys its model does not read, and runs that come out the same are made
+// once. cores = 2, 4 runs the pipeline models as a multicore (multicore.h),
+// which is what reads the cache.* keys. Each program is loaded once, and its
+// image is only ever copied from, into the memory of each run. The config column of
+// the results is the hash of a run's whole configuration (ParameterRegistry::hash()).
+
+// A program loaded for the runs of a sweep
+struct ProgramImage {
+	std::string path;
+	std::string key;  //identity of its file, program_key() in loader.h
+	Memory memory;
+	uint32_t end_pc;
+};
+
+struct SweepJob {
+	unsigned program; //index in SweepPlan::images
+	std::string model;
+	unsigned cores;
+	PipelineConfig pipeline;
+	CacheConfig cache;
+
+	SweepJob() : program(0), cores(1) {}
+};
+
+// Counts of one run. The *_main_loop functions return them too, exactly, for
+// detailed runs on one core; the sampled, parallel, multicore, SMT and ROI
+// modes return zeros.
+struct SweepResult {
+	uint64_t cycles;
+	uint64_t instructions;
+	uint64_t branches;
+	uint64_t mispredicts;
+	uint64_t loads;
+	uint64_t stores;
+	double wallTime; //host seconds
+	bool cached;     //taken from the result cache (resultcache.h), not simulated
+};
+
+class SweepPlan {
+	private:
+		typedef std::vector<std::pair<std::string, std::vector<std::string> > > Grid; //key and its values, in file order
+
+		static std::string trim(const std::string &text) {
+			size_t first = text.find_first_not_of(" \t\r");
+			if (first == std::string::npos) {
+				return "";
+			}
+			return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+		}
+
+		static std::vector<std::string> split(const std::string &list) {
+			std::vector<std::string> values;
+			std::stringstream in(list);
+			std::string value;
+			while (std::getline(in, value, ',')) {
+				if (!trim(value).empty()) {
+					values.push_back(trim(value));
+				}
+			}
+			return values;
+		}
+
+		static void put(Grid &grid, const std::string &key, const std::vector<std::string> &values) {
+			for (size_t i = 0; i < grid.size(); i++) {
+				if (grid[i].first == key) {
+					grid[i].second = values;
+					return;
+				}
+			}
+			grid.push_back(std::make_pair(key, values));
+		}
+
+		unsigned program(const std::string &path) {
+			for (size_t i = 0; i < images.size(); i++) {
+				if (images[i].path == path) {
+					return i;
+				}
+			}
+			images.push_back(ProgramImage());
+			images.back().path = path;
+			images.back().end_pc = 0;
+			return images.size() - 1;
+		}
+
+		// Keys of the grid that are not parameters of the registry
+		static bool run_key(const std::string &key) {
+			return key == "program" || key == "processor" || key == "cores";
+		}
+
+		// One job per combination of the grid's values, the same run only once
+		bool expand(const Grid &grid, const PipelineConfig &pipeline, const CacheConfig &cache, std::string &error) {
+			std::vector<size_t> pick(grid.size(), 0);
+			while (true) {
+				SweepJob job;
+				job.pipeline = pipeline;
+				job.cache = cache;
+				ParameterRegistry registry(job.pipeline, job.cache);
+				std::string programPath;
+				std::string where;
+				for (size_t k = 0; k < grid.size(); k++) {
+					const std::string &key = grid[k].first;
+					const std::string &value = grid[k].second[pick[k]];
+					where += (where.empty() ? "" : ", ") + key + "=" + value;
+					if (key == "program") {
+						programPath = value;
+					}
+					else if (key == "processor") {
+						job.model = value;
+					}
+					else if (key == "cores") {
+						char *end;
+						unsigned long cores = strtoul(value.c_str(), &end, 10);
+						if (*end != '\0' || cores < 1 || cores > 32) {
+							error = where + ": cores must be between 1 and 32";
+							return false;
+						}
+						job.cores = cores;
+					}
+				}
+				if (programPath.empty() || job.model.empty()) {
+					error = "every run needs a program and a processor";
+					return false;
+				}
+				if (!sweepable(job.model)) {
+					error = "processor " + job.model + " cannot be swept";
+					return false;
+				}
+				if (job.cores > 1 && job.model == "single-cycle") {
+					error = where + ": cores needs a pipeline model";
+					return false;
+				}
+				//A key this run does not read keeps the configuration's value
+				for (size_t k = 0; k < grid.size(); k++) {
+					const std::string &key = grid[k].first;
+					if (!run_key(key) && registry.reads(key, job.model, job.cores, 1) && !registry.set(key, grid[k].second[pick[k]], error)) {
+						return false;
+					}
+				}
+				if (!registry.validate(error)) {
+					error = where + ": " + error;
+					return false;
+				}
+				job.program = program(programPath);
+				if (made.insert(programPath + "\n" + job.model + "\n" + std::to_string(job.cores) + "\n" + registry.ini()).second) {
+					jobs.push_back(job);
+				}
+
+				//Next combination, the last key changing fastest
+				size_t k = grid.size();
+				while (k > 0 && ++pick[k - 1] == grid[k - 1].second.size()) {
+					pick[--k] = 0;
+				}
+				if (k == 0) {
+					return true;
+				}
+			}
+		}
+
+		std::set<std::string> made; //program, processor, cores and configuration of every job
+
+	public:
+		std::vector<ProgramImage> images; //every program of the runs, main.cpp loads them
+		std::vector<std::string> keys;    //the parameters swept and cores, in file order
+		std::vector<SweepJob> jobs;
+
+		// Models a run can use, the out-of-order ones simulate nothing yet
+		static bool sweepable(const std::string &model) {
+			return model == "single-cycle" || model == "pipelined" || model == "speculative" || model == "io-superscalar";
+		}
+
+		// Reads a sweep file, runs start from the configuration pipeline and cache
+		bool load(const std::string &path, const PipelineConfig &pipeline, const CacheConfig &cache, std::string &error) {
+			std::ifstream in(path.c_str());
+			if (!in) {
+				error = "cannot open " + path;
+				return false;
+			}
+			PipelineConfig scratchPipeline;
+			CacheConfig scratchCache;
+			ParameterRegistry registry(scratchPipeline, scratchCache); //only asked which keys exist
+			std::vector<Grid> sections(1); //the lines above the first [run], then each [run]
+			std::string line;
+			for (unsigned number = 1; std::getline(in, line); number++) {
+				line = trim(line.substr(0, line.find_first_of(";#")));
+				if (line.empty()) {
+					continue;
+				}
+				std::string where = path + ": line " + std::to_string(number) + ": ";
+				if (line == "[run]") {
+					sections.push_back(Grid());
+					continue;
+				}
+				size_t equals = line.find('=');
+				if (equals == std::string::npos) {
+					error = where + "expected key = value, value, ... or [run]";
+					return false;
+				}
+				std::string key = trim(line.substr(0, equals));
+				std::vector<std::string> values = split(line.substr(equals + 1));
+				if (!run_key(key) && !registry.known(key)) {
+					error = where + "unknown parameter " + key;
+					return false;
+				}
+				if (values.empty()) {
+					error = where + key + " has no values";
+					return false;
+				}
+				put(sections.back(), key, values);
+				if (key != "program" && key != "processor" && std::find(keys.begin(), keys.end(), key) == keys.end()) {
+					keys.push_back(key);
+				}
+			}
+			for (size_t s = sections.size() > 1 ? 1 : 0; s < sections.size(); s++) {
+				Grid grid = sections[0];
+				for (size_t k = 0; k < sections[s].size(); k++) {
+					put(grid, sections[s][k].first, sections[s][k].second);
+				}
+				if (!expand(grid, pipeline, cache, error)) {
+					error = path + ": " + error;
+					return false;
+				}
+			}
+			//A key only some models read may be swept along with the others, but some run must read it
+			for (size_t k = 0; k < keys.size(); k++) {
+				bool read = keys[k] == "cores";
+				for (size_t j = 0; j < jobs.size() && !read; j++) {
+					read = registry.reads(keys[k], jobs[j].model, jobs[j].cores, 1);
+				}
+				if (!read) {
+					error = path + ": " + keys[k] + " is not used by any run, it needs " + registry.needs(keys[k]);
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// One line per run with its parameters and counts, in the order of the file
+		void write_csv(FILE *file, const std::vector<SweepResult> &results) const {
+			fprintf(file, "run,program,processor");
+			for (size_t k = 0; k < keys.size(); k++) {
+				fprintf(file, ",%s", keys[k].c_str());
+			}
+			fprintf(file, ",config,cycles,instructions,cpi,branches,mispredicts,loads,stores,wall_time,cached\n");
+			for (size_t j = 0; j < jobs.size(); j++) {
+				SweepJob job = jobs[j];
+				ParameterRegistry registry(job.pipeline, job.cache);
+				const SweepResult &r = results[j];
+				fprintf(file, "%zu,%s,%s", j, images[job.program].path.c_str(), job.model.c_str());
+				for (size_t k = 0; k < keys.size(); k++) {
+					fprintf(file, ",%s", keys[k] == "cores" ? std::to_string(job.cores).c_str() : registry.get(keys[k]).c_str());
+				}
+				fprintf(file, ",%s", registry.hash().c_str());
+				fprintf(file, ",%llu,%llu,%.6f,%llu,%llu,%llu,%llu,%.6f,%d\n", (unsigned long long)r.cycles, (unsigned long long)r.instructions,
+						r.instructions ? (double)r.cycles / r.instructions : 0.0, (unsigned long long)r.branches, (unsigned long long)r.mispredicts,
+						(unsigned long long)r.loads, (unsigned long long)r.stores, r.wallTime, r.cached);
+			}
+		}
+};
+
+#endif
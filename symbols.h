@@ -0,0 +1,143 @@
+#ifndef SYMBOLS
+#define SYMBOLS
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <elf.h>
+
+// Names of the guest's code addresses, for reports about where time went.
+// They come from the .symtab of an ELF binary or from the labels of an
+// assembled program. A symbol without a size runs up to the next one.
+
+struct Symbol {
+	uint32_t address;
+	uint32_t size; //0 if unknown
+	std::string name;
+
+	bool operator<(const Symbol &other) const {
+		return address < other.address;
+	}
+};
+
+class SymbolTable {
+	private:
+		std::vector<Symbol> symbols; //sorted by address, one per address
+		bool sorted;
+
+		void sort() {
+			if (sorted) {
+				return;
+			}
+			std::stable_sort(symbols.begin(), symbols.end());
+			std::vector<Symbol> unique;
+			for (size_t i = 0; i < symbols.size(); i++) {
+				if (unique.empty() || unique.back().address != symbols[i].address) {
+					unique.push_back(symbols[i]);
+				}
+				else if (unique.back().size == 0) {
+					unique.back() = symbols[i]; //a function over a plain label at the same address
+				}
+			}
+			symbols.swap(unique);
+			sorted = true;
+		}
+
+		static bool read(FILE *file, uint32_t offset, void *data, size_t bytes) {
+			return fseek(file, offset, SEEK_SET) == 0 && fread(data, 1, bytes, file) == bytes;
+		}
+
+	public:
+		SymbolTable() : sorted(true) {}
+
+		void add(const std::string &name, uint32_t address, uint32_t size = 0) {
+			Symbol symbol = {address, size, name};
+			symbols.push_back(symbol);
+			sorted = false;
+		}
+
+		bool empty() const {
+			return symbols.empty();
+		}
+
+		// Adds the functions and code labels of an ELF .symtab, false with the
+		// reason in error if the file has none
+		bool load_elf(const char *path, std::string &error) {
+			FILE *file = fopen(path, "r");
+			if (!file) {
+				error = "cannot open " + std::string(path);
+				return false;
+			}
+			Elf32_Ehdr ehdr;
+			std::vector<Elf32_Shdr> sections;
+			if (read(file, 0, &ehdr, sizeof(ehdr)) && ehdr.e_shentsize == sizeof(Elf32_Shdr)) {
+				sections.resize(ehdr.e_shnum);
+				if (ehdr.e_shnum == 0 || !read(file, ehdr.e_shoff, &sections[0], ehdr.e_shnum * sizeof(Elf32_Shdr))) {
+					sections.clear();
+				}
+			}
+			error = "no .symtab in " + std::string(path);
+			for (size_t s = 0; s < sections.size(); s++) {
+				const Elf32_Shdr &symtab = sections[s];
+				if (symtab.sh_type != SHT_SYMTAB || symtab.sh_link >= sections.size() || symtab.sh_entsize != sizeof(Elf32_Sym)) {
+					continue;
+				}
+				const Elf32_Shdr &strtab = sections[symtab.sh_link];
+				std::vector<char> names(strtab.sh_size + 1, 0);
+				std::vector<Elf32_Sym> entries(symtab.sh_size / sizeof(Elf32_Sym));
+				if ((strtab.sh_size > 0 && !read(file, strtab.sh_offset, &names[0], strtab.sh_size)) ||
+						(!entries.empty() && !read(file, symtab.sh_offset, &entries[0], entries.size() * sizeof(Elf32_Sym)))) {
+					error = "truncated .symtab in " + std::string(path);
+					break;
+				}
+				for (size_t i = 0; i < entries.size(); i++) {
+					const Elf32_Sym &sym = entries[i];
+					unsigned type = ELF32_ST_TYPE(sym.st_info);
+					if ((type != STT_FUNC && type != STT_NOTYPE) || sym.st_name == 0 || sym.st_name >= strtab.sh_size ||
+							sym.st_shndx == SHN_UNDEF || sym.st_shndx >= sections.size() || (sections[sym.st_shndx].sh_flags & SHF_EXECINSTR) == 0) {
+						continue;
+					}
+					add(&names[sym.st_name], sym.st_value, sym.st_size);
+				}
+				error.clear();
+				break;
+			}
+			fclose(file);
+			return error.empty();
+		}
+
+		// Symbol pc lies in, NULL if it is before every symbol or past the end of a sized one
+		const Symbol *lookup(uint32_t pc) {
+			sort();
+			Symbol key = {pc, 0, ""};
+			std::vector<Symbol>::const_iterator next = std::upper_bound(symbols.begin(), symbols.end(), key);
+			if (next == symbols.begin()) {
+				return NULL;
+			}
+			const Symbol &symbol = *(next - 1);
+			if (symbol.size != 0 && pc - symbol.address >= symbol.size) {
+				return NULL;
+			}
+			return &symbol;
+		}
+
+		// name+offset of pc, or its address in hex when no symbol covers it
+		std::string describe(uint32_t pc) {
+			std::ostringstream out;
+			const Symbol *symbol = lookup(pc);
+			if (symbol) {
+				out << symbol->name;
+				if (pc != symbol->address) {
+					out << "+0x" << std::hex << pc - symbol->address;
+				}
+			}
+			else {
+				out << "0x" << std::hex << pc;
+			}
+			return out.str();
+		}
+};
+
+#endif
@@ -0,0 +1,249 @@
+#ifndef SYNTHETIC
+#define SYNTHETIC
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <random>
+#include "memory.h"
+#include "encoding.h"
+#include "options.h"
+
+// Synthetic programs written straight into Memory, for hosts without a MIPS
+// toolchain. A loop body of about SYNTH_BODY instructions is drawn from the
+// instruction mix with a seeded generator and repeated until roughly the
+// requested number of instructions have run. Only opcodes the control table
+// decodes are used, so every model can run the result.
+//
+// Text starts at address 0, the outcome table of the random branches is at
+// SYNTH_TABLE and the data the loads and stores walk starts at SYNTH_DATA.
+//
+// Results rotate through a pool of 16 registers and each source reads the
+// result produced a geometrically distributed distance back, so depDistance
+// is the mean producer to consumer distance counted in results.
+//
+// A predictable branch compares a register with itself and is always or never
+// taken. Any other branch loads its outcome from the table, where entries are
+// taken at takenRate, and reads the next entry every time it runs. Taken
+// branches skip 1 to 3 instructions ahead.
+//
+// The k-th load or store of the body accesses k * stride past a pointer that
+// moves on by a whole iteration's accesses each time round and goes back to
+// SYNTH_DATA once it reaches the footprint, which is rounded up to a whole
+// number of iterations.
+//
+// $s0-$s3 and $s5-$s7 hold the loop state and never take a result.
+
+static const uint32_t SYNTH_BODY = 256;
+static const uint32_t SYNTH_TABLE = 0x4000;
+static const uint32_t SYNTH_TABLE_MASK = 0x1FFC; //the table pointer cycles over 8KB
+static const uint32_t SYNTH_DATA = 0x10000;
+
+class SyntheticGenerator {
+	private:
+		static const unsigned POOL = 16;
+		static const uint32_t COUNTER = 16; //$s0, iterations left
+		static const uint32_t POINTER = 17; //$s1, data accessed this iteration
+		static const uint32_t LIMIT = 18;   //$s2, end of the footprint
+		static const uint32_t BASE = 19;    //$s3, start of the footprint
+		static const uint32_t STEP = 21;    //$s5, bytes the pointer moves per iteration
+		static const uint32_t TABLE = 22;   //$s6, offset of this iteration's outcomes
+		static const uint32_t SCRATCH = 23; //$s7
+
+		const SyntheticConfig &config;
+		std::mt19937 rng;
+		uint32_t pool[POOL];
+		uint64_t results;       //results produced so far, the next goes to pool[results % POOL]
+		uint32_t accesses;      //loads and stores in the body
+		uint32_t randomBranches;
+		double skipped;         //instructions taken branches are expected to skip per iteration
+
+		//LUI/ORI pair setting reg to value
+		static void set(std::vector<uint32_t> &text, uint32_t reg, uint32_t value) {
+			text.push_back(i_type(15, 0, reg, value >> 16));
+			text.push_back(i_type(13, reg, reg, value & 0xFFFF));
+		}
+
+		//Uniform in [0, 1), the same on every host for a seed
+		double uniform() {
+			return rng() / 4294967296.0;
+		}
+
+		uint32_t source() {
+			double p = 1.0 / std::max(1.0, config.depDistance);
+			uint64_t distance = 1;
+			if (p < 1) {
+				distance += (uint64_t)std::floor(std::log(1 - uniform()) / std::log(1 - p));
+			}
+			distance = std::min<uint64_t>(distance, POOL - 1);
+			return pool[(results - distance) % POOL];
+		}
+
+		uint32_t destination() {
+			return pool[results++ % POOL];
+		}
+
+		void alu(std::vector<uint32_t> &text) {
+			static const uint32_t functs[] = {32, 33, 34, 35, 36, 37, 39, 42, 43};
+			static const uint32_t immediates[] = {8, 9, 10, 11, 12, 13};
+			uint32_t pick = rng() % 18;
+			if (pick < 9) {
+				uint32_t rs = source();
+				uint32_t rt = source();
+				text.push_back(r_type(functs[pick], rs, rt, destination(), 0));
+			}
+			else if (pick < 11) {
+				uint32_t rt = source();
+				text.push_back(r_type(pick == 9 ? 0 : 2, 0, rt, destination(), rng() % 32)); //SLL, SRL
+			}
+			else if (pick < 17) {
+				uint32_t rs = source();
+				text.push_back(i_type(immediates[pick - 11], rs, destination(), rng()));
+			}
+			else {
+				text.push_back(i_type(15, 0, destination(), rng())); //LUI
+			}
+		}
+
+		void load(std::vector<uint32_t> &text) {
+			static const uint32_t opcodes[] = {35, 36, 37}; //LW, LBU, LHU
+			text.push_back(i_type(opcodes[rng() % 3], POINTER, destination(), accesses++ * config.stride));
+		}
+
+		void store(std::vector<uint32_t> &text) {
+			static const uint32_t opcodes[] = {43, 40, 41}; //SW, SB, SH
+			text.push_back(i_type(opcodes[rng() % 3], POINTER, source(), accesses++ * config.stride));
+		}
+
+		//Returns how many instructions a taken branch skips
+		uint32_t branch(std::vector<uint32_t> &text) {
+			uint32_t skip = 1 + rng() % 3;
+			if (uniform() < config.predictability) {
+				uint32_t reg = source();
+				bool taken = uniform() < config.takenRate;
+				text.push_back(i_type(taken ? 4 : 5, reg, reg, skip)); //BEQ always, BNE never taken
+				skipped += taken ? skip : 0;
+			}
+			else {
+				uint32_t outcome = destination();
+				text.push_back(i_type(35, TABLE, outcome, SYNTH_TABLE + 4 * randomBranches++));
+				text.push_back(i_type(5, outcome, 0, skip));
+				skipped += config.takenRate * skip;
+			}
+			return skip;
+		}
+
+		void muldiv(std::vector<uint32_t> &text) {
+			uint32_t rs = source();
+			uint32_t rt = source();
+			text.push_back(r_type(24 + rng() % 4, rs, rt, 0, 0));                //MULT, MULTU, DIV, DIVU
+			text.push_back(r_type(rng() % 2 ? 16 : 18, 0, 0, destination(), 0)); //MFHI, MFLO
+		}
+
+	public:
+		SyntheticGenerator(const SyntheticConfig &config) : config(config), rng(config.seed), results(POOL), accesses(0), randomBranches(0), skipped(0) {
+			static const uint32_t registers[POOL] = {2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 24, 25};
+			for (unsigned i = 0; i < POOL; i++) {
+				pool[i] = registers[i];
+			}
+		}
+
+		// Writes the program into memory and returns its end_pc, or 0 with the reason in error
+		uint32_t generate(Memory &memory, std::string &error) {
+			unsigned weights = 0;
+			for (unsigned c = 0; c < SYNTH_CLASSES; c++) {
+				weights += config.mix[c];
+			}
+			if (weights == 0) {
+				error = "the instruction mix is empty";
+				return 0;
+			}
+			if (config.stride % 4 != 0) {
+				error = "the stride must be a multiple of 4";
+				return 0;
+			}
+
+			//Body drawn from the mix, padded so every taken branch lands inside it
+			std::vector<uint32_t> body;
+			size_t reach = 0;
+			while (body.size() < SYNTH_BODY || body.size() < reach) {
+				uint32_t pick = rng() % weights;
+				unsigned c = 0;
+				while (pick >= config.mix[c]) {
+					pick -= config.mix[c++];
+				}
+				if (body.size() >= SYNTH_BODY) {
+					c = SYNTH_ALU;
+				}
+				if (c == SYNTH_ALU) {
+					alu(body);
+				}
+				else if (c == SYNTH_LOAD) {
+					load(body);
+				}
+				else if (c == SYNTH_STORE) {
+					store(body);
+				}
+				else if (c == SYNTH_BRANCH) {
+					uint32_t skip = branch(body);
+					reach = std::max(reach, body.size() + skip);
+				}
+				else {
+					muldiv(body);
+				}
+			}
+
+			uint32_t step = accesses * config.stride;
+			if (accesses > 0 && (accesses - 1) * config.stride > 0x7FFF) {
+				error = "the stride is too large for the loads and stores of one iteration";
+				return 0;
+			}
+			uint32_t footprint = config.footprint;
+			if (step > 0) {
+				footprint = std::max<uint32_t>(1, (footprint + step - 1) / step) * step;
+			}
+			if (SYNTH_DATA + (uint64_t)std::max(footprint, step) > (uint64_t)memory.words() * 4) {
+				error = "the footprint does not fit in memory";
+				return 0;
+			}
+
+			std::vector<uint32_t> text;
+			for (unsigned i = 0; i < POOL; i++) {
+				set(text, pool[i], rng());
+			}
+			double perIteration = std::max(1.0, body.size() + 8 - skipped);
+			uint64_t iterations = std::max<uint64_t>(1, std::llround(config.instructions / perIteration));
+			set(text, COUNTER, std::min<uint64_t>(iterations, UINT32_MAX));
+			set(text, POINTER, SYNTH_DATA);
+			set(text, LIMIT, SYNTH_DATA + footprint);
+			set(text, BASE, SYNTH_DATA);
+			set(text, STEP, step);
+			text.push_back(i_type(13, 0, TABLE, 0));
+			size_t loop = text.size();
+			text.insert(text.end(), body.begin(), body.end());
+			text.push_back(r_type(33, POINTER, STEP, POINTER, 0));        //ADDU, next iteration's data
+			text.push_back(r_type(43, POINTER, LIMIT, SCRATCH, 0));       //SLTU
+			text.push_back(i_type(5, SCRATCH, 0, 1));                     //BNE, still inside the footprint
+			text.push_back(r_type(37, BASE, 0, POINTER, 0));              //OR, back to its start
+			text.push_back(i_type(9, TABLE, TABLE, 4 * randomBranches));  //ADDIU, next outcomes
+			text.push_back(i_type(12, TABLE, TABLE, SYNTH_TABLE_MASK));   //ANDI
+			text.push_back(i_type(9, COUNTER, COUNTER, -1));              //ADDIU
+			text.push_back(i_type(5, COUNTER, 0, loop - text.size() - 1)); //BNE loop
+			if (text.size() * 4 > SYNTH_TABLE) {
+				error = "the program does not fit below the outcome table";
+				return 0;
+			}
+
+			uint32_t dummy;
+			for (size_t i = 0; i < text.size(); i++) {
+				memory.access(i * 4, dummy, text[i], false, true);
+			}
+			//Every entry the table pointer can reach, it wraps within the mask
+			for (uint32_t i = 0; i < (SYNTH_TABLE_MASK + 4) / 4 + randomBranches; i++) {
+				memory.access(SYNTH_TABLE + 4 * i, dummy, uniform() < config.takenRate, false, true);
+			}
+			return text.size() * 4;
+		}
+};
+
+#endif
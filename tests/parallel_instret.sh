@@ -0,0 +1,20 @@
+#!/bin/sh
+# The intervals of a --parallel run split the program's instructions between
+# them, so their total must be the functional model's count for any number of
+# intervals. --check reports that count, the steps the functional model took.
+# Usage: tests/parallel_instret.sh [processor binary]
+PROCESSOR=${1:-./processor}
+status=0
+for program in bench/*.s; do
+	expected=$($PROCESSOR --asm "$program" --quiet --check --processor pipelined | sed -n 's/^CHECK: \([0-9]*\) instructions.*/\1/p')
+	for model in pipelined speculative io-superscalar; do
+		for intervals in 1 3 8 64; do
+			instret=$($PROCESSOR --asm "$program" --quiet --parallel $intervals --processor $model | sed -n 's/^Cycles = .*, instructions = \([0-9]*\)$/\1/p')
+			if [ "$instret" != "$expected" ]; then
+				echo "FAIL $program: $model in $intervals intervals counts $instret instructions, the functional model $expected"
+				status=1
+			fi
+		done
+	done
+done
+exit $status
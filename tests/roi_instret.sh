@@ -0,0 +1,22 @@
+#!/bin/sh
+# The ROI markers snapshot the counts as the marker stores retire, so every
+# model must count the same instructions in a program's region of interest.
+# Usage: tests/roi_instret.sh [processor binary]
+PROCESSOR=${1:-./processor}
+status=0
+for program in bench/*.s; do
+	expected=
+	for model in single-cycle pipelined speculative io-superscalar; do
+		instret=$($PROCESSOR --asm "$program" --quiet --processor $model | sed -n 's/^ROI: .* cycles, \([0-9]*\) instructions.*/\1/p')
+		if [ -z "$instret" ]; then
+			continue #the program marks no ROI
+		fi
+		if [ -z "$expected" ]; then
+			expected=$instret
+		elif [ "$instret" != "$expected" ]; then
+			echo "FAIL $program: $model counts $instret ROI instructions, single-cycle $expected"
+			status=1
+		fi
+	done
+done
+exit $status
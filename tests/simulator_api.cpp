@@ -0,0 +1,183 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <elf.h>
+#include <unistd.h>
+#include "simulator.h"
+#include "encoding.h"
+
+// The embedding API of libprocessor.a (simulator.h) against the command line
+// it shares the models with. Runs from the top of the tree, like tests/*.sh.
+// Usage: tests/simulator_api [processor binary]
+
+using namespace std;
+
+static const char *const MODELS[] = {"single-cycle", "pipelined", "speculative", "io-superscalar"};
+static const char *const PROGRAM = "bench/list.s";
+
+static int failures = 0;
+
+static void expect(bool ok, const string &what) {
+	if (!ok) {
+		cout << "FAIL " << what << "\n";
+		failures++;
+	}
+}
+
+// Everything a command prints to stdout
+static string capture(const string &command) {
+	string out;
+	FILE *pipe = popen(command.c_str(), "r");
+	if (!pipe) {
+		return out;
+	}
+	char buffer[65536];
+	size_t n;
+	while ((n = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+		out.append(buffer, n);
+	}
+	pclose(pipe);
+	return out;
+}
+
+// An ELF image of the words, as load_elf() reads them: a text section at address 0
+static string elf_image(const vector<uint32_t> &words) {
+	Elf32_Ehdr ehdr;
+	Elf32_Shdr shdr;
+	memset(&ehdr, 0, sizeof(ehdr));
+	memset(&shdr, 0, sizeof(shdr));
+	memcpy(ehdr.e_ident, "\177ELF\1\1\1", 7);
+	ehdr.e_shoff = sizeof(ehdr);
+	ehdr.e_shentsize = sizeof(shdr);
+	ehdr.e_shnum = 1;
+	shdr.sh_flags = SHF_EXECINSTR;
+	shdr.sh_offset = sizeof(ehdr) + sizeof(shdr);
+	shdr.sh_size = 4 * words.size();
+	string image((const char *)&ehdr, sizeof(ehdr));
+	image.append((const char *)&shdr, sizeof(shdr));
+	image.append((const char *)words.data(), 4 * words.size());
+	return image;
+}
+
+// load(buffer) runs the program it is given, on the registers and memory set before
+static void test_buffer(const string &model) {
+	vector<uint32_t> words;
+	words.push_back(i_type(35, 0, 8, 0x100));  //lw $t0, 0x100($zero)
+	words.push_back(r_type(33, 8, 4, 2, 0));   //addu $v0, $t0, $a0
+	words.push_back(i_type(43, 0, 2, 0x104));  //sw $v0, 0x104($zero)
+	string image = elf_image(words);
+
+	Simulator sim(model);
+	string error;
+	expect(sim.load(image.data(), image.size(), error), model + ": load(buffer) failed: " + error);
+	expect(sim.write_word(0x100, 5), model + ": write_word(0x100) refused");
+	sim.set_reg(4, 7);
+	expect(sim.reg(4) == 7, model + ": set_reg(4) did not stick");
+	sim.run();
+	uint32_t stored = 0;
+	expect(sim.done(), model + ": the program did not end");
+	expect(sim.reg(2) == 12, model + ": $v0 is " + to_string(sim.reg(2)) + ", expected 12");
+	expect(sim.read_word(0x104, stored) && stored == 12, model + ": stored " + to_string(stored) + ", expected 12");
+	expect(sim.stats().instructions == words.size(), model + ": counted " + to_string(sim.stats().instructions) + " instructions, expected 3");
+	expect(!sim.write_word(0x102, 0) && !sim.write_word(sim.memory_bytes(), 0), model + ": write_word took a bad address");
+	expect(!sim.load("", 1, error), model + ": load(buffer) took a bad image");
+}
+
+// step, run_until_instret and run_until_pc stop where they say, and report why
+static void test_stops(const string &model) {
+	Simulator sim(model);
+	string error;
+	expect(sim.load(PROGRAM, error), model + ": load failed: " + error);
+	expect(sim.step(10) == 10 && sim.stats().cycles == 10, model + ": step(10) did not simulate 10 cycles");
+	expect(sim.run_until_instret(1000), model + ": run_until_instret(1000) returned false");
+	uint64_t instructions = sim.stats().instructions;
+	expect(instructions >= 1000 && instructions < 1002, model + ": run_until_instret(1000) stopped at " + to_string(instructions));
+
+	uint32_t pc = sim.pc();
+	expect(!sim.run_until_pc(pc, 0), model + ": run_until_pc with no cycles to run reported reaching the PC");
+	sim.step(1);
+	expect(sim.run_until_pc(pc) && sim.pc() == pc, model + ": run_until_pc did not stop at " + to_string(pc));
+	uint64_t cycles = sim.stats().cycles;
+	expect(!sim.run_until_pc(0x3fffc, 5) && sim.stats().cycles == cycles + 5, model + ": run_until_pc did not stop after its limit");
+	expect(!sim.run_until_pc(0x3fffc) && sim.done(), model + ": run_until_pc of an unreached PC did not run to the end");
+	expect(!sim.run_until_instret(UINT64_MAX), model + ": run_until_instret past the end returned true");
+}
+
+// Counts of run() for every model, as the --sweep rows of the same program and configuration give them
+static void test_sweep(const string &processor, const string &dir) {
+	string sweep = dir + "/sweep.txt";
+	string out = dir + "/sweep.csv";
+	FILE *file = fopen(sweep.c_str(), "w");
+	fprintf(file, "program = %s\nprocessor = single-cycle, pipelined, speculative, io-superscalar\n", PROGRAM);
+	fclose(file);
+	capture(processor + " --no-cache --sweep-out " + out + " --sweep " + sweep);
+	string csv = capture("cat " + out);
+
+	istringstream rows(csv);
+	string row;
+	getline(rows, row); //header
+	size_t model = 0;
+	while (getline(rows, row) && model < 4) {
+		//run,program,processor,config,cycles,instructions,cpi,branches,mispredicts,loads,stores,...
+		vector<string> fields;
+		istringstream in(row);
+		string field;
+		while (getline(in, field, ',')) {
+			fields.push_back(field);
+		}
+		Simulator sim(MODELS[model]);
+		string error;
+		expect(sim.load(PROGRAM, error), string(MODELS[model]) + ": load failed: " + error);
+		sim.run();
+		SimulatorStats stats = sim.stats();
+		ostringstream got;
+		got << stats.cycles << "," << stats.instructions << "," << stats.branches << "," << stats.mispredicts << "," << stats.loads << "," << stats.stores;
+		string expected = fields.size() >= 11 ? fields[4] + "," + fields[5] + "," + fields[7] + "," + fields[8] + "," + fields[9] + "," + fields[10] : row;
+		expect(fields.size() >= 11 && fields[2] == MODELS[model] && got.str() == expected,
+				string(MODELS[model]) + ": run() counts " + got.str() + ", the --sweep row " + expected);
+		model++;
+	}
+	expect(model == 4, "--sweep wrote " + to_string(model) + " rows, expected 4");
+}
+
+// A StreamSink trace is the per-cycle dump of the command line without --quiet
+static void test_trace(const string &processor, const string &model) {
+	string cli = capture(processor + " --asm " + PROGRAM + " --processor " + model);
+	size_t summary = cli.rfind("CPI = ");
+	cli = cli.substr(0, summary == string::npos ? cli.size() : summary);
+
+	Simulator sim(model);
+	string error;
+	expect(sim.load(PROGRAM, error), model + ": load failed: " + error);
+	ostringstream trace;
+	StreamSink sink(trace);
+	sim.output(&sink);
+	sim.trace(true);
+	sim.run();
+	expect(!trace.str().empty() && trace.str() == cli, model + ": the trace differs from the command line's dump");
+}
+
+int main(int argc, char **argv) {
+	string processor = argc > 1 ? argv[1] : "./processor";
+	char dir[] = "/tmp/simulator_api.XXXXXX";
+	if (!mkdtemp(dir)) {
+		cout << "cannot create a temporary directory\n";
+		return 1;
+	}
+	for (size_t m = 0; m < 4; m++) {
+		test_buffer(MODELS[m]);
+		test_stops(MODELS[m]);
+	}
+	test_sweep(processor, dir);
+	//The single-cycle command line also prints the control signals of every instruction
+	for (size_t m = 1; m < 4; m++) {
+		test_trace(processor, MODELS[m]);
+	}
+	capture(string("rm -rf ") + dir);
+	return failures != 0;
+}
@@ -0,0 +1,147 @@
+#ifndef THREADPOOL
+#define THREADPOOL
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Work-stealing thread pool for independent simulations of very different
+// lengths. Every worker has its own queue: tasks submitted from outside are
+// dealt out to the queues in turn, tasks a worker submits go on its own. A
+// worker takes its newest task first and, once its queue is empty, steals the
+// oldest task of another, so a few long runs do not leave the other workers
+// idle behind them.
+class WorkStealingPool {
+	private:
+		struct Queue {
+			std::mutex lock;
+			std::deque<std::function<void()> > tasks;
+		};
+
+		// Worker the calling thread is, of which pool
+		struct Worker {
+			const WorkStealingPool *pool;
+			unsigned index;
+		};
+
+		std::vector<std::unique_ptr<Queue> > queues;
+		std::vector<std::thread> workers;
+		std::mutex lock;                 //guards the counts below, taken before a queue's lock
+		std::condition_variable wake;    //tasks were queued or the pool stops
+		std::condition_variable idle;    //nothing is queued or running
+		uint64_t queued;
+		uint64_t running;
+		unsigned nextQueue;              //queue the next outside task goes to
+		bool stopping;
+
+		static Worker &current() {
+			static thread_local Worker worker = {NULL, 0};
+			return worker;
+		}
+
+		// Newest task of the worker's own queue, else the oldest of another
+		bool take(unsigned self, std::function<void()> &task) {
+			for (unsigned n = 0; n < queues.size(); n++) {
+				Queue &queue = *queues[(self + n) % queues.size()];
+				std::lock_guard<std::mutex> guard(queue.lock);
+				if (queue.tasks.empty()) {
+					continue;
+				}
+				if (n == 0) {
+					task = std::move(queue.tasks.back());
+					queue.tasks.pop_back();
+				}
+				else {
+					task = std::move(queue.tasks.front());
+					queue.tasks.pop_front();
+				}
+				return true;
+			}
+			return false;
+		}
+
+		void work(unsigned self) {
+			current().pool = this;
+			current().index = self;
+			while (true) {
+				{
+					std::unique_lock<std::mutex> guard(lock);
+					wake.wait(guard, [this]() {
+						return queued > 0 || stopping;
+					});
+					if (queued == 0) {
+						return;
+					}
+				}
+				std::function<void()> task;
+				if (!take(self, task)) {
+					continue; //another worker got there first
+				}
+				{
+					std::lock_guard<std::mutex> guard(lock);
+					queued--;
+					running++;
+				}
+				task();
+				std::lock_guard<std::mutex> guard(lock);
+				running--;
+				if (queued == 0 && running == 0) {
+					idle.notify_all();
+				}
+			}
+		}
+
+	public:
+		WorkStealingPool(unsigned threads) : queued(0), running(0), nextQueue(0), stopping(false) {
+			threads = std::max(1u, threads);
+			for (unsigned t = 0; t < threads; t++) {
+				queues.push_back(std::unique_ptr<Queue>(new Queue()));
+			}
+			for (unsigned t = 0; t < threads; t++) {
+				workers.push_back(std::thread(&WorkStealingPool::work, this, t));
+			}
+		}
+
+		// Runs the queued tasks, then stops the workers
+		~WorkStealingPool() {
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				stopping = true;
+			}
+			wake.notify_all();
+			for (size_t t = 0; t < workers.size(); t++) {
+				workers[t].join();
+			}
+		}
+
+		unsigned threads() const {
+			return workers.size();
+		}
+
+		void submit(std::function<void()> task) {
+			{
+				//Queued counts exactly the tasks in the queues, so no worker looks for one that is not there yet
+				std::lock_guard<std::mutex> guard(lock);
+				unsigned q = current().pool == this ? current().index : nextQueue++ % queues.size();
+				std::lock_guard<std::mutex> queueGuard(queues[q]->lock);
+				queues[q]->tasks.push_back(std::move(task));
+				queued++;
+			}
+			wake.notify_one();
+		}
+
+		// Blocks until every task submitted so far has finished
+		void wait() {
+			std::unique_lock<std::mutex> guard(lock);
+			idle.wait(guard, [this]() {
+				return queued == 0 && running == 0;
+			});
+		}
+};
+
+#endif
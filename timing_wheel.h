@@ -0,0 +1,100 @@
+#ifndef TIMING_WHEEL
+#define TIMING_WHEEL
+#include <cstdint>
+#include <vector>
+#include <queue>
+
+// Discrete-event kernel shared by the pipeline models. Stages and memory
+// components schedule their completions here instead of being polled every
+// cycle, and when nothing is due before the next event the simulation can jump
+// straight to it. Events due within Slots cycles sit in a ring of one-cycle
+// buckets, anything further out waits in a heap until the wheel catches up.
+
+enum event_kind {
+	EVENT_MEM_COMPLETE //the outstanding data memory access has finished
+};
+
+struct Event {
+	uint64_t time;
+	uint32_t kind;
+	uint32_t data;
+};
+
+template <unsigned Slots>
+class TimingWheel {
+	private:
+		struct Later {
+			bool operator()(const Event &a, const Event &b) const {
+				return a.time > b.time;
+			}
+		};
+
+		std::vector<Event> bucket[Slots]; //bucket[t % Slots] holds the events due at cycle t
+		std::priority_queue<Event, std::vector<Event>, Later> overflow; //events Slots or more cycles ahead
+		uint64_t now;
+		uint32_t count; //events in the buckets
+
+		//Moves heap events that now fall inside the wheel into their buckets
+		void refill() {
+			while (!overflow.empty() && overflow.top().time < now + Slots) {
+				bucket[overflow.top().time % Slots].push_back(overflow.top());
+				count++;
+				overflow.pop();
+			}
+		}
+
+	public:
+		TimingWheel() : now(0), count(0) {}
+
+		uint64_t time() const {
+			return now;
+		}
+
+		bool empty() const {
+			return count == 0 && overflow.empty();
+		}
+
+		// Schedule an event delay cycles from now (0 is the current cycle)
+		void schedule(uint64_t delay, uint32_t kind, uint32_t data = 0) {
+			Event event = {now + delay, kind, data};
+			if (delay < Slots) {
+				bucket[event.time % Slots].push_back(event);
+				count++;
+			}
+			else {
+				overflow.push(event);
+			}
+		}
+
+		// Take one of the events due this cycle, returns false when none are left
+		bool pop(Event &event) {
+			std::vector<Event> &due = bucket[now % Slots];
+			if (due.empty()) {
+				return false;
+			}
+			event = due.back();
+			due.pop_back();
+			count--;
+			return true;
+		}
+
+		// Cycle of the earliest pending event, UINT64_MAX if there is none
+		uint64_t next_time() const {
+			if (count != 0) {
+				for (uint64_t t = now; t < now + Slots; t++) {
+					if (!bucket[t % Slots].empty()) {
+						return t;
+					}
+				}
+			}
+			return overflow.empty() ? UINT64_MAX : overflow.top().time;
+		}
+
+		// Move time forward n cycles, must not step past a pending event
+		void advance(uint64_t n) {
+			now += n;
+			refill();
+		}
+};
+
+#endif